@@ -0,0 +1,167 @@
+/*benchmarks the cost of aletheia itself: registering tests, running empty
+ *tests with and without hooks, passing and failing assertions, and, with
+ *glibc 2.33 or newer, the heap footprint of tests and failures
+ *
+ *usage: aletheia-overhead --bench [--results <path>] [--bench-baseline <path>]
+ *
+ *keep the result file of a known-good build around and pass it as baseline to
+ *judge framework changes against it
+ */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <aletheia/test.h>
+
+//heap statistics come from `mallinfo2`; other libcs report no footprint
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+ #define OVERHEAD_HEAP_STATS 1
+ #include <malloc.h>
+#endif
+
+//tests run per iteration of the run loop benchmarks
+#define OVERHEAD_RUN_TESTS 1000
+//failures pushed before starting over with a fresh test
+#define OVERHEAD_FAILURES 1024
+
+//utility function; bytes currently allocated from the heap, including
+//allocator overhead and mapped chunks, or `false` if unknown
+static bool overhead_heap_bytes(size_t * dst) {
+#ifdef OVERHEAD_HEAP_STATS
+ struct mallinfo2 const info = mallinfo2();
+ *dst = info.uordblks + info.hblkhd;
+ return true;
+#else
+ *dst = 0;
+ return false;
+#endif
+}
+
+static void overhead_empty_test(test_t test, void * ctx) {
+ (void)ctx;
+ test_ok(&test);
+}
+
+static void overhead_hook(test_runner_setup_t setup) {
+ (void)setup;
+}
+
+//utility function; registers `count` empty tests through `TEST`
+static void overhead_register(test_suite_t test_suite, size_t count) {
+ for (size_t i = 0; i < count; i++) {
+  TEST(overhead_empty_test);
+ }
+}
+
+static void bench__overhead_register(bench_state_t state, void * ctx) {
+ (void)ctx;
+ size_t const count = (size_t)bench_state_get_arg(&state, 0);
+ while (bench_state_keep_running(&state)) {
+  test_suite_t test_suite;
+  handle_internal_failure(test_suite_new(&test_suite), __func__);
+  overhead_register(test_suite, count);
+  bench_state_pause_timing(&state);
+  test_suite_free(&test_suite);
+  bench_state_resume_timing(&state);
+ }
+
+ //footprint of registered tests, outside of the measurement
+ size_t before = 0, after = 0;
+ bool const known = overhead_heap_bytes(&before);
+ test_suite_t test_suite;
+ handle_internal_failure(test_suite_new(&test_suite), __func__);
+ overhead_register(test_suite, count);
+ overhead_heap_bytes(&after);
+ test_suite_free(&test_suite);
+ bench_state_set_counter(&state, "tests", (double)count);
+ if (known) {
+  bench_state_set_counter(&state, "bytes-per-test", ((double)after - (double)before) / (double)count);
+ }
+}
+
+//utility function; runs a suite of empty tests, with or without all four hooks
+static void overhead_run(bench_state_t state, bool hooks) {
+ test_suite_t test_suite;
+ handle_internal_failure(test_suite_new(&test_suite), __func__);
+ overhead_register(test_suite, OVERHEAD_RUN_TESTS);
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ if (hooks) {
+  config.before_each = overhead_hook;
+  config.after_each = overhead_hook;
+  config.before_all = overhead_hook;
+  config.after_all = overhead_hook;
+ }
+ while (bench_state_keep_running(&state)) {
+  test_suite_run_and_emit(&test_suite, config);
+ }
+ test_suite_free(&test_suite);
+ bench_state_set_counter(&state, "tests", (double)OVERHEAD_RUN_TESTS);
+}
+
+static void bench__overhead_run(bench_state_t state, void * ctx) {
+ (void)ctx;
+ overhead_run(state, false);
+}
+
+static void bench__overhead_run_hooks(bench_state_t state, void * ctx) {
+ (void)ctx;
+ overhead_run(state, true);
+}
+
+static void bench__overhead_assert_pass(bench_state_t state, void * ctx) {
+ (void)ctx;
+ test_t test;
+ handle_internal_failure(test_new(&test, "passing", overhead_empty_test), __func__);
+ bool volatile value = true;
+ while (bench_state_keep_running(&state)) {
+  test_expect_true(value);
+ }
+ test_free(&test);
+}
+
+static void bench__overhead_assert_fail(bench_state_t state, void * ctx) {
+ (void)ctx;
+ test_t test;
+ handle_internal_failure(test_new(&test, "failing", overhead_empty_test), __func__);
+ bool volatile value = false;
+ size_t failures = 0;
+ while (bench_state_keep_running(&state)) {
+  test_expect_true(value);
+  //bound memory use; starting over is not part of the measurement
+  if (++failures == OVERHEAD_FAILURES) {
+   bench_state_pause_timing(&state);
+   test_free(&test);
+   handle_internal_failure(test_new(&test, "failing", overhead_empty_test), __func__);
+   failures = 0;
+   bench_state_resume_timing(&state);
+  }
+ }
+ test_free(&test);
+
+ //footprint of failures, outside of the measurement
+ handle_internal_failure(test_new(&test, "failing", overhead_empty_test), __func__);
+ size_t before = 0, after = 0;
+ bool const known = overhead_heap_bytes(&before);
+ for (size_t i = 0; i < OVERHEAD_FAILURES; i++) {
+  test_expect_true(value);
+ }
+ overhead_heap_bytes(&after);
+ test_free(&test);
+ if (known) {
+  bench_state_set_counter(
+   &state,
+   "bytes-per-failure",
+   ((double)after - (double)before) / OVERHEAD_FAILURES
+  );
+ }
+}
+
+TEST_SUITE() {
+ BENCH_ARGS(bench__overhead_register, BENCH_LIST(1000, 100000, 1000000));
+ BENCH(bench__overhead_run);
+ BENCH(bench__overhead_run_hooks);
+ BENCH(bench__overhead_assert_pass);
+ BENCH(bench__overhead_assert_fail);
+}
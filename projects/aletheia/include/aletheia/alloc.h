@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ *allocation accounting for tests and benchmarks
+ *
+ *counting requires an allocation interposer: link the `aletheia-alloc`
+ *object library into the test executable (or have a custom allocator call
+ *the `alloc_tracking_on_*` hooks). Without one, all counters stay zero and
+ *`alloc_tracking_available()` returns `false`
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//allocation counters for a tracked region
+typedef struct {
+ uint64_t
+  allocs,
+  frees,
+  //bytes requested by all allocations
+  bytes,
+  //largest number of bytes live at once, relative to the start of the region
+  peak_bytes;
+} alloc_stats_t;
+
+//accumulates `src` into `dst`; peaks are combined with `max`
+void alloc_stats_add(alloc_stats_t * dst, alloc_stats_t const * src);
+
+//whether an allocation interposer has reported any allocation yet
+bool alloc_tracking_available(void);
+//resets all counters and starts counting
+void alloc_tracking_start(void);
+//stops counting and reads all counters
+void alloc_tracking_stop(alloc_stats_t * dst);
+/**
+ *temporarily excludes allocations of the calling thread from the counters,
+ *e.g. for the framework's own bookkeeping inside a tracked test; calls nest
+ */
+void alloc_tracking_suspend(void);
+void alloc_tracking_resume(void);
+
+//snapshot of the counters and tracking state, to nest tracked regions
+typedef struct {
+ bool enabled;
+ //suspensions of the saving thread
+ int suspended;
+ alloc_stats_t stats;
+ int64_t live_bytes;
+} alloc_tracking_state_t;
+//stops counting and saves the current state into `dst`
+void alloc_tracking_save(alloc_tracking_state_t * dst);
+//restores a state saved with `alloc_tracking_save`, discarding counts since
+void alloc_tracking_restore(alloc_tracking_state_t const * src);
+
+//hooks for allocation interposers; must not allocate
+void alloc_tracking_on_alloc(size_t size, size_t usable_size);
+void alloc_tracking_on_free(size_t usable_size);
+
+//block still live at the end of a leak-checked region
+typedef struct {
+ void const * ptr;
+ size_t size;
+ //return address of the allocating call, if known
+ void const * site;
+} alloc_block_t;
+
+//maximum number of blocks live at once within a leak-checked region
+#define ALLOC_LEAKS_CAPACITY ((size_t)1 << 16)
+
+/**
+ *starts recording blocks allocated from now on, except by suspended threads,
+ *in a fixed-size hash table of live blocks; freeing a recorded block,
+ *suspended or not, removes it again
+ */
+void alloc_leaks_start(void);
+/**
+ *stops recording and copies up to `capacity` blocks still live into `dst`;
+ *returns the number of live blocks, which may exceed `capacity`. `overflowed`
+ *is set if more than `ALLOC_LEAKS_CAPACITY` blocks were live at once, in
+ *which case some leaks may have gone unnoticed
+ */
+size_t alloc_leaks_stop(alloc_block_t * dst, size_t capacity, bool * overflowed);
+
+//hooks for allocation interposers tracking individual blocks; must not allocate
+void alloc_leaks_on_alloc(void const * ptr, size_t size, void const * site);
+void alloc_leaks_on_free(void const * ptr);
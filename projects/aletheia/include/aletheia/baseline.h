@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <aletheia/bench.h>
+
+//options type for baseline comparisons
+typedef struct {
+ //significance level for the Mann-Whitney U test on per-repetition samples
+ double alpha;
+ //minimum slowdown of the median, in percent, to count as a regression
+ double threshold_percent;
+} bench_baseline_config_t;
+
+//conveinence macro
+#define BENCH_BASELINE_DEFAULT (bench_baseline_config_t) {\
+ .alpha = 0.01,\
+ .threshold_percent = 5.0\
+}
+
+//opaque pointer for benchmark baseline descriptor
+typedef uint8_t * bench_baseline_t;
+
+//`bench_baseline_t` functions
+//loads all `bench` records from a result file
+char const * bench_baseline_load(bench_baseline_t * dst, FILE * file);
+void bench_baseline_free(bench_baseline_t * baseline);
+/**
+ *compares every benchmark in `suite` that has samples against `baseline`,
+ *prints per-benchmark deltas with a `1 - alpha` confidence interval for the
+ *shift, and returns the number of significant regressions
+ */
+size_t bench_baseline_compare_and_emit(
+ bench_baseline_t * baseline,
+ bench_suite_t * suite,
+ bench_baseline_config_t config
+);
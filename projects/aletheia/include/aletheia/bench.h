@@ -0,0 +1,391 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <aletheia/util/stats.h>
+#include <aletheia/util/perf.h>
+#include <aletheia/util/histogram.h>
+#include <aletheia/util/library.h>
+#include <aletheia/alloc.h>
+
+//maximum number of argument dimensions for a parameterized benchmark
+#define BENCH_MAX_ARGS 4
+//maximum number of user counters a benchmark can set
+#define BENCH_MAX_COUNTERS 8
+
+//opaque pointer for benchmark descriptor
+typedef uint8_t * bench_t;
+//opaque pointer for benchmark state, handed to benchmark callbacks
+typedef uint8_t * bench_state_t;
+//opaque pointer for benchmark suite descriptor
+typedef uint8_t * bench_suite_t;
+//opaque pointer for benchmark runner descriptor, handed to setup hooks
+typedef uint8_t * bench_runner_setup_t;
+
+/**
+ *optimization barriers for benchmark bodies; without them, compilers are free
+ *to delete work whose results are never observed:
+ *
+ * while (bench_state_keep_running(&state)) {
+ *  int64_t value = compute();
+ *  BENCH_ESCAPE(&value);
+ * }
+ *
+ *`BENCH_ESCAPE` makes the object behind `pointer` observable, so every write
+ *to it must happen; `BENCH_CLOBBER` makes all escaped memory observable, so
+ *writes through escaped pointers cannot be sunk out of the loop
+ */
+#if defined(__GNUC__) || defined(__clang__)
+ #define BENCH_ESCAPE(pointer) \
+  __asm__ __volatile__("" : : "g"((void const *)(pointer)) : "memory")
+ #define BENCH_CLOBBER() __asm__ __volatile__("" : : : "memory")
+#else
+ #define BENCH_ESCAPE(pointer) \
+  (bench_escape_sink = (void const *)(pointer), bench_clobber_fallback())
+ #define BENCH_CLOBBER() bench_clobber_fallback()
+#endif
+
+//fallbacks for compilers without GNU inline assembly
+extern void const * volatile bench_escape_sink;
+//opaque call; the compiler must assume it reads and writes all escaped memory
+void bench_clobber_fallback(void);
+
+//`bench_state_t` functions
+/**
+ *drives the benchmark loop; timing starts on the first call and stops once
+ *it returns `false`:
+ *
+ * while (bench_state_keep_running(&state)) {
+ *  ...
+ * }
+ */
+bool bench_state_keep_running(bench_state_t * state);
+//number of iterations the current run of the callback will perform
+uint64_t bench_state_get_iterations(bench_state_t * state);
+/**
+ *excludes the following code from timing, e.g. per-iteration setup, until
+ *`bench_state_resume_timing`:
+ *
+ * while (bench_state_keep_running(&state)) {
+ *  bench_state_pause_timing(&state);
+ *  ...
+ *  bench_state_resume_timing(&state);
+ *  ...
+ * }
+ *
+ *the cost of the timestamps themselves is subtracted as well; paused time is
+ *also subtracted from cpu time, and paused allocations and hardware counters
+ *are not counted for single-threaded benchmarks
+ */
+void bench_state_pause_timing(bench_state_t * state);
+void bench_state_resume_timing(bench_state_t * state);
+//argument `index` of a parameterized benchmark instance; `0` if out of range
+int64_t bench_state_get_arg(bench_state_t * state, size_t index);
+//index of the calling thread within a threaded benchmark, from `0`
+size_t bench_state_get_thread_index(bench_state_t * state);
+//number of threads running the benchmark concurrently
+size_t bench_state_get_thread_count(bench_state_t * state);
+/**
+ *sets user counter `name` for the current run of the callback; values set by
+ *the threads of a threaded benchmark are summed. `name` must stay valid until
+ *the callback returns
+ */
+char const * bench_state_set_counter(
+ bench_state_t * state,
+ char const * name,
+ double value
+);
+
+//`bench_runner_setup_t` functions
+bench_t bench_runner_setup_get_bench(bench_runner_setup_t * setup);
+//`ctx` is handed to the benchmark callback
+void bench_runner_setup_set_ctx(bench_runner_setup_t * setup, void * ctx);
+void * bench_runner_setup_get_ctx(bench_runner_setup_t * setup);
+char const * bench_runner_setup_fail(bench_runner_setup_t * setup, char const * error);
+
+//options type for benchmark runs
+typedef struct {
+ /**
+  *functions run before and after each benchmark, including its warmup, and
+  *excluded from timing; if either fails, so does the benchmark
+  */
+ void (*before_each)(bench_runner_setup_t setup);
+ void (*after_each)(bench_runner_setup_t setup);
+ //minimum duration of a single repetition, in nanoseconds
+ uint64_t min_time_ns;
+ //duration of the warmup phase before measuring, in nanoseconds
+ uint64_t warmup_time_ns;
+ //number of measured repetitions
+ size_t repetitions;
+ //sample hardware counters around every measured repetition
+ bool perf_counters;
+ //count allocations made by every measured iteration
+ bool alloc_tracking;
+ /**
+  *when non-zero, additionally timestamps every `latency_batch` iterations of
+  *the measured repetitions and records the per-iteration latency of every
+  *batch into a histogram; `1` times each iteration individually, at the cost
+  *of a clock read per iteration
+  */
+ uint64_t latency_batch;
+ /**
+  *pins the benchmark thread to its current CPU, warms up until timings
+  *converge and flags results that are likely unreliable
+  */
+ bool stabilize;
+ //raises scheduling priority while benchmarking, as far as permitted
+ bool raise_priority;
+} bench_runner_config_t;
+
+//conveinence macro
+#define BENCH_RUNNER_DEFAULT (bench_runner_config_t) {\
+ .before_each = NULL,\
+ .after_each = NULL,\
+ .min_time_ns = UINT64_C(100000000),\
+ .warmup_time_ns = UINT64_C(50000000),\
+ .repetitions = 10,\
+ .perf_counters = false,\
+ .alloc_tracking = false,\
+ .latency_batch = 0,\
+ .stabilize = false,\
+ .raise_priority = false\
+}
+
+//reasons a stabilized benchmark result may be unreliable
+enum bench_unstable_t {
+ //timings did not converge during warmup
+ BENCH_UNSTABLE_WARMUP = 1 << 0,
+ //repetitions vary by more than 5% (coefficient of variation)
+ BENCH_UNSTABLE_VARIANCE = 1 << 1,
+ //CPU frequency changed by more than 5% between repetitions
+ BENCH_UNSTABLE_FREQUENCY = 1 << 2,
+ //the CPU was thermally throttled while measuring
+ BENCH_UNSTABLE_THROTTLED = 1 << 3
+};
+
+//printable name for a single `bench_unstable_t` flag
+char const * bench_unstable_name(enum bench_unstable_t reason);
+
+//summary of a benchmark run; all times are in nanoseconds per iteration
+typedef struct {
+ /**
+  *cost of an iteration of an empty benchmark loop, and whether the fastest
+  *repetition is within 10% of it; such results most likely measure a body
+  *that the compiler optimized away, see `BENCH_ESCAPE`
+  */
+ double loop_floor;
+ bool too_fast;
+ //iterations per repetition, as determined by calibration
+ uint64_t iterations;
+ stats_summary_t time;
+ //cpu time of the benchmark thread, averaged over threads
+ stats_summary_t cpu_time;
+ //counter totals over all measured repetitions
+ perf_counters_t counters;
+ //allocation totals over all measured repetitions
+ alloc_stats_t allocs;
+ //`bench_unstable_t` flags, if the run was stabilized
+ unsigned unstable;
+ //threads running the benchmark concurrently
+ size_t threads;
+ //iterations per second over all threads, from first start to last finish
+ stats_summary_t throughput;
+} bench_stats_t;
+
+/**
+ *paired comparison of a variant against the first variant of its comparison
+ *group, the reference; relative differences are taken per round, so drift
+ *over the course of the run affects both sides of every pair alike
+ */
+typedef struct {
+ //rounds in which both variants ran
+ size_t rounds;
+ //median of the per-round differences, in percent of the reference's time;
+ //negative if the variant is faster
+ double median;
+ //distribution-free confidence interval for `median`
+ stats_interval_t interval;
+} bench_comparison_t;
+
+//confidence level of the intervals in `bench_comparison_t`
+#define BENCH_COMPARISON_CONFIDENCE 0.95
+
+//`bench_t` functions
+//prototype for benchmark callback
+typedef void bench_callback_t(bench_state_t state, void * ctx);
+char const * bench_new(
+ bench_t * dst,
+ char const * name,
+ bench_callback_t * callback
+);
+void bench_free(bench_t * bench);
+char const * bench_copy(bench_t * bench, bench_t * dst);
+//errors returned by `bench_run` stay valid until the next run of `bench`
+char const * bench_run(bench_t * bench, bench_runner_config_t runner_config);
+char const * bench_get_name(bench_t * bench, char const ** dst);
+//sets the context handed to the callback, unless replaced by `before_each`
+void bench_set_ctx(bench_t * bench, void * ctx);
+//name without arguments or thread count; same as the name for plain benchmarks
+char const * bench_get_family(bench_t * bench, char const ** dst);
+char const * bench_get_stats(bench_t * bench, bench_stats_t * dst);
+//per-repetition samples, in nanoseconds per iteration
+char const * bench_get_samples(bench_t * bench, size_t * count, double ** dst);
+/**
+ *latency histogram merged over all measured repetitions, in nanoseconds per
+ *iteration; `dst` is set to `NULL` if the last run did not record latencies
+ */
+char const * bench_get_latency(bench_t * bench, histogram_t ** dst);
+//arguments of a parameterized benchmark instance; `count` is `0` otherwise
+char const * bench_get_args(
+ bench_t * bench,
+ size_t * count,
+ int64_t dst[BENCH_MAX_ARGS]
+);
+
+//per-repetition cpu time samples, in nanoseconds per iteration
+char const * bench_get_cpu_samples(bench_t * bench, size_t * count, double ** dst);
+//names of the user counters set by the last run; free every name and `dst`
+char const * bench_get_counter_names(bench_t * bench, size_t * count, char *** dst);
+//per-repetition values of the user counter at `index`
+char const * bench_get_counter_samples(
+ bench_t * bench,
+ size_t index,
+ size_t * count,
+ double ** dst
+);
+//error that stopped the last run, if any
+char const * bench_get_error(bench_t * bench, char const ** dst);
+/**
+ *comparison against the reference of the benchmark's comparison group;
+ *`rounds` is `0` for the reference itself and for benchmarks outside groups
+ */
+char const * bench_get_comparison(bench_t * bench, bench_comparison_t * dst);
+//total iterations per second over all threads, for every measured repetition
+char const * bench_get_throughput(bench_t * bench, size_t * count, double ** dst);
+
+/**
+ *values for one argument dimension of a parameterized benchmark; either an
+ *explicit list, or the geometric range `start, start * multiplier, ...`
+ *capped by and always including `limit`
+ */
+typedef struct {
+ size_t value_count;
+ int64_t const * values;
+ int64_t
+  start,
+  limit,
+  multiplier;
+} bench_arg_range_t;
+
+//conveinence macros
+#define BENCH_RANGE(start_value, limit_value, multiplier_value) (bench_arg_range_t) {\
+ .value_count = 0,\
+ .values = NULL,\
+ .start = (start_value),\
+ .limit = (limit_value),\
+ .multiplier = (multiplier_value)\
+}
+
+#define BENCH_LIST(...) (bench_arg_range_t) {\
+ .value_count = sizeof((int64_t const[]) {__VA_ARGS__}) / sizeof(int64_t),\
+ .values = (int64_t const[]) {__VA_ARGS__},\
+ .start = 0,\
+ .limit = 0,\
+ .multiplier = 0\
+}
+
+//`bench_suite_t` functions
+/**
+ *NOTE: benchmarks with more than one thread run their callback once per
+ *thread, concurrently; every thread must call `bench_state_keep_running`,
+ *since all of them are released together from a spin barrier on their first
+ *call. Hardware counters are only sampled for single-threaded benchmarks,
+ *since they measure the calling thread
+ */
+char const * bench_suite_new(bench_suite_t * dst);
+void bench_suite_free(bench_suite_t * suite);
+char const * bench_suite_add(bench_suite_t * suite, bench_t * bench);
+/**
+ *adds one instance of `bench` per combination of the values in `ranges`,
+ *named `<name>/<arg 0>/<arg 1>...`
+ *
+ *after running, instances that differ only in their first argument are fit
+ *to the complexity models in `<aletheia/util/stats.h>`, with the first
+ *argument as problem size
+ */
+char const * bench_suite_add_args(
+ bench_suite_t * suite,
+ bench_t * bench,
+ size_t range_count,
+ bench_arg_range_t const * ranges
+);
+/**
+ *adds one instance of `bench` per entry of `thread_counts`, named
+ *`<name>/threads:<n>`; after running, instances are compared against the
+ *single-threaded instance, if any, to report scaling efficiency
+ */
+char const * bench_suite_add_threads(
+ bench_suite_t * suite,
+ bench_t * bench,
+ size_t count,
+ size_t const * thread_counts
+);
+/**
+ *adds a comparison group named `name`, with one instance of every benchmark
+ *in `variants`, named `<name>/<variant name>`; the first variant is the
+ *reference the others are compared against
+ *
+ *groups run all variants in interleaved rounds, one repetition of every
+ *variant per round in random order, so thermal and frequency drift affect
+ *all variants alike; latencies are not recorded for comparisons
+ */
+char const * bench_suite_add_comparison(
+ bench_suite_t * suite,
+ char const * name,
+ size_t count,
+ bench_t * variants
+);
+/**
+ *`bench_suite_add_comparison` for plain callbacks; `names` holds the names of
+ *all `callbacks`, separated by commas, e.g. as stringized by `BENCH_COMPARE`
+ */
+char const * bench_suite_add_comparison_callbacks(
+ bench_suite_t * suite,
+ char const * name,
+ char const * names,
+ size_t count,
+ bench_callback_t * const * callbacks
+);
+/**
+ *registers `bench` to run against every library later passed to
+ *`bench_suite_add_library_comparisons`; its callback receives the library
+ *as `ctx`, a `library_t`, to resolve the code under test from:
+ *
+ * library_t library = (library_t)ctx;
+ * library_function_t * function = NULL;
+ * library_function(&library, "function", &function);
+ */
+char const * bench_suite_add_per_library(bench_suite_t * suite, bench_t * bench);
+/**
+ *adds one instance of every benchmark registered with
+ *`bench_suite_add_per_library` per library, named `<name>/<library path>`;
+ *with more than one library, the instances of every benchmark form a
+ *comparison group, with the first library as reference. `libraries` must
+ *outlive every run of `suite`
+ */
+char const * bench_suite_add_library_comparisons(
+ bench_suite_t * suite,
+ size_t count,
+ library_t * libraries
+);
+char const * bench_suite_get_benches(
+ bench_suite_t * suite,
+ size_t * count,
+ bench_t ** dst
+);
+size_t bench_suite_run_and_emit(
+ bench_suite_t * suite,
+ bench_runner_config_t runner_config
+);
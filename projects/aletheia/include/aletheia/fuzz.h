@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ *in-process fuzz targets, living next to the unit tests of the code they
+ *exercise:
+ *
+ * FUZZ_TARGET(fuzz__parse) {
+ *  parsed_t parsed;
+ *  test_expect_true(parse(data, size, &parsed) || size == 0);
+ * }
+ *
+ * TEST_SUITE() {
+ *  FUZZ(fuzz__parse);
+ * }
+ *
+ *every target runs as a regular test replaying its corpus: the files in
+ *`<corpus>/<target name>/` given `--fuzz-corpus <corpus>`, each memory-mapped
+ *rather than copied, or only the empty input without a corpus
+ *
+ *`--fuzz <target name>` instead mutates corpus inputs in-process, adding
+ *inputs that reach new coverage to the corpus directory. Coverage comes from
+ *code built with `-fsanitize-coverage=trace-pc-guard`; without it, inputs
+ *are still mutated, but the corpus does not grow. The first failing input is
+ *written next to the corpus, or into the working directory, as
+ *`<target name>-crash-<hash>`
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <aletheia/test.h>
+
+//prototype for fuzz target bodies; `test` collects the failures of one input
+typedef void fuzz_callback_t(test_t test, uint8_t const * data, size_t size);
+
+//descriptor for fuzz targets, defined by `FUZZ_TARGET`
+typedef struct fuzz_target_t {
+ char const * name;
+ fuzz_callback_t * callback;
+ //registered targets, for `fuzz_run`
+ bool registered;
+ struct fuzz_target_t * next;
+} fuzz_target_t;
+
+//defines fuzz target `name`; the body follows, taking `test`, `data` and `size`
+#define FUZZ_TARGET(name) \
+static void name##__body(test_t test, uint8_t const * data, size_t size);\
+static fuzz_target_t name = {#name, name##__body, false, NULL};\
+static void name##__body(test_t test, uint8_t const * data, size_t size)
+
+//registers a test replaying the corpus of fuzz target `name`
+#define FUZZ(name) {\
+ test_t test;\
+ handle_internal_failure(fuzz_test_new(&test, &name), __func__);\
+ handle_internal_failure(test_suite_add(&test_suite, &test), __func__);\
+ test_free(&test);\
+}
+
+//creates a test replaying the corpus of `target`, and registers `target`
+char const * fuzz_test_new(test_t * dst, fuzz_target_t * target);
+//corpus root directory for replaying and fuzzing, or `NULL`; not copied
+void fuzz_set_corpus(char const * path);
+
+//options type for fuzzing
+typedef struct {
+ //stop after this many runs or this much time; `0` disables either
+ uint64_t max_runs;
+ uint64_t max_time_ns;
+ //maximum length of mutated inputs
+ size_t max_length;
+ //mutation seed; `0` picks one from the clock
+ uint64_t seed;
+} fuzz_config_t;
+
+//conveinence macro
+#define FUZZ_DEFAULT (fuzz_config_t) {\
+ .max_runs = 0,\
+ .max_time_ns = UINT64_C(10000000000),\
+ .max_length = 4096,\
+ .seed = 0\
+}
+
+//outcome of a fuzzing session
+typedef struct {
+ uint64_t runs;
+ uint64_t elapsed_ns;
+ size_t corpus_size;
+ //distinct coverage features, i.e. guards hit with distinct hit count buckets
+ size_t features;
+ //whether an input failed the target
+ bool failed;
+} fuzz_stats_t;
+
+//fuzzes the registered target `name` until a limit in `config` is reached or
+//an input fails; failures are printed along with the crash file written
+char const * fuzz_run(char const * name, fuzz_config_t config, fuzz_stats_t * dst);
@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ *writes benchmark results in the JSON schema used by Google Benchmark's
+ *`--benchmark_format=json`, so existing dashboards and comparison scripts
+ *can consume them:
+ *
+ * {
+ *  "context": {"date": ..., "num_cpus": ..., "caches": [...], ...},
+ *  "benchmarks": [
+ *   {"name": ..., "run_type": "iteration", "real_time": ..., ...},
+ *   {"name": ..._mean, "run_type": "aggregate", ...}
+ *  ]
+ * }
+ *
+ *every measured repetition is written as an `iteration` run; benchmarks with
+ *more than one repetition also get `mean`, `median`, `stddev` and `cv`
+ *aggregates. User counters are written as additional run members
+ */
+
+#include <stdio.h>
+
+#include <aletheia/bench.h>
+
+//writes `value` as an escaped JSON string, including quotes
+void bench_json_write_string(FILE * dst, char const * value);
+
+//writes every benchmark in `suite` to `dst`; `executable` is reported as-is
+char const * bench_json_write(
+ bench_suite_t * suite,
+ FILE * dst,
+ char const * executable
+);
@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ *sampling profiler driven by `setitimer(ITIMER_PROF)`; every `SIGPROF`
+ *records the interrupted program counter and, where frame pointers allow,
+ *the return addresses of its callers into a preallocated buffer, tagged with
+ *whatever `profile_set_tag` was last given, e.g. the running test
+ *
+ *the signal handler neither allocates nor locks. Stacks are only walked on
+ *the thread that started the profile, within its stack bounds; build with
+ *`-fno-omit-frame-pointer` for complete stacks, and link executables with
+ *`-rdynamic` so that their own functions can be named
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//maximum number of frames recorded per sample
+#define PROFILE_MAX_DEPTH 32
+//default number of samples kept, and default sampling interval
+#define PROFILE_DEFAULT_CAPACITY ((size_t)1 << 16)
+#define PROFILE_DEFAULT_INTERVAL_US 1000
+
+//opaque pointer for a sampling profiler
+typedef uint8_t * profile_t;
+
+//`profile_t` functions
+char const * profile_new(profile_t * dst, size_t capacity, uint64_t interval_us);
+void profile_free(profile_t * profile);
+//starts sampling the process; only a single profile may run at once
+char const * profile_start(profile_t * profile);
+void profile_stop(profile_t * profile);
+/**
+ *tags following samples with `tag`, or leaves them untagged for `NULL`;
+ *`tag` is not copied and must stay valid until the profile is written. A
+ *no-op if `*profile` is `NULL`
+ */
+void profile_set_tag(profile_t * profile, char const * tag);
+//samples taken, including those dropped because the buffer was full
+size_t profile_get_sample_count(profile_t * profile, size_t * dropped);
+/**
+ *writes one `<tag>;<outermost frame>;...;<innermost frame> <count>` line per
+ *distinct stack, as consumed by `flamegraph.pl` and compatible tools;
+ *untagged samples use `[untagged]` as tag
+ */
+char const * profile_write_folded(profile_t * profile, FILE * dst);
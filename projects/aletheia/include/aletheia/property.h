@@ -0,0 +1,118 @@
+#pragma once
+
+/**
+ *property-based tests; a property is a test body run against many generated
+ *inputs:
+ *
+ * static void sort_property(test_t test, property_t property, void * ctx) {
+ *  size_t length;
+ *  int64_t const * values = property_int_array(&property, 64, -100, 100, &length);
+ *  ...
+ *  test_expect_true(is_sorted(sorted, length));
+ * }
+ *
+ * static void test__sort(test_t test, void * ctx) {
+ *  test_expect_property(sort_property, ctx);
+ *  test_ok(&test);
+ * }
+ *
+ *generators draw from a sequence of choices, recorded from a seeded PRNG
+ *while generating and replayed while shrinking. A failing case is shrunk by
+ *deleting and minimizing its choices, which moves every generated value
+ *towards short and small inputs without type-specific shrinkers; the failures
+ *of the smallest counterexample are reported on the enclosing test, together
+ *with its values and the seed reproducing it as first case
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <aletheia/test.h>
+
+//opaque pointer for the case a property body is run against
+typedef uint8_t * property_t;
+
+//options type for properties
+typedef struct {
+ //number of generated cases, and of attempts to shrink a failing one
+ size_t cases;
+ size_t max_shrinks;
+ //seed of the first case; `0` picks one from the clock
+ uint64_t seed;
+ //threads running cases; `0` runs one per online CPU
+ size_t workers;
+} property_config_t;
+
+//conveinence macro
+#define PROPERTY_DEFAULT (property_config_t) {\
+ .cases = 100,\
+ .max_shrinks = 1000,\
+ .seed = 0,\
+ .workers = 0\
+}
+
+//overrides the seed and case count of every property where non-zero; set
+//through `--property-seed` and `--property-cases`
+void property_override(uint64_t seed, size_t cases);
+
+/**
+ *prototype for property bodies; `test` only collects the failures of the
+ *current case. Bodies may run concurrently on several threads
+ */
+typedef void property_callback_t(test_t test, property_t property, void * ctx);
+
+//generators; returned buffers stay valid until the case ends
+//value in `[0, max]`
+uint64_t property_uint(property_t * property, uint64_t max);
+//value in `[min, max]`, shrinking towards `0` or the bound closest to it
+int64_t property_int(property_t * property, int64_t min, int64_t max);
+bool property_bool(property_t * property);
+uint8_t const * property_bytes(property_t * property, size_t max_length, size_t * length);
+//printable ASCII string
+char const * property_string(property_t * property, size_t max_length);
+int64_t const * property_int_array(
+ property_t * property,
+ size_t max_length,
+ int64_t min,
+ int64_t max,
+ size_t * length
+);
+
+/**
+ *runs `callback` with `ctx` against `config.cases` generated cases and fails
+ *with the shrunk counterexample if any case fails; cases are not counted
+ *towards the test's own allocations
+ */
+bool test_stmt_property__impl(
+ test_t * test,
+ test_site_t * site,
+ bool assertion,
+ property_config_t config,
+ property_callback_t * callback,
+ void * ctx
+);
+
+//shim to `test_stmt_property__impl`
+#define test_stmt_property(assertion, config, callback, ctx) {\
+ TEST_SITE(#callback);\
+ bool const failed = test_stmt_property__impl(\
+  &test,\
+  &test_stmt_site__,\
+  assertion,\
+  config,\
+  callback,\
+  ctx\
+ );\
+ if (assertion && failed) {\
+  return;\
+ }\
+}
+#define test_expect_property(callback, ctx) \
+test_stmt_property(false, PROPERTY_DEFAULT, callback, ctx)
+#define test_assert_property(callback, ctx) \
+test_stmt_property(true, PROPERTY_DEFAULT, callback, ctx)
+#define test_expect_property_with(config, callback, ctx) \
+test_stmt_property(false, config, callback, ctx)
+#define test_assert_property_with(config, callback, ctx) \
+test_stmt_property(true, config, callback, ctx)
@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ *result files are line-oriented text files, used to persist and combine the
+ *results of test runs:
+ *
+ * aletheia-results 1
+ * bench\t<name>\t<iterations>\t<median ns/iter>
+ * \tsamples\t<ns/iter>...
+ * test\t<name>\t<status>\t<failure count>
+ * \tfailure\t<fatal>\t<line>\t<file>\t<cause>
+ * \tperf\t<counter>=<value>...
+ * \talloc\tallocs=<n>\tfrees=<n>\tbytes=<n>\tpeak-bytes=<n>
+ * \tusage\t<phase>\twall-ns=<ns>\tuser-ns=<ns>\tsys-ns=<ns>\tmax-rss-kb=<kb>...
+ * \toutput\t<captured stdout and stderr>
+ * \tlatency\tcount=<n>\tp50=<ns>...\tmax=<ns>
+ * \tcounters\t<name>=<median>...
+ * \tthroughput\tthreads=<n>\tops-per-second=<ops/s>
+ * \tunstable\t<reason>...
+ *
+ *all child lines other than `samples` and `failure` are optional; for
+ *benchmarks, `perf` and `alloc` values other than peak bytes are per iteration;
+ *tests write one `usage` line per phase that ran: `before-each`, `test` and
+ *`after-each`, and an `output` line if their captured output was kept
+ *
+ *every record starts with a top-level line; lines beginning with a tab belong
+ *to the preceding record. All fields are escaped (`\\`, `\t` and `\n`) and
+ *records are written sorted by kind, then name, so any number of result files
+ *can be merged in a single streaming pass
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <aletheia/test.h>
+#include <aletheia/bench.h>
+
+//header line written at the start of every result file
+#define TEST_RESULTS_HEADER "aletheia-results 1"
+
+//descriptor for a single record read from a result file
+typedef struct {
+ //unescaped top-level fields; `fields[0]` is the kind, `fields[1]` the name
+ size_t field_count;
+ char ** fields;
+ //raw, still escaped, record text including all child lines
+ size_t text_length;
+ char * text;
+} test_results_record_t;
+void test_results_record_free(test_results_record_t * record);
+
+//`test_status_t` <-> result file status conversions
+char const * test_results_status_name(enum test_status_t status);
+enum test_status_t test_results_status_parse(char const * name);
+
+//escapes `\\`, `\t` and `\n` into an allocated buffer
+char * test_results_escape(char const * value);
+
+//writes every test in `suite` to `dst`, sorted by name
+char const * test_results_write(test_suite_t * suite, FILE * dst);
+
+//writes every benchmark in `suite` to `dst`, with samples, sorted by name
+char const * test_results_write_benches(bench_suite_t * suite, FILE * dst);
+
+/**
+ *whether the test in `record` failed its run, like the runner counts it:
+ *`ok-other-fail` tests whose only failures are time budget overruns did not
+ */
+bool test_results_record_failed(test_results_record_t const * record);
+
+//parses the `samples` child line of a `bench` record
+char const * test_results_record_get_samples(
+ test_results_record_t const * record,
+ size_t * count,
+ double ** dst
+);
+
+//opaque pointer for result file reader
+typedef uint8_t * test_results_reader_t;
+
+//`test_results_reader_t` functions
+char const * test_results_reader_new(
+ test_results_reader_t * dst,
+ FILE * file
+);
+void test_results_reader_free(test_results_reader_t * reader);
+/**
+ *reads the next record into `dst`; sets `done` and leaves `dst` zeroed once
+ *the file is exhausted
+ */
+char const * test_results_reader_next(
+ test_results_reader_t * reader,
+ test_results_record_t * dst,
+ bool * done
+);
+
+//orders records by kind, then name
+int test_results_record_compare(
+ test_results_record_t const * a,
+ test_results_record_t const * b
+);
@@ -4,7 +4,6 @@
  * - symbol name switch macro
  * - use debug compiler define
  * - add utilities for discovering tests
- * - benchmark support
  * - test report formats (JSON, HTML)
  * - benchmark report formats (JSON, HTML)
  */
@@ -13,6 +12,12 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include <aletheia/bench.h>
+#include <aletheia/alloc.h>
+#include <aletheia/trace.h>
+#include <aletheia/profile.h>
+#include <aletheia/util/usage.h>
+
 //test status enum
 enum test_status_t {
  TEST_NOT_RUN = 1,
@@ -32,6 +37,21 @@ void test_failure_free(test_failure_t * failure);
 void test_failures_free(size_t * count, test_failure_t ** failures);
 char const * test_failure_copy(test_failure_t * failure, test_failure_t * dst);
 
+//resource usage of a test callback and the hooks run around it
+typedef struct {
+ usage_t
+  before_each,
+  test,
+  after_each;
+} test_usage_t;
+
+//resource usage of the suite-wide hooks
+typedef struct {
+ usage_t
+  before_all,
+  after_all;
+} test_suite_usage_t;
+
 //opaque pointer for test descriptor
 typedef uint8_t * test_t;
 //opaque pointer for test runner descriptor
@@ -56,6 +76,45 @@ typedef struct {
  void (*before_all)(test_runner_setup_t setup);
  //function run after all tests
  void (*after_all)(test_runner_setup_t setup);
+ //sample hardware counters around each test callback
+ bool perf_counters;
+ //count allocations made by each test callback
+ bool alloc_tracking;
+ /**
+  *fails tests that leave blocks allocated during `before_each`, the test
+  *callback or `after_each` behind; needs an allocation interposer, see
+  *`<aletheia/alloc.h>`
+  */
+ bool leak_check;
+ /**
+  *captures `stdout` and `stderr` from `before_each` through `after_each`;
+  *output of tests that did not pass is kept and printed after the test, the
+  *output of passing tests is discarded unless `keep_output` is set
+  */
+ bool capture_output;
+ bool keep_output;
+ //records hooks and tests into this trace, if set; owned by the caller
+ trace_t trace;
+ /**
+  *attributes samples of this profile to the running test or suite hook, if
+  *set; starting, stopping and writing it are left to the caller
+  */
+ profile_t profile;
+ /**
+  *time budgets, in nanoseconds; `0` disables them. Tests whose callback
+  *exceeds `test_budget_ns`, and tests finishing after the suite has run for
+  *longer than `suite_budget_ns`, are marked `TEST_OK_OTHER_FAIL` without
+  *counting as failures of the run
+  */
+ uint64_t test_budget_ns;
+ uint64_t suite_budget_ns;
+ //number of slowest tests and hooks to list after the run; `0` disables
+ size_t slowest_count;
+ /**
+  *number of most evaluated and most failing assertion sites to list after
+  *the run; `0` disables. Site counters are zeroed when the run starts
+  */
+ size_t site_report_count;
 } test_runner_config_t;
 
 //conveinence macro
@@ -63,9 +122,24 @@ typedef struct {
  .before_each = NULL,\
  .after_each = NULL,\
  .before_all = NULL,\
- .after_all = NULL\
+ .after_all = NULL,\
+ .perf_counters = false,\
+ .alloc_tracking = false,\
+ .leak_check = false,\
+ .capture_output = false,\
+ .keep_output = false,\
+ .trace = NULL,\
+ .profile = NULL,\
+ .test_budget_ns = 0,\
+ .suite_budget_ns = 0,\
+ .slowest_count = 0,\
+ .site_report_count = 0\
 }
 
+//text in the cause of every time budget overrun, which tells them apart from
+//failures of the run in result files
+#define TEST_BUDGET_CAUSE "exceeding its time budget of"
+
 //`test_t` functions
 //prototype for test callback
 typedef void test_callback_t(test_t test, void * ctx);
@@ -76,6 +150,8 @@ char const * test_new(
 );
 void test_free(test_t * test);
 char const * test_copy(test_t * test, test_t * dst);
+//passes `ctx` to the test callback instead of the runner's context; not owned
+void test_set_ctx(test_t * test, void * ctx);
 char const * test_push_failure(
  test_t * test,
  char const * file,
@@ -96,6 +172,12 @@ char const * test_get_failures(
  size_t * count,
  test_failure_t ** dst
 );
+char const * test_get_perf_counters(test_t * test, perf_counters_t * dst);
+char const * test_get_alloc_stats(test_t * test, alloc_stats_t * dst);
+//usage of the last run; hooks that were not configured report zeros
+char const * test_get_usage(test_t * test, test_usage_t * dst);
+//output captured during the last run, or `NULL` if none was kept; owned by `test`
+char const * test_get_output(test_t * test, char const ** dst);
 
 //`test_suite_t` functions
 char const * test_suite_new(test_suite_t * dst);
@@ -106,23 +188,29 @@ char const * test_suite_get_tests(
  size_t * count,
  test_t ** dst
 );
+//benchmarks registered alongside the tests in `suite`, owned by `suite`
+bench_suite_t * test_suite_get_bench_suite(test_suite_t * suite);
+char const * test_suite_get_usage(test_suite_t * suite, test_suite_usage_t * dst);
 size_t test_suite_run_and_emit(
  test_suite_t * suite,
  test_runner_config_t runner_config
 );
 
+//runs `suite` according to the command line options in `argv`
+int test_suite_main(test_suite_t * suite, int argc, char ** argv);
+
 //utility function for fatal internal errors
 void handle_internal_failure(char const * error, char const * func);
 
 #define TEST_SUITE() \
 static void add_tests(test_suite_t test_suite);\
-int main(void) {\
+int main(int argc, char ** argv) {\
  test_suite_t test_suite;\
  handle_internal_failure(test_suite_new(&test_suite), __func__);\
  add_tests(test_suite);\
- size_t const result = test_suite_run_and_emit(&test_suite, TEST_RUNNER_DEFAULT);\
+ int const result = test_suite_main(&test_suite, argc, argv);\
  test_suite_free(&test_suite);\
- return (int)result;\
+ return result;\
 }\
 \
 static void add_tests(test_suite_t test_suite)
@@ -134,16 +222,117 @@ static void add_tests(test_suite_t test_suite)
  test_free(&test);\
 }
 
+#define BENCH(name) {\
+ bench_t bench;\
+ handle_internal_failure(bench_new(&bench, #name, name), __func__);\
+ handle_internal_failure(\
+  bench_suite_add(test_suite_get_bench_suite(&test_suite), &bench),\
+  __func__\
+ );\
+ bench_free(&bench);\
+}
+
+//registers one instance of `name` per combination of `BENCH_RANGE`/`BENCH_LIST` values
+#define BENCH_ARGS(name, ...) {\
+ bench_t bench;\
+ bench_arg_range_t const ranges[] = {__VA_ARGS__};\
+ handle_internal_failure(bench_new(&bench, #name, name), __func__);\
+ handle_internal_failure(\
+  bench_suite_add_args(\
+   test_suite_get_bench_suite(&test_suite),\
+   &bench,\
+   sizeof(ranges) / sizeof(ranges[0]),\
+   ranges\
+  ),\
+  __func__\
+ );\
+ bench_free(&bench);\
+}
+
+//registers one instance of `name` per thread count
+#define BENCH_THREADS(name, ...) {\
+ bench_t bench;\
+ size_t const thread_counts[] = {__VA_ARGS__};\
+ handle_internal_failure(bench_new(&bench, #name, name), __func__);\
+ handle_internal_failure(\
+  bench_suite_add_threads(\
+   test_suite_get_bench_suite(&test_suite),\
+   &bench,\
+   sizeof(thread_counts) / sizeof(thread_counts[0]),\
+   thread_counts\
+  ),\
+  __func__\
+ );\
+ bench_free(&bench);\
+}
+
+//registers a comparison group of benchmarks; the first one is the reference
+#define BENCH_COMPARE(name, ...) {\
+ bench_callback_t * const callbacks[] = {__VA_ARGS__};\
+ handle_internal_failure(\
+  bench_suite_add_comparison_callbacks(\
+   test_suite_get_bench_suite(&test_suite),\
+   #name,\
+   #__VA_ARGS__,\
+   sizeof(callbacks) / sizeof(callbacks[0]),\
+   callbacks\
+  ),\
+  __func__\
+ );\
+}
+
+//registers `name` to run against every library passed with `--bench-library`
+#define BENCH_LIBRARY(name) {\
+ bench_t bench;\
+ handle_internal_failure(bench_new(&bench, #name, name), __func__);\
+ handle_internal_failure(\
+  bench_suite_add_per_library(test_suite_get_bench_suite(&test_suite), &bench),\
+  __func__\
+ );\
+ bench_free(&bench);\
+}
+
 //test utility functions and macros
+/**
+ *static description of an assertion site; every expansion of an assertion
+ *macro defines one, registered on its first evaluation
+ */
 typedef struct {
- test_t * test;
  char const * file;
  int line;
  char const * identifier_name;
-} test_stmt_t;
+ //position in the site registry plus one, `0` while unregistered
+ size_t id;
+} test_site_t;
+
+//counters of an assertion site, summed over all threads
+typedef struct {
+ test_site_t const * site;
+ uint64_t evaluations;
+ uint64_t failures;
+} test_site_stats_t;
+
+/**
+ *copies the counters of up to `capacity` registered assertion sites into
+ *`dst`, in registration order, and returns the number of registered sites.
+ *Counters are kept per thread, so evaluating an assertion never contends with
+ *other threads; must not race with threads registering sites
+ */
+size_t test_sites_get_stats(test_site_stats_t * dst, size_t capacity);
+//zeroes the counters of all assertion sites on all threads
+void test_sites_reset(void);
+//counts an evaluation of `site` on the calling thread, for assertion shims
+void test_site_count(test_site_t * site, bool failed);
+//prints the `count` most evaluated and most failing assertion sites
+void test_sites_emit_report(size_t count);
+
+//conveinence macro
+#define TEST_SITE(identifier) \
+static test_site_t test_stmt_site__ = {__FILE__, __LINE__, identifier, 0}
 
 bool test_stmt_bool_eq__impl(
- test_stmt_t details,
+ test_t * test,
+ test_site_t * site,
  bool assertion,
  bool expected,
  bool value
@@ -151,13 +340,10 @@ bool test_stmt_bool_eq__impl(
 
 //shim to `test_stmt_bool_eq__impl`
 #define test_stmt_bool_eq(assertion, expected, value) {\
+ TEST_SITE(#value);\
  bool const failed = test_stmt_bool_eq__impl(\
-  (test_stmt_t) {\
-   .test = &test,\
-   .file = __FILE__,\
-   .line = __LINE__,\
-   .identifier_name = #value\
-  },\
+  &test,\
+  &test_stmt_site__,\
   assertion,\
   expected,\
   value\
@@ -170,3 +356,58 @@ bool test_stmt_bool_eq__impl(
 #define test_assert_true(value) test_stmt_bool_eq(true, true, value)
 #define test_expect_false(value) test_stmt_bool_eq(false, false, value)
 #define test_assert_false(value) test_stmt_bool_eq(true, false, value)
+
+//measured quantities for performance budgets
+enum test_budget_t {
+ //median time per iteration, in nanoseconds
+ TEST_BUDGET_TIME = 1,
+ //allocations per iteration
+ TEST_BUDGET_ALLOCS,
+ //bytes requested per iteration
+ TEST_BUDGET_BYTES
+};
+
+/**
+ *runs the benchmark `callback` with `ctx` over 5 repetitions of at least 1ms
+ *and fails if the measured `budget` exceeds `limit`; the cause contains the
+ *measured value. Allocation budgets need an allocation interposer, see
+ *`<aletheia/alloc.h>`, and are not counted towards the test's own allocations
+ */
+bool test_stmt_budget__impl(
+ test_t * test,
+ test_site_t * site,
+ bool assertion,
+ enum test_budget_t budget,
+ double limit,
+ bench_callback_t * callback,
+ void * ctx
+);
+
+//shim to `test_stmt_budget__impl`
+#define test_stmt_budget(assertion, budget, limit, callback, ctx) {\
+ TEST_SITE(#callback);\
+ bool const failed = test_stmt_budget__impl(\
+  &test,\
+  &test_stmt_site__,\
+  assertion,\
+  budget,\
+  (double)(limit),\
+  callback,\
+  ctx\
+ );\
+ if (assertion && failed) {\
+  return;\
+ }\
+}
+#define test_expect_time_below(max_ns, callback, ctx) \
+test_stmt_budget(false, TEST_BUDGET_TIME, max_ns, callback, ctx)
+#define test_assert_time_below(max_ns, callback, ctx) \
+test_stmt_budget(true, TEST_BUDGET_TIME, max_ns, callback, ctx)
+#define test_expect_allocs_at_most(max_allocs, callback, ctx) \
+test_stmt_budget(false, TEST_BUDGET_ALLOCS, max_allocs, callback, ctx)
+#define test_assert_allocs_at_most(max_allocs, callback, ctx) \
+test_stmt_budget(true, TEST_BUDGET_ALLOCS, max_allocs, callback, ctx)
+#define test_expect_bytes_at_most(max_bytes, callback, ctx) \
+test_stmt_budget(false, TEST_BUDGET_BYTES, max_bytes, callback, ctx)
+#define test_assert_bytes_at_most(max_bytes, callback, ctx) \
+test_stmt_budget(true, TEST_BUDGET_BYTES, max_bytes, callback, ctx)
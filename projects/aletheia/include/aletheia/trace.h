@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ *timeline of a test run in the Chrome trace-event format, viewable in
+ *Perfetto or `chrome://tracing`:
+ *
+ * {"traceEvents": [
+ *  {"name": "before_all", "cat": "hook", "ph": "B", "ts": <us>, "pid": 1, "tid": 1},
+ *  {"name": "before_all", "cat": "hook", "ph": "E", "ts": <us>, "pid": 1, "tid": 1},
+ *  ...
+ * ], "displayTimeUnit": "ns"}
+ *
+ *every recording thread claims its own fixed-size ring buffer on first use,
+ *so recording an event is a clock read and a few stores, without locks or
+ *atomic read-modify-writes. Once a buffer is full, its oldest events are
+ *overwritten; slices whose begin event was lost are dropped when writing
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//maximum number of threads recording into a single trace
+#define TRACE_MAX_THREADS 64
+//default number of events kept per thread
+#define TRACE_DEFAULT_CAPACITY ((size_t)1 << 16)
+
+//opaque pointer for a trace recorder
+typedef uint8_t * trace_t;
+
+//`trace_t` functions
+char const * trace_new(trace_t * dst, size_t capacity);
+void trace_free(trace_t * trace);
+/**
+ *records the begin and end of a slice on the calling thread's timeline;
+ *`name` and `category` are not copied and must stay valid until the trace is
+ *written. Threads beyond `TRACE_MAX_THREADS` are not recorded; both are
+ *no-ops if `*trace` is `NULL`
+ */
+void trace_begin(trace_t * trace, char const * name, char const * category);
+void trace_end(trace_t * trace, char const * name, char const * category);
+//writes all recorded events to `dst`; must not race with recording threads
+char const * trace_write(trace_t * trace, FILE * dst);
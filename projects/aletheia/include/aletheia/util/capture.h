@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ *captures everything written to the `stdout` and `stderr` file descriptors
+ *into an in-memory file, so output can be kept or discarded after the fact;
+ *both streams share one buffer, in the order their writes reached it
+ */
+
+#include <stdint.h>
+
+//opaque pointer for an output capture
+typedef uint8_t * capture_t;
+
+//`capture_t` functions
+char const * capture_new(capture_t * dst);
+void capture_free(capture_t * capture);
+//flushes and redirects `stdout` and `stderr` into `capture`, dropping any
+//previously captured output
+char const * capture_start(capture_t * capture);
+/**
+ *flushes and restores `stdout` and `stderr`; if `dst` is not `NULL`, stores
+ *the output captured since `capture_start` into it as an allocated string,
+ *or `NULL` if nothing was written
+ */
+char const * capture_stop(capture_t * capture, char ** dst);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//opaque pointer for the scheduling environment of the calling thread
+typedef uint8_t * cpu_env_t;
+
+//`cpu_env_t` functions
+//snapshots the affinity and priority of the calling thread
+char const * cpu_env_new(cpu_env_t * dst);
+//restores the affinity and priority snapshotted by `cpu_env_new`
+void cpu_env_free(cpu_env_t * env);
+//pins the calling thread to the CPU it is currently running on
+char const * cpu_env_pin(cpu_env_t * env);
+//raises the priority of the calling thread as far as permitted
+char const * cpu_env_raise_priority(cpu_env_t * env);
+//CPU the calling thread is pinned to, or `-1`
+int cpu_env_get_cpu(cpu_env_t * env);
+
+//CPU the calling thread is currently running on, or `-1` if unknown
+int cpu_current(void);
+
+//frequency scaling state of a CPU, as reported by `/sys`
+typedef struct {
+ //scaling governor, e.g. `performance`; empty if unavailable
+ char governor[32];
+ //current frequency, if available
+ bool frequency_available;
+ uint64_t frequency_khz;
+ //thermal throttling events since boot, if available
+ bool throttle_available;
+ uint64_t throttle_count;
+} cpu_frequency_t;
+
+//samples the frequency scaling state of `cpu`; unavailable fields are zeroed
+void cpu_frequency_sample(int cpu, cpu_frequency_t * dst);
+
+//number of online CPUs, or `0` if unknown
+size_t cpu_count(void);
+
+//nominal frequency of the CPUs in MHz, or `0` if unknown
+double cpu_mhz(void);
+
+//1, 5 and 15 minute load averages; returns `false` if unavailable
+bool cpu_load_average(double dst[3]);
+
+//description of a CPU cache, as reported by `/sys`
+typedef struct {
+ //`Data`, `Instruction` or `Unified`
+ char type[16];
+ int level;
+ //size in bytes
+ uint64_t size;
+ //number of CPUs sharing the cache
+ size_t sharing;
+} cpu_cache_t;
+
+//describes up to `size` caches of CPU 0 in `dst`; returns the count written
+size_t cpu_caches(cpu_cache_t * dst, size_t size);
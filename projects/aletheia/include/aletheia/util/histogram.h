@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ *fixed-memory log-linear (HDR-style) histogram for latencies
+ *
+ *values below `2^HISTOGRAM_SUB_BUCKET_BITS` are recorded exactly; larger
+ *values are recorded in buckets whose width is at most `1/2^(bits - 1)` of
+ *their value, so every percentile carries a relative error below 0.8%.
+ *Histograms with the same layout can be merged by adding their buckets
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 8
+#define HISTOGRAM_SUB_BUCKET_COUNT (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKET_COUNT \
+ (HISTOGRAM_SUB_BUCKET_COUNT \
+  + (64 - HISTOGRAM_SUB_BUCKET_BITS) * (HISTOGRAM_SUB_BUCKET_COUNT / 2))
+
+typedef struct {
+ uint64_t
+  count,
+  min,
+  max;
+ double sum;
+ uint64_t buckets[HISTOGRAM_BUCKET_COUNT];
+} histogram_t;
+
+//percentiles reported for latency distributions, alongside the maximum
+#define HISTOGRAM_REPORT_PERCENTILE_COUNT 5
+extern double const histogram_report_percentiles[HISTOGRAM_REPORT_PERCENTILE_COUNT];
+
+//`histogram_t` functions
+void histogram_reset(histogram_t * histogram);
+//records `count` occurrences of `value`
+void histogram_record(histogram_t * histogram, uint64_t value, uint64_t count);
+//adds all values recorded in `src` to `dst`
+void histogram_merge(histogram_t * dst, histogram_t const * src);
+//smallest recorded value that `percentile` percent of all values are below
+uint64_t histogram_percentile(histogram_t const * histogram, double percentile);
+double histogram_mean(histogram_t const * histogram);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+//opaque pointer for a dynamically loaded shared library
+typedef uint8_t * library_t;
+
+//prototype for functions resolved from libraries; cast to the actual type
+typedef void library_function_t(void);
+
+//`library_t` functions
+/**
+ *loads the shared library at `path` with `RTLD_NOW | RTLD_LOCAL`, so its
+ *symbols do not clash with those of other builds of the same library loaded
+ *alongside it
+ *
+ *NOTE: errors include the reason reported by the dynamic loader and stay
+ *valid until the next failing `library_*` call
+ */
+char const * library_open(library_t * dst, char const * path);
+void library_free(library_t * library);
+//path the library was loaded from; owned by the library
+char const * library_get_path(library_t * library);
+char const * library_symbol(library_t * library, char const * name, void ** dst);
+char const * library_function(
+ library_t * library,
+ char const * name,
+ library_function_t ** dst
+);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//hardware and software counters sampled around benchmarks and tests
+enum perf_counter_t {
+ PERF_CYCLES = 0,
+ PERF_INSTRUCTIONS,
+ PERF_CACHE_MISSES,
+ PERF_BRANCH_MISSES,
+ PERF_CONTEXT_SWITCHES,
+ PERF_COUNTER_COUNT
+};
+
+//printable name for `counter`
+char const * perf_counter_name(enum perf_counter_t counter);
+
+//counter values; counters that could not be opened are marked unavailable
+typedef struct {
+ bool available[PERF_COUNTER_COUNT];
+ uint64_t values[PERF_COUNTER_COUNT];
+} perf_counters_t;
+
+//accumulates `src` into `dst`
+void perf_counters_add(perf_counters_t * dst, perf_counters_t const * src);
+//whether any counter in `counters` is available
+bool perf_counters_any(perf_counters_t const * counters);
+
+//opaque pointer for a group of counters measuring the calling thread
+typedef uint8_t * perf_group_t;
+
+/**
+ *opens as many counters as the host allows; fails only if none could be
+ *opened, e.g. without `perf_event_open` support or inside containers
+ */
+char const * perf_group_new(perf_group_t * dst);
+void perf_group_free(perf_group_t * group);
+//resets and enables all counters in `group`
+void perf_group_start(perf_group_t * group);
+//disables all counters in `group` and reads them, scaled for multiplexing
+void perf_group_stop(perf_group_t * group, perf_counters_t * dst);
+//disables and re-enables all counters in `group`, without resetting them
+void perf_group_pause(perf_group_t * group);
+void perf_group_resume(perf_group_t * group);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+//splitmix64 pseudo-random generator; a single word of state, fast, and good
+//enough for test data
+typedef struct {
+ uint64_t state;
+} random_t;
+
+void random_seed(random_t * random, uint64_t seed);
+uint64_t random_next(random_t * random);
+//uniform value in `[0, bound)`; `bound` must not be `0`
+uint64_t random_below(random_t * random, uint64_t bound);
+//splitmix64 finalizer; decorrelates related values such as `seed + i`
+uint64_t random_mix(uint64_t value);
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+//summary statistics for a set of samples
+typedef struct {
+ size_t count;
+ double
+  mean,
+  median,
+  //sample standard deviation
+  stddev,
+  //median absolute deviation from the median
+  mad,
+  min,
+  max;
+} stats_summary_t;
+
+//sorts `samples` in place, in ascending order
+void stats_sort(double * samples, size_t count);
+
+//median of `count` sorted samples
+double stats_sorted_median(double const * sorted, size_t count);
+
+/**
+ *computes summary statistics for `count` samples
+ *
+ *NOTE: does not modify `samples`; returns `false` if scratch space could not
+ *be allocated
+ */
+bool stats_summarize(
+ double const * samples,
+ size_t count,
+ stats_summary_t * dst
+);
+
+//result of a two-sided Mann-Whitney U test
+typedef struct {
+ //U statistic for the first sample set
+ double u;
+ //normal approximation of U, with tie and continuity correction
+ double z;
+ //two-sided p-value
+ double p;
+} stats_mann_whitney_t;
+
+/**
+ *compares two independent sample sets without assuming normality; a
+ *positive `z` means values in `b` tend to be larger than values in `a`
+ *
+ *NOTE: returns `false` if scratch space could not be allocated
+ */
+bool stats_mann_whitney_u(
+ double const * a,
+ size_t a_count,
+ double const * b,
+ size_t b_count,
+ stats_mann_whitney_t * dst
+);
+
+//confidence interval for the median of a sample set
+typedef struct {
+ double
+  lower,
+  upper;
+ //confidence actually achieved; order statistics only allow discrete levels
+ double confidence;
+} stats_interval_t;
+
+/**
+ *distribution-free confidence interval for the median of `count` sorted
+ *samples, bounded by order statistics chosen from the binomial distribution;
+ *picks the narrowest interval with at least `confidence`
+ *
+ *NOTE: returns `false`, with the full range of the samples in `dst`, if there
+ *are too few samples to reach `confidence`
+ */
+bool stats_median_interval(
+ double const * sorted,
+ size_t count,
+ double confidence,
+ stats_interval_t * dst
+);
+
+/**
+ *Hodges-Lehmann confidence interval for the shift from sample set `a` to
+ *`b`, i.e. for the median of all differences `b[j] - a[i]`, bounded by the
+ *differences the normal approximation of the Mann-Whitney U distribution
+ *allows; picks the narrowest interval with at least `confidence`
+ *
+ *NOTE: returns `false` if scratch space could not be allocated; with too few
+ *samples to reach `confidence`, `dst` spans all differences and reports the
+ *lower confidence achieved
+ */
+bool stats_shift_interval(
+ double const * a,
+ size_t a_count,
+ double const * b,
+ size_t b_count,
+ double confidence,
+ stats_interval_t * dst
+);
+
+//asymptotic complexity models, in order of growth
+enum stats_complexity_t {
+ STATS_COMPLEXITY_1,
+ STATS_COMPLEXITY_LOG_N,
+ STATS_COMPLEXITY_N,
+ STATS_COMPLEXITY_N_LOG_N,
+ STATS_COMPLEXITY_N_SQUARED,
+ STATS_COMPLEXITY_COUNT
+};
+
+//display name for a complexity model, e.g. `O(n log n)`
+char const * stats_complexity_name(enum stats_complexity_t complexity);
+
+//result of fitting measurements to a complexity model
+typedef struct {
+ enum stats_complexity_t complexity;
+ //`c` in `y = c * f(n)`
+ double coefficient;
+ //root mean square of the relative errors of the fit
+ double rms;
+} stats_complexity_fit_t;
+
+/**
+ *fits `count` measurements `y` at problem sizes `n` to every complexity model,
+ *minimizing relative error, and stores the best fitting model in `dst`
+ *
+ *NOTE: non-positive measurements are ignored; returns `false` if there are
+ *fewer than two positive measurements
+ */
+bool stats_fit_complexity(
+ double const * n,
+ double const * y,
+ size_t count,
+ stats_complexity_fit_t * dst
+);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+//monotonic wall clock timestamp, in nanoseconds
+uint64_t time_now_ns(void);
+
+//cpu time consumed by the calling thread, in nanoseconds
+uint64_t time_thread_cpu_ns(void);
+
+//estimated cost of a single `time_now_ns` call, in nanoseconds
+uint64_t time_now_overhead_ns(void);
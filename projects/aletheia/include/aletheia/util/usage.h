@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//wall time and resource usage of the calling thread
+typedef struct {
+ uint64_t
+  wall_ns,
+  user_ns,
+  sys_ns,
+  //maximum resident set size of the process, in kilobytes
+  max_rss_kb,
+  minor_faults,
+  major_faults;
+} usage_t;
+
+//samples the current wall clock and resource usage of the calling thread
+void usage_sample(usage_t * dst);
+/**
+ *usage between samples `start` and `end`; since the maximum resident set size
+ *never shrinks, its difference is how far the region raised it
+ */
+void usage_delta(usage_t const * start, usage_t const * end, usage_t * dst);
+//accumulates `src` into `dst`
+void usage_add(usage_t * dst, usage_t const * src);
+//whether any value in `usage` is non-zero
+bool usage_any(usage_t const * usage);
@@ -0,0 +1,87 @@
+/*allocation interposer for `<aletheia/alloc.h>`; link this object into a test
+ *executable to count every `malloc()` family call made by the code under test
+ *
+ *NOTE: forwards to glibc's `__libc_*` entry points, so it never recurses and
+ *needs no `dlsym()` bootstrap
+ */
+#define _GNU_SOURCE
+
+#include <aletheia/alloc.h>
+
+#include <stddef.h>
+#include <errno.h>
+#include <malloc.h>
+
+#ifndef __GLIBC__
+ #error "The aletheia allocation interposer requires glibc"
+#endif
+
+//glibc entry points
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t count, size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+extern void * __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void * ptr);
+
+//utility function; `site` is the return address of the interposed call
+static void * alloc_interpose_track(void * ptr, size_t size, void const * site) {
+ if (ptr) {
+  alloc_tracking_on_alloc(size, malloc_usable_size(ptr));
+  alloc_leaks_on_alloc(ptr, size, site);
+ }
+ return ptr;
+}
+
+//utility macro
+#define ALLOC_INTERPOSE_SITE __builtin_return_address(0)
+
+void * malloc(size_t size) {
+ return alloc_interpose_track(__libc_malloc(size), size, ALLOC_INTERPOSE_SITE);
+}
+
+void * calloc(size_t count, size_t size) {
+ return alloc_interpose_track(__libc_calloc(count, size), count * size, ALLOC_INTERPOSE_SITE);
+}
+
+void * realloc(void * ptr, size_t size) {
+ //a reallocation counts as a free of the old block and a new allocation
+ size_t const old_size = ptr ? malloc_usable_size(ptr) : 0;
+ void * result = __libc_realloc(ptr, size);
+ if (ptr && (result || !size)) {
+  alloc_tracking_on_free(old_size);
+  alloc_leaks_on_free(ptr);
+ }
+ return alloc_interpose_track(result, size, ALLOC_INTERPOSE_SITE);
+}
+
+void free(void * ptr) {
+ if (ptr) {
+  alloc_tracking_on_free(malloc_usable_size(ptr));
+  alloc_leaks_on_free(ptr);
+ }
+ __libc_free(ptr);
+}
+
+void * memalign(size_t alignment, size_t size) {
+ return alloc_interpose_track(__libc_memalign(alignment, size), size, ALLOC_INTERPOSE_SITE);
+}
+
+void * aligned_alloc(size_t alignment, size_t size) {
+ return alloc_interpose_track(__libc_memalign(alignment, size), size, ALLOC_INTERPOSE_SITE);
+}
+
+int posix_memalign(void ** dst, size_t alignment, size_t size) {
+ if (!alignment || alignment % sizeof(void *) || (alignment & (alignment - 1))) {
+  return EINVAL;
+ }
+ void * result = alloc_interpose_track(
+  __libc_memalign(alignment, size),
+  size,
+  ALLOC_INTERPOSE_SITE
+ );
+ if (!result) {
+  return ENOMEM;
+ }
+ *dst = result;
+ return 0;
+}
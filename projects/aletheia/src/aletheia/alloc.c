@@ -0,0 +1,251 @@
+#include <aletheia/alloc.h>
+
+#include <string.h>
+
+/*NOTE: hooks run inside `malloc()`/`free()` of any thread, so all state is
+ *updated with relaxed atomics and nothing here may allocate
+ */
+
+//accounting state
+static struct {
+ bool interposed;
+ int enabled;
+ uint64_t
+  allocs,
+  frees,
+  bytes;
+ int64_t
+  live_bytes,
+  peak_bytes;
+} alloc_tracking;
+
+/*suspensions of the calling thread, so that framework bookkeeping on one
+ *thread does not hide allocations of the code under test on others; the
+ *initial-exec model keeps TLS access from allocating inside the hooks
+ */
+static __thread int alloc_tracking_suspended __attribute__((tls_model("initial-exec"))) = 0;
+
+//utility macros
+#define ALLOC_LOAD(value) __atomic_load_n(&(value), __ATOMIC_RELAXED)
+#define ALLOC_STORE(value, n) __atomic_store_n(&(value), n, __ATOMIC_RELAXED)
+#define ALLOC_ADD(value, n) __atomic_add_fetch(&(value), n, __ATOMIC_RELAXED)
+
+//`alloc_stats_add` implementation
+void alloc_stats_add(alloc_stats_t * dst, alloc_stats_t const * src) {
+ dst->allocs += src->allocs;
+ dst->frees += src->frees;
+ dst->bytes += src->bytes;
+ if (src->peak_bytes > dst->peak_bytes) {
+  dst->peak_bytes = src->peak_bytes;
+ }
+}
+
+//`alloc_tracking_available` implementation
+bool alloc_tracking_available(void) {
+ return ALLOC_LOAD(alloc_tracking.interposed);
+}
+
+//`alloc_tracking_start` implementation
+void alloc_tracking_start(void) {
+ ALLOC_STORE(alloc_tracking.allocs, 0);
+ ALLOC_STORE(alloc_tracking.frees, 0);
+ ALLOC_STORE(alloc_tracking.bytes, 0);
+ ALLOC_STORE(alloc_tracking.live_bytes, 0);
+ ALLOC_STORE(alloc_tracking.peak_bytes, 0);
+ alloc_tracking_suspended = 0;
+ ALLOC_STORE(alloc_tracking.enabled, 1);
+}
+
+//`alloc_tracking_stop` implementation
+void alloc_tracking_stop(alloc_stats_t * dst) {
+ ALLOC_STORE(alloc_tracking.enabled, 0);
+ int64_t const peak = ALLOC_LOAD(alloc_tracking.peak_bytes);
+ *dst = (alloc_stats_t) {
+  .allocs = ALLOC_LOAD(alloc_tracking.allocs),
+  .frees = ALLOC_LOAD(alloc_tracking.frees),
+  .bytes = ALLOC_LOAD(alloc_tracking.bytes),
+  .peak_bytes = peak > 0 ? (uint64_t)peak : 0
+ };
+}
+
+//`alloc_tracking_suspend` implementation
+void alloc_tracking_suspend(void) {
+ alloc_tracking_suspended++;
+}
+
+//`alloc_tracking_resume` implementation
+void alloc_tracking_resume(void) {
+ alloc_tracking_suspended--;
+}
+
+//`alloc_tracking_save` implementation
+void alloc_tracking_save(alloc_tracking_state_t * dst) {
+ dst->enabled = ALLOC_LOAD(alloc_tracking.enabled);
+ ALLOC_STORE(alloc_tracking.enabled, 0);
+ dst->suspended = alloc_tracking_suspended;
+ dst->live_bytes = ALLOC_LOAD(alloc_tracking.live_bytes);
+ int64_t const peak = ALLOC_LOAD(alloc_tracking.peak_bytes);
+ dst->stats = (alloc_stats_t) {
+  .allocs = ALLOC_LOAD(alloc_tracking.allocs),
+  .frees = ALLOC_LOAD(alloc_tracking.frees),
+  .bytes = ALLOC_LOAD(alloc_tracking.bytes),
+  .peak_bytes = peak > 0 ? (uint64_t)peak : 0
+ };
+}
+
+//`alloc_tracking_restore` implementation
+void alloc_tracking_restore(alloc_tracking_state_t const * src) {
+ ALLOC_STORE(alloc_tracking.allocs, src->stats.allocs);
+ ALLOC_STORE(alloc_tracking.frees, src->stats.frees);
+ ALLOC_STORE(alloc_tracking.bytes, src->stats.bytes);
+ ALLOC_STORE(alloc_tracking.live_bytes, src->live_bytes);
+ ALLOC_STORE(alloc_tracking.peak_bytes, (int64_t)src->stats.peak_bytes);
+ alloc_tracking_suspended = src->suspended;
+ ALLOC_STORE(alloc_tracking.enabled, src->enabled ? 1 : 0);
+}
+
+//utility function for hooks
+static bool alloc_tracking_counting(void) {
+ return ALLOC_LOAD(alloc_tracking.enabled) && !alloc_tracking_suspended;
+}
+
+//`alloc_tracking_on_alloc` implementation
+void alloc_tracking_on_alloc(size_t size, size_t usable_size) {
+ if (!ALLOC_LOAD(alloc_tracking.interposed)) {
+  ALLOC_STORE(alloc_tracking.interposed, true);
+ }
+ if (!alloc_tracking_counting()) {
+  return;
+ }
+ ALLOC_ADD(alloc_tracking.allocs, 1);
+ ALLOC_ADD(alloc_tracking.bytes, size);
+
+ //raise peak if needed
+ int64_t const live = ALLOC_ADD(alloc_tracking.live_bytes, (int64_t)usable_size);
+ int64_t peak = ALLOC_LOAD(alloc_tracking.peak_bytes);
+ while (live > peak && !__atomic_compare_exchange_n(
+  &alloc_tracking.peak_bytes,
+  &peak,
+  live,
+  true,
+  __ATOMIC_RELAXED,
+  __ATOMIC_RELAXED
+ )) {}
+}
+
+//`alloc_tracking_on_free` implementation
+void alloc_tracking_on_free(size_t usable_size) {
+ if (!alloc_tracking_counting()) {
+  return;
+ }
+ ALLOC_ADD(alloc_tracking.frees, 1);
+ ALLOC_ADD(alloc_tracking.live_bytes, -(int64_t)usable_size);
+}
+
+//live block table for leak checks; linear probing with backward shift
+//deletion, so removals leave no tombstones behind
+static struct {
+ int enabled;
+ bool lock;
+ bool overflowed;
+ size_t count;
+ alloc_block_t blocks[ALLOC_LEAKS_CAPACITY];
+} alloc_leaks;
+
+//utility functions for the live block table
+static void alloc_leaks_lock(void) {
+ while (__atomic_test_and_set(&alloc_leaks.lock, __ATOMIC_ACQUIRE)) {}
+}
+
+static void alloc_leaks_unlock(void) {
+ __atomic_clear(&alloc_leaks.lock, __ATOMIC_RELEASE);
+}
+
+static size_t alloc_leaks_slot(void const * ptr) {
+ //blocks are at least 16-byte aligned; mix the remaining bits
+ uint64_t const hash = ((uint64_t)(uintptr_t)ptr >> 4) * UINT64_C(0x9e3779b97f4a7c15);
+ return (size_t)(hash >> 32) & (ALLOC_LEAKS_CAPACITY - 1);
+}
+
+//`alloc_leaks_start` implementation
+void alloc_leaks_start(void) {
+ alloc_leaks_lock();
+ alloc_leaks.overflowed = false;
+ ALLOC_STORE(alloc_leaks.enabled, 1);
+ alloc_leaks_unlock();
+}
+
+//`alloc_leaks_stop` implementation
+size_t alloc_leaks_stop(alloc_block_t * dst, size_t capacity, bool * overflowed) {
+ alloc_leaks_lock();
+ ALLOC_STORE(alloc_leaks.enabled, 0);
+ size_t const count = alloc_leaks.count;
+ *overflowed = alloc_leaks.overflowed;
+
+ //the table is only scanned, and cleared, if anything leaked
+ size_t copied = 0;
+ for (size_t i = 0; alloc_leaks.count && i < ALLOC_LEAKS_CAPACITY; i++) {
+  alloc_block_t * block = alloc_leaks.blocks + i;
+  if (!block->ptr) {
+   continue;
+  }
+  if (copied < capacity) {
+   dst[copied++] = *block;
+  }
+  block->ptr = NULL;
+  alloc_leaks.count--;
+ }
+ alloc_leaks_unlock();
+ return count;
+}
+
+//`alloc_leaks_on_alloc` implementation
+void alloc_leaks_on_alloc(void const * ptr, size_t size, void const * site) {
+ if (!ptr || !ALLOC_LOAD(alloc_leaks.enabled) || alloc_tracking_suspended) {
+  return;
+ }
+ alloc_leaks_lock();
+ if (alloc_leaks.count + 1 >= ALLOC_LEAKS_CAPACITY) {
+  alloc_leaks.overflowed = true;
+ } else {
+  size_t slot = alloc_leaks_slot(ptr);
+  while (alloc_leaks.blocks[slot].ptr) {
+   slot = (slot + 1) & (ALLOC_LEAKS_CAPACITY - 1);
+  }
+  alloc_leaks.blocks[slot] = (alloc_block_t) {ptr, size, site};
+  alloc_leaks.count++;
+ }
+ alloc_leaks_unlock();
+}
+
+//`alloc_leaks_on_free` implementation
+void alloc_leaks_on_free(void const * ptr) {
+ if (!ptr || !ALLOC_LOAD(alloc_leaks.enabled)) {
+  return;
+ }
+ alloc_leaks_lock();
+
+ //find block; blocks allocated before the region are not recorded
+ size_t const mask = ALLOC_LEAKS_CAPACITY - 1;
+ size_t slot = alloc_leaks_slot(ptr);
+ while (alloc_leaks.blocks[slot].ptr && alloc_leaks.blocks[slot].ptr != ptr) {
+  slot = (slot + 1) & mask;
+ }
+ if (!alloc_leaks.blocks[slot].ptr) {
+  alloc_leaks_unlock();
+  return;
+ }
+
+ //shift back every following block that may not stay behind the hole
+ size_t hole = slot;
+ for (size_t next = (hole + 1) & mask; alloc_leaks.blocks[next].ptr; next = (next + 1) & mask) {
+  size_t const home = alloc_leaks_slot(alloc_leaks.blocks[next].ptr);
+  if (((next - home) & mask) >= ((next - hole) & mask)) {
+   alloc_leaks.blocks[hole] = alloc_leaks.blocks[next];
+   hole = next;
+  }
+ }
+ alloc_leaks.blocks[hole].ptr = NULL;
+ alloc_leaks.count--;
+ alloc_leaks_unlock();
+}
@@ -0,0 +1,292 @@
+#include <aletheia/baseline.h>
+#include <aletheia/results.h>
+#include <aletheia/test.h>
+#include <aletheia/util/string.h>
+#include <aletheia/util/stats.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+//single baseline entry
+typedef struct {
+ char const * name;
+ size_t sample_count;
+ double * samples;
+} bench_baseline_entry_t;
+
+//`bench_baseline_t` implementation
+typedef struct {
+ size_t
+  entry_count,
+  entry_size;
+ bench_baseline_entry_t * entries;
+} bench_baseline_impl_t;
+
+//utility function
+static bench_baseline_impl_t * bench_baseline_get_impl(
+ bench_baseline_t * baseline
+) {
+ return (bench_baseline_impl_t *)*baseline;
+}
+
+//utility function for `bench_baseline_load`
+static bool bench_baseline_grow_if_needed(bench_baseline_impl_t * impl) {
+ if (impl->entry_count + 1 <= impl->entry_size) {
+  return true;
+ }
+ size_t const new_size = impl->entry_size ? impl->entry_size * 2 : 8;
+ bench_baseline_entry_t * grown = realloc(
+  impl->entries,
+  sizeof(bench_baseline_entry_t) * new_size
+ );
+ if (!grown) {
+  return false;
+ }
+ impl->entries = grown;
+ impl->entry_size = new_size;
+ return true;
+}
+
+//utility function for `bench_baseline_load` and `bench_baseline_find`
+static int bench_baseline_entry_compare(void const * a, void const * b) {
+ return strcmp(
+  ((bench_baseline_entry_t const *)a)->name,
+  ((bench_baseline_entry_t const *)b)->name
+ );
+}
+
+//`bench_baseline_load` implementation
+char const * bench_baseline_load(bench_baseline_t * dst, FILE * file) {
+ *dst = NULL;
+
+ bench_baseline_impl_t * impl = calloc(1, sizeof(bench_baseline_impl_t));
+ if (!impl) {
+  return "Failed to allocate space for benchmark baseline!";
+ }
+ *dst = (bench_baseline_t)impl;
+
+ test_results_reader_t reader;
+ char const * error = test_results_reader_new(&reader, file);
+ if (error) {
+  bench_baseline_free(dst);
+  return error;
+ }
+
+ //collect samples of every `bench` record
+ while (!error) {
+  test_results_record_t record;
+  bool done = false;
+  error = test_results_reader_next(&reader, &record, &done);
+  if (error || done) {
+   break;
+  }
+  if (strcmp(record.fields[0], "bench") != 0) {
+   test_results_record_free(&record);
+   continue;
+  }
+  if (!bench_baseline_grow_if_needed(impl)) {
+   test_results_record_free(&record);
+   error = "Failed to grow benchmark baseline!";
+   break;
+  }
+  bench_baseline_entry_t * entry = impl->entries + impl->entry_count;
+  error = test_results_record_get_samples(
+   &record,
+   &entry->sample_count,
+   &entry->samples
+  );
+  if (!error) {
+   //TODO: handle `string_format` failure
+   entry->name = string_format("%s", record.fields[1]);
+   impl->entry_count++;
+  }
+  test_results_record_free(&record);
+ }
+ test_results_reader_free(&reader);
+
+ if (error) {
+  bench_baseline_free(dst);
+  return error;
+ }
+
+ //result files are sorted, but merged baselines need not be
+ qsort(
+  impl->entries,
+  impl->entry_count,
+  sizeof(bench_baseline_entry_t),
+  bench_baseline_entry_compare
+ );
+
+ return NULL;
+}
+
+//`bench_baseline_free` implementation
+void bench_baseline_free(bench_baseline_t * baseline) {
+ if (!baseline || !*baseline) {
+  return;
+ }
+
+ //zero destination
+ bench_baseline_impl_t * impl = bench_baseline_get_impl(baseline);
+ *baseline = NULL;
+
+ //free entries
+ for (size_t i = 0; i < impl->entry_count; i++) {
+  free((void *)impl->entries[i].name);
+  free((void *)impl->entries[i].samples);
+ }
+ free((void *)impl->entries);
+ free((void *)impl);
+}
+
+//utility function for `bench_baseline_compare_and_emit`
+static bench_baseline_entry_t const * bench_baseline_find(
+ bench_baseline_impl_t * impl,
+ char const * name
+) {
+ bench_baseline_entry_t const key = {
+  .name = name,
+  .sample_count = 0,
+  .samples = NULL
+ };
+ return bsearch(
+  &key,
+  impl->entries,
+  impl->entry_count,
+  sizeof(bench_baseline_entry_t),
+  bench_baseline_entry_compare
+ );
+}
+
+//utility function for `bench_baseline_compare_and_emit`; returns true on regression
+static bool bench_baseline_compare_one(
+ bench_baseline_entry_t const * entry,
+ char const * name,
+ double const * samples,
+ size_t sample_count,
+ bench_baseline_config_t const * config
+) {
+ stats_summary_t before, after;
+ stats_mann_whitney_t test;
+ stats_interval_t shift;
+ double const confidence = 1.0 - config->alpha;
+ if (
+  !stats_summarize(entry->samples, entry->sample_count, &before)
+  || !stats_summarize(samples, sample_count, &after)
+  || !stats_mann_whitney_u(
+   entry->samples,
+   entry->sample_count,
+   samples,
+   sample_count,
+   &test
+  )
+  || !stats_shift_interval(
+   entry->samples,
+   entry->sample_count,
+   samples,
+   sample_count,
+   confidence,
+   &shift
+  )
+ ) {
+  handle_internal_failure("Failed to allocate space for statistics!", __func__);
+ }
+
+ double const delta = before.median > 0.0
+  ? (after.median - before.median) / before.median * 100.0
+  : 0.0;
+ bool const significant = test.p < config->alpha;
+
+ //only changes that are both significant and large enough count
+ char const * verdict = "same";
+ bool regression = false;
+ if (significant && delta >= config->threshold_percent) {
+  verdict = "REGRESSION";
+  regression = true;
+ } else if (significant && -delta >= config->threshold_percent) {
+  verdict = "improvement";
+ } else if (significant) {
+  verdict = "same (below threshold)";
+ }
+
+ //interval for the shift of the median, relative to the baseline median
+ char interval[32] = "n/a";
+ if (before.median > 0.0 && shift.confidence >= confidence) {
+  snprintf(
+   interval,
+   sizeof(interval),
+   "[%+.2f%%, %+.2f%%]",
+   shift.lower / before.median * 100.0,
+   shift.upper / before.median * 100.0
+  );
+ }
+
+ printf(
+  "%-40s %12.2f %12.2f %+8.2f%% %-20s %8.4f  %s\n",
+  name,
+  before.median,
+  after.median,
+  delta,
+  interval,
+  test.p,
+  verdict
+ );
+ return regression;
+}
+
+//`bench_baseline_compare_and_emit` implementation
+size_t bench_baseline_compare_and_emit(
+ bench_baseline_t * baseline,
+ bench_suite_t * suite,
+ bench_baseline_config_t config
+) {
+ bench_baseline_impl_t * impl = bench_baseline_get_impl(baseline);
+ size_t regressions = 0;
+
+ size_t count = 0;
+ bench_t * benches = NULL;
+ handle_internal_failure(
+  bench_suite_get_benches(suite, &count, &benches),
+  __func__
+ );
+
+ char interval_title[32];
+ snprintf(interval_title, sizeof(interval_title), "%g%% interval", (1.0 - config.alpha) * 100.0);
+ printf(
+  "%-40s %12s %12s %9s %-20s %8s  %s\n",
+  "benchmark (median ns/iter)",
+  "baseline",
+  "current",
+  "delta",
+  interval_title,
+  "p-value",
+  "verdict"
+ );
+ for (size_t i = 0; i < count; i++) {
+  char const * name = NULL;
+  size_t sample_count = 0;
+  double * samples = NULL;
+  handle_internal_failure(bench_get_name(benches + i, &name), __func__);
+  handle_internal_failure(
+   bench_get_samples(benches + i, &sample_count, &samples),
+   __func__
+  );
+
+  bench_baseline_entry_t const * entry = bench_baseline_find(impl, name);
+  if (!sample_count) {
+   printf("%-40s not run\n", name);
+  } else if (!entry || !entry->sample_count) {
+   printf("%-40s not in baseline\n", name);
+  } else if (bench_baseline_compare_one(entry, name, samples, sample_count, &config)) {
+   regressions++;
+  }
+
+  free((void *)samples);
+  free((void *)name);
+  bench_free(benches + i);
+ }
+ free((void *)benches);
+
+ return regressions;
+}
@@ -0,0 +1,2668 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <aletheia/bench.h>
+#include <aletheia/test.h>
+#include <aletheia/util/string.h>
+#include <aletheia/util/stats.h>
+#include <aletheia/util/time.h>
+#include <aletheia/util/cpu.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <pthread.h>
+
+//upper bound for calibrated iteration counts
+#define BENCH_MAX_ITERATIONS UINT64_C(1000000000)
+
+//warmup has converged once this many consecutive runs are within tolerance
+#define BENCH_CONVERGE_WINDOW 3
+#define BENCH_CONVERGE_TOLERANCE 0.02
+//upper bound for warmup runs while waiting for convergence
+#define BENCH_CONVERGE_MAX_RUNS 30
+//duration of the empty loop runs that determine the floor for plausible timings
+#define BENCH_FLOOR_TIME_NS UINT64_C(1000000)
+//results within this ratio of the empty loop are flagged as too fast
+#define BENCH_FLOOR_RATIO 1.1
+//coefficient of variation and frequency change beyond which results are flagged
+#define BENCH_UNSTABLE_CV 0.05
+#define BENCH_UNSTABLE_FREQUENCY_CHANGE 0.05
+
+//busy-wait hint for the start barrier of threaded benchmarks
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define BENCH_SPIN_PAUSE() __builtin_ia32_pause()
+#else
+ #define BENCH_SPIN_PAUSE() ((void)0)
+#endif
+
+//`bench_escape_sink` definition
+void const * volatile bench_escape_sink = NULL;
+
+//`bench_clobber_fallback` implementation
+void bench_clobber_fallback(void) {
+ //an out-of-line call is a compiler barrier by itself; the volatile read
+ //keeps it from being discarded as side-effect free
+ (void)bench_escape_sink;
+}
+
+//`bench_unstable_name` implementation
+char const * bench_unstable_name(enum bench_unstable_t reason) {
+ switch (reason) {
+  case BENCH_UNSTABLE_WARMUP: return "warmup";
+  case BENCH_UNSTABLE_VARIANCE: return "variance";
+  case BENCH_UNSTABLE_FREQUENCY: return "frequency";
+  case BENCH_UNSTABLE_THROTTLED: return "throttled";
+  default: return "unknown";
+ }
+}
+
+//shared state for the threads of one threaded callback run
+typedef struct {
+ size_t thread_count;
+ //spin barrier; the last thread to arrive releases all others
+ size_t arrived;
+ bool released;
+ //allocations are counted from release until the last thread finishes
+ size_t finished;
+ bool alloc_tracking;
+ alloc_stats_t allocs;
+} bench_threads_t;
+
+//utility function; waits until all threads are ready to start timing
+static void bench_threads_arrive(bench_threads_t * threads) {
+ size_t const arrived = __atomic_add_fetch(&threads->arrived, 1, __ATOMIC_ACQ_REL);
+ if (arrived == threads->thread_count) {
+  if (threads->alloc_tracking) {
+   alloc_tracking_start();
+  }
+  __atomic_store_n(&threads->released, true, __ATOMIC_RELEASE);
+  return;
+ }
+ while (!__atomic_load_n(&threads->released, __ATOMIC_ACQUIRE)) {
+  BENCH_SPIN_PAUSE();
+ }
+}
+
+//utility function; counts finished threads, the last one stops tracking
+static void bench_threads_depart(bench_threads_t * threads) {
+ size_t const finished = __atomic_add_fetch(&threads->finished, 1, __ATOMIC_ACQ_REL);
+ if (finished == threads->thread_count && threads->alloc_tracking) {
+  alloc_tracking_stop(&threads->allocs);
+ }
+}
+
+//user counters set by one run of a benchmark callback
+typedef struct {
+ size_t count;
+ char const * names[BENCH_MAX_COUNTERS];
+ double values[BENCH_MAX_COUNTERS];
+} bench_user_counters_t;
+
+//utility function; index of counter `name` in `counters`, added if missing
+static size_t bench_user_counters_find(bench_user_counters_t * counters, char const * name) {
+ for (size_t i = 0; i < counters->count; i++) {
+  if (strcmp(counters->names[i], name) == 0) {
+   return i;
+  }
+ }
+ if (counters->count == BENCH_MAX_COUNTERS) {
+  return BENCH_MAX_COUNTERS;
+ }
+ counters->names[counters->count] = name;
+ counters->values[counters->count] = 0.0;
+ return counters->count++;
+}
+
+//utility function; sums `src` into `dst`
+static void bench_user_counters_add(bench_user_counters_t * dst, bench_user_counters_t const * src) {
+ for (size_t i = 0; i < src->count; i++) {
+  size_t const index = bench_user_counters_find(dst, src->names[i]);
+  if (index < BENCH_MAX_COUNTERS) {
+   dst->values[index] += src->values[i];
+  }
+ }
+}
+
+//`bench_state_t` implementation
+typedef struct {
+ //iterations requested for, and remaining in, the current callback run
+ uint64_t
+  iterations,
+  remaining;
+ //timing for the current callback run
+ uint64_t
+  start_ns,
+  end_ns,
+  elapsed_ns,
+  cpu_start_ns,
+  cpu_elapsed_ns;
+ bool
+  started,
+  finished;
+ //time excluded by `bench_state_pause_timing`, and the cost of a timestamp
+ bool paused;
+ uint64_t
+  pause_start_ns,
+  paused_ns,
+  overhead_ns;
+ //counters set by the callback
+ bench_user_counters_t user_counters;
+ //threads of a threaded run, if any
+ bench_threads_t * threads;
+ size_t
+  thread_index,
+  thread_count;
+ //counters sampled around the loop, if any
+ perf_group_t * perf;
+ perf_counters_t counters;
+ //allocations made by the loop, if tracked
+ bool alloc_tracking;
+ alloc_stats_t allocs;
+ //per-iteration latencies of every batch, if recorded
+ histogram_t * latency;
+ uint64_t
+  batch,
+  batch_remaining,
+  batch_start_ns,
+  batch_paused_ns;
+ //arguments of the running instance
+ size_t arg_count;
+ int64_t const * args;
+} bench_state_impl_t;
+
+//utility function
+static bench_state_impl_t * bench_state_get_impl(bench_state_t * state) {
+ return (bench_state_impl_t *)*state;
+}
+
+//utility function; `elapsed_ns` without `paused_ns`, clamped at `0`
+static uint64_t bench_state_unpaused_ns(uint64_t elapsed_ns, uint64_t paused_ns) {
+ return elapsed_ns > paused_ns ? elapsed_ns - paused_ns : 0;
+}
+
+//`bench_state_pause_timing` implementation
+void bench_state_pause_timing(bench_state_t * state) {
+ bench_state_impl_t * state_impl = bench_state_get_impl(state);
+ //only the measured loop can be paused
+ if (!state_impl->started || state_impl->finished || state_impl->paused) {
+  return;
+ }
+ state_impl->paused = true;
+ state_impl->pause_start_ns = time_now_ns();
+ if (state_impl->perf) {
+  perf_group_pause(state_impl->perf);
+ }
+ if (state_impl->alloc_tracking) {
+  alloc_tracking_suspend();
+ }
+}
+
+//`bench_state_resume_timing` implementation
+void bench_state_resume_timing(bench_state_t * state) {
+ bench_state_impl_t * state_impl = bench_state_get_impl(state);
+ if (!state_impl->paused) {
+  return;
+ }
+ if (state_impl->alloc_tracking) {
+  alloc_tracking_resume();
+ }
+ if (state_impl->perf) {
+  perf_group_resume(state_impl->perf);
+ }
+ //the measured region still contains about one timestamp per pause
+ uint64_t const paused_ns = time_now_ns() - state_impl->pause_start_ns
+  + state_impl->overhead_ns;
+ state_impl->paused_ns += paused_ns;
+ state_impl->batch_paused_ns += paused_ns;
+ state_impl->paused = false;
+}
+
+//utility function for `bench_state_keep_running`; first and last iteration
+static bool bench_state_keep_running_slow(bench_state_impl_t * state_impl) {
+ //start timing on the first call
+ if (!state_impl->started) {
+  state_impl->started = true;
+  if (state_impl->threads) {
+   bench_threads_arrive(state_impl->threads);
+  }
+  if (state_impl->alloc_tracking) {
+   alloc_tracking_start();
+  }
+  if (state_impl->perf) {
+   perf_group_start(state_impl->perf);
+  }
+  state_impl->cpu_start_ns = time_thread_cpu_ns();
+  state_impl->start_ns = time_now_ns();
+  state_impl->batch_start_ns = state_impl->start_ns;
+  state_impl->batch_remaining = state_impl->batch;
+  state_impl->batch_paused_ns = 0;
+ }
+
+ if (state_impl->remaining) {
+  //close the current batch before starting the next one
+  if (state_impl->latency && !state_impl->batch_remaining) {
+   uint64_t const now_ns = time_now_ns();
+   histogram_record(
+    state_impl->latency,
+    bench_state_unpaused_ns(
+     now_ns - state_impl->batch_start_ns,
+     state_impl->batch_paused_ns
+    ) / state_impl->batch,
+    state_impl->batch
+   );
+   state_impl->batch_start_ns = now_ns;
+   state_impl->batch_remaining = state_impl->batch;
+   state_impl->batch_paused_ns = 0;
+  }
+  state_impl->batch_remaining--;
+  state_impl->remaining--;
+  return true;
+ }
+
+ //stop timing once all iterations have run
+ if (!state_impl->finished) {
+  //a loop left paused ends its paused region here
+  bench_state_t state = (bench_state_t)state_impl;
+  bench_state_resume_timing(&state);
+  uint64_t const now_ns = time_now_ns();
+  state_impl->end_ns = now_ns;
+  state_impl->elapsed_ns = bench_state_unpaused_ns(
+   now_ns - state_impl->start_ns,
+   state_impl->paused_ns
+  );
+  //paused regions are assumed to run on the cpu throughout
+  state_impl->cpu_elapsed_ns = bench_state_unpaused_ns(
+   time_thread_cpu_ns() - state_impl->cpu_start_ns,
+   state_impl->paused_ns
+  );
+  //record the trailing, possibly partial, batch
+  uint64_t const batched = state_impl->batch - state_impl->batch_remaining;
+  if (state_impl->latency && batched) {
+   histogram_record(
+    state_impl->latency,
+    bench_state_unpaused_ns(
+     now_ns - state_impl->batch_start_ns,
+     state_impl->batch_paused_ns
+    ) / batched,
+    batched
+   );
+  }
+  if (state_impl->perf) {
+   perf_group_stop(state_impl->perf, &state_impl->counters);
+  }
+  if (state_impl->alloc_tracking) {
+   alloc_tracking_stop(&state_impl->allocs);
+  }
+  if (state_impl->threads) {
+   bench_threads_depart(state_impl->threads);
+  }
+  state_impl->finished = true;
+ }
+ return false;
+}
+
+//`bench_state_keep_running` implementation
+bool bench_state_keep_running(bench_state_t * state) {
+ bench_state_impl_t * state_impl = bench_state_get_impl(state);
+ //latency recording needs a clock read per batch, which the slow path handles
+ if (state_impl->remaining && state_impl->started && !state_impl->latency) {
+  state_impl->remaining--;
+  return true;
+ }
+ return bench_state_keep_running_slow(state_impl);
+}
+
+//`bench_state_get_iterations` implementation
+uint64_t bench_state_get_iterations(bench_state_t * state) {
+ return bench_state_get_impl(state)->iterations;
+}
+
+//`bench_state_get_arg` implementation
+int64_t bench_state_get_arg(bench_state_t * state, size_t index) {
+ bench_state_impl_t * state_impl = bench_state_get_impl(state);
+ return index < state_impl->arg_count ? state_impl->args[index] : 0;
+}
+
+//`bench_state_get_thread_index` implementation
+size_t bench_state_get_thread_index(bench_state_t * state) {
+ return bench_state_get_impl(state)->thread_index;
+}
+
+//`bench_state_get_thread_count` implementation
+size_t bench_state_get_thread_count(bench_state_t * state) {
+ return bench_state_get_impl(state)->thread_count;
+}
+
+//`bench_state_set_counter` implementation
+char const * bench_state_set_counter(
+ bench_state_t * state,
+ char const * name,
+ double value
+) {
+ bench_state_impl_t * state_impl = bench_state_get_impl(state);
+ size_t const index = bench_user_counters_find(&state_impl->user_counters, name);
+ if (index == BENCH_MAX_COUNTERS) {
+  return "Too many benchmark counters!";
+ }
+ state_impl->user_counters.values[index] = value;
+ return NULL;
+}
+
+//`bench_t` implementation
+typedef struct {
+ //benchmark name
+ char const * name;
+ //for parameterized instances, the name without arguments, and the arguments
+ char const * family;
+ size_t arg_count;
+ int64_t args[BENCH_MAX_ARGS];
+ //threads running the callback concurrently; `0` if not threaded
+ size_t thread_count;
+ //benchmark callback, and the context set for it by `bench_set_ctx`, then
+ //`before_each`
+ bench_callback_t * callback;
+ void * user_ctx;
+ void * ctx;
+ //estimated cost of a timestamp, subtracted from paused regions
+ uint64_t overhead_ns;
+ //calibrated iterations per repetition
+ uint64_t iterations;
+ //per-repetition samples, in nanoseconds per iteration
+ size_t sample_count;
+ double * samples;
+ //per-repetition iterations per second, over all threads
+ double * throughput;
+ //per-repetition cpu time, in nanoseconds per iteration
+ double * cpu_samples;
+ //user counters; `counter_samples` holds `sample_count` values per counter
+ size_t counter_count;
+ char const * counter_names[BENCH_MAX_COUNTERS];
+ double * counter_samples;
+ //error that stopped the last run, if any; owned by the benchmark
+ char const * error;
+ //counter totals over all measured repetitions
+ perf_counters_t counters;
+ alloc_stats_t allocs;
+ //latencies merged over all measured repetitions, if recorded
+ histogram_t * latency;
+ //`bench_unstable_t` flags for the last run
+ unsigned unstable;
+ //cost of an empty loop iteration during the last run
+ double loop_floor;
+ //comparison group, if any, and position within it; `0` is the reference
+ char const * comparison;
+ size_t comparison_index;
+ //comparison against the reference, for the other variants of a group
+ bench_comparison_t compared;
+} bench_impl_t;
+
+//utility function
+static bench_impl_t * bench_get_impl(bench_t * bench) {
+ return (bench_impl_t *)*bench;
+}
+
+//`bench_new` implementation
+char const * bench_new(
+ bench_t * dst,
+ char const * name,
+ bench_callback_t * callback
+) {
+ *dst = NULL;
+
+ bench_impl_t * result = calloc(1, sizeof(bench_impl_t));
+ if (!result) {
+  return "Failed to allocate space for benchmark!";
+ }
+
+ //TODO: handle `string_format` failure
+ //copy name
+ result->name = string_format("%s", name);
+ result->callback = callback;
+ result->user_ctx = NULL;
+ result->ctx = NULL;
+ result->overhead_ns = 0;
+ result->family = NULL;
+ result->arg_count = 0;
+ result->thread_count = 0;
+ result->iterations = 0;
+ result->sample_count = 0;
+ result->samples = NULL;
+ result->throughput = NULL;
+ result->cpu_samples = NULL;
+ result->counter_count = 0;
+ result->counter_samples = NULL;
+ result->error = NULL;
+ memset(&result->counters, 0, sizeof(perf_counters_t));
+ memset(&result->allocs, 0, sizeof(alloc_stats_t));
+ result->latency = NULL;
+ result->unstable = 0;
+ result->loop_floor = 0.0;
+ result->comparison = NULL;
+ result->comparison_index = 0;
+ memset(&result->compared, 0, sizeof(bench_comparison_t));
+
+ //set benchmark in destination
+ *dst = (bench_t)result;
+
+ return NULL;
+}
+
+//utility function for `bench_free`
+static void bench_free_impl(bench_impl_t * bench_impl) {
+ if (!bench_impl) {
+  return;
+ }
+
+ //zero destination
+ char const * name = bench_impl->name;
+ char const * family = bench_impl->family;
+ double * samples = bench_impl->samples;
+ double * throughput = bench_impl->throughput;
+ double * cpu_samples = bench_impl->cpu_samples;
+ double * counter_samples = bench_impl->counter_samples;
+ histogram_t * latency = bench_impl->latency;
+ char const * error = bench_impl->error;
+ char const * comparison = bench_impl->comparison;
+ for (size_t i = 0; i < bench_impl->counter_count; i++) {
+  free((void *)bench_impl->counter_names[i]);
+  bench_impl->counter_names[i] = NULL;
+ }
+ bench_impl->counter_count = 0;
+ bench_impl->name = NULL;
+ bench_impl->family = NULL;
+ bench_impl->arg_count = 0;
+ bench_impl->thread_count = 0;
+ bench_impl->callback = NULL;
+ bench_impl->user_ctx = NULL;
+ bench_impl->ctx = NULL;
+ bench_impl->iterations = 0;
+ bench_impl->sample_count = 0;
+ bench_impl->samples = NULL;
+ bench_impl->throughput = NULL;
+ bench_impl->cpu_samples = NULL;
+ bench_impl->counter_samples = NULL;
+ bench_impl->latency = NULL;
+ bench_impl->error = NULL;
+ bench_impl->comparison = NULL;
+
+ //free names, samples, latencies and error
+ free((void *)name);
+ free((void *)family);
+ free((void *)samples);
+ free((void *)throughput);
+ free((void *)cpu_samples);
+ free((void *)counter_samples);
+ free((void *)latency);
+ free((void *)error);
+ free((void *)comparison);
+}
+
+//`bench_free` implementation
+void bench_free(bench_t * bench) {
+ if (!bench || !*bench) {
+  return;
+ }
+
+ //zero destination
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ *bench = NULL;
+
+ //free benchmark contents and benchmark
+ bench_free_impl(bench_impl);
+ free((void *)bench_impl);
+}
+
+//utility function for `bench_copy`
+static char const * bench_copy_impl(bench_impl_t * bench_impl, bench_impl_t * dst) {
+ //zero destination
+ memset(dst, 0, sizeof(bench_impl_t));
+
+ //TODO: handle string format failures
+ dst->name = string_format("%s", bench_impl->name);
+ dst->callback = bench_impl->callback;
+ dst->user_ctx = bench_impl->user_ctx;
+ if (bench_impl->family) {
+  dst->family = string_format("%s", bench_impl->family);
+ }
+ dst->arg_count = bench_impl->arg_count;
+ memcpy(dst->args, bench_impl->args, sizeof(bench_impl->args));
+ dst->thread_count = bench_impl->thread_count;
+ dst->iterations = bench_impl->iterations;
+ dst->counters = bench_impl->counters;
+ dst->allocs = bench_impl->allocs;
+ dst->unstable = bench_impl->unstable;
+ dst->loop_floor = bench_impl->loop_floor;
+ if (bench_impl->error) {
+  dst->error = string_format("%s", bench_impl->error);
+ }
+ if (bench_impl->comparison) {
+  dst->comparison = string_format("%s", bench_impl->comparison);
+ }
+ dst->comparison_index = bench_impl->comparison_index;
+ dst->compared = bench_impl->compared;
+
+ //copy counter names
+ //TODO: handle `string_format` failures
+ for (size_t i = 0; i < bench_impl->counter_count; i++) {
+  dst->counter_names[i] = string_format("%s", bench_impl->counter_names[i]);
+ }
+ dst->counter_count = bench_impl->counter_count;
+ if (bench_impl->sample_count) {
+  dst->samples = malloc(sizeof(double) * bench_impl->sample_count);
+  dst->throughput = malloc(sizeof(double) * bench_impl->sample_count);
+  dst->cpu_samples = malloc(sizeof(double) * bench_impl->sample_count);
+  dst->counter_samples = malloc(
+   sizeof(double) * bench_impl->sample_count * BENCH_MAX_COUNTERS
+  );
+  if (!dst->samples || !dst->throughput || !dst->cpu_samples || !dst->counter_samples) {
+   bench_free_impl(dst);
+   return "Failed to allocate space for benchmark samples!";
+  }
+  memcpy(
+   dst->samples,
+   bench_impl->samples,
+   sizeof(double) * bench_impl->sample_count
+  );
+  memcpy(
+   dst->throughput,
+   bench_impl->throughput,
+   sizeof(double) * bench_impl->sample_count
+  );
+  memcpy(
+   dst->cpu_samples,
+   bench_impl->cpu_samples,
+   sizeof(double) * bench_impl->sample_count
+  );
+  memcpy(
+   dst->counter_samples,
+   bench_impl->counter_samples,
+   sizeof(double) * bench_impl->sample_count * BENCH_MAX_COUNTERS
+  );
+  dst->sample_count = bench_impl->sample_count;
+ }
+
+ //copy latencies
+ if (bench_impl->latency) {
+  dst->latency = malloc(sizeof(histogram_t));
+  if (!dst->latency) {
+   bench_free_impl(dst);
+   return "Failed to allocate space for benchmark latencies!";
+  }
+  memcpy(dst->latency, bench_impl->latency, sizeof(histogram_t));
+ }
+
+ return NULL;
+}
+
+//`bench_copy` implementation
+char const * bench_copy(bench_t * bench, bench_t * dst) {
+ *dst = NULL;
+
+ bench_impl_t * copy = calloc(1, sizeof(bench_impl_t));
+ if (!copy) {
+  return "Failed to allocate space for benchmark!";
+ }
+ char const * error = bench_copy_impl(bench_get_impl(bench), copy);
+ if (error) {
+  free((void *)copy);
+  return error;
+ }
+
+ *dst = (bench_t)copy;
+ return NULL;
+}
+
+//utility type for `bench_run_iterations`; outcome of one callback run
+typedef struct {
+ //timings averaged over threads
+ uint64_t
+  elapsed_ns,
+  cpu_ns;
+ //first start to last finish, over all threads
+ uint64_t wall_ns;
+ //user counters, summed over threads
+ bench_user_counters_t user_counters;
+} bench_run_result_t;
+
+//utility type for `bench_run_threads`
+typedef struct {
+ bench_impl_t * bench_impl;
+ bench_state_impl_t state;
+ pthread_t thread;
+} bench_thread_t;
+
+//utility function for `bench_run_threads`
+static void * bench_thread_main(void * arg) {
+ bench_thread_t * thread = (bench_thread_t *)arg;
+ thread->bench_impl->callback((bench_state_t)&thread->state, thread->bench_impl->ctx);
+ return NULL;
+}
+
+//utility function for `bench_run_iterations`; runs the callback on every thread
+static char const * bench_run_threads(
+ bench_impl_t * bench_impl,
+ uint64_t iterations,
+ bench_run_result_t * result,
+ bool alloc_tracking,
+ histogram_t * latency,
+ uint64_t batch
+) {
+ size_t const thread_count = bench_impl->thread_count;
+ char const * error = NULL;
+
+ bench_thread_t * threads = calloc(thread_count, sizeof(bench_thread_t));
+ //threads record latencies separately, merged once all have finished
+ histogram_t * latencies = latency
+  ? malloc(sizeof(histogram_t) * thread_count)
+  : NULL;
+ if (!threads || (latency && !latencies)) {
+  free((void *)threads);
+  free((void *)latencies);
+  return "Failed to allocate space for benchmark threads!";
+ }
+
+ bench_threads_t shared = {
+  .thread_count = thread_count,
+  .arrived = 0,
+  .released = false,
+  .finished = 0,
+  .alloc_tracking = alloc_tracking
+ };
+ size_t started = 0;
+ for (; started < thread_count; started++) {
+  bench_thread_t * thread = threads + started;
+  if (latencies) {
+   histogram_reset(latencies + started);
+  }
+  thread->bench_impl = bench_impl;
+  thread->state = (bench_state_impl_t) {
+   .iterations = iterations,
+   .remaining = iterations,
+   .started = false,
+   .finished = false,
+   .paused = false,
+   .overhead_ns = bench_impl->overhead_ns,
+   .threads = &shared,
+   .thread_index = started,
+   .thread_count = thread_count,
+   .perf = NULL,
+   .alloc_tracking = false,
+   .latency = latencies ? latencies + started : NULL,
+   .batch = batch,
+   .arg_count = bench_impl->arg_count,
+   .args = bench_impl->args
+  };
+  if (pthread_create(&thread->thread, NULL, bench_thread_main, thread) != 0) {
+   //let the threads already started run unsynchronized, so they can be joined
+   __atomic_store_n(&shared.released, true, __ATOMIC_RELEASE);
+   error = "Failed to start benchmark thread!";
+   break;
+  }
+ }
+ for (size_t i = 0; i < started; i++) {
+  pthread_join(threads[i].thread, NULL);
+ }
+
+ //aggregate per-thread timings and counters
+ uint64_t first_start_ns = UINT64_MAX, last_end_ns = 0, total_ns = 0, total_cpu_ns = 0;
+ for (size_t i = 0; !error && i < thread_count; i++) {
+  bench_state_impl_t const * state = &threads[i].state;
+  if (!state->finished) {
+   error = "Benchmark callback did not run its 'bench_state_keep_running()' "
+    "loop to completion!";
+   break;
+  }
+  first_start_ns = state->start_ns < first_start_ns ? state->start_ns : first_start_ns;
+  last_end_ns = state->end_ns > last_end_ns ? state->end_ns : last_end_ns;
+  total_ns += state->elapsed_ns;
+  total_cpu_ns += state->cpu_elapsed_ns;
+  bench_user_counters_add(&result->user_counters, &state->user_counters);
+  if (latencies) {
+   histogram_merge(latency, latencies + i);
+  }
+ }
+ if (!error) {
+  result->elapsed_ns = total_ns / thread_count;
+  result->cpu_ns = total_cpu_ns / thread_count;
+  result->wall_ns = last_end_ns - first_start_ns;
+  if (alloc_tracking) {
+   alloc_stats_add(&bench_impl->allocs, &shared.allocs);
+  }
+ }
+
+ free((void *)threads);
+ free((void *)latencies);
+ return error;
+}
+
+//utility function for `bench_run`; runs the callback once for `iterations`
+static char const * bench_run_iterations(
+ bench_impl_t * bench_impl,
+ uint64_t iterations,
+ bench_run_result_t * result,
+ perf_group_t * perf,
+ bool alloc_tracking,
+ histogram_t * latency,
+ uint64_t batch
+) {
+ memset(result, 0, sizeof(bench_run_result_t));
+ if (bench_impl->thread_count > 1) {
+  return bench_run_threads(
+   bench_impl,
+   iterations,
+   result,
+   alloc_tracking,
+   latency,
+   batch
+  );
+ }
+
+ bench_state_impl_t state_impl = {
+  .iterations = iterations,
+  .remaining = iterations,
+  .start_ns = 0,
+  .end_ns = 0,
+  .elapsed_ns = 0,
+  .cpu_start_ns = 0,
+  .cpu_elapsed_ns = 0,
+  .started = false,
+  .finished = false,
+  .paused = false,
+  .pause_start_ns = 0,
+  .paused_ns = 0,
+  .overhead_ns = bench_impl->overhead_ns,
+  .user_counters = {.count = 0},
+  .threads = NULL,
+  .thread_index = 0,
+  .thread_count = 1,
+  .perf = perf,
+  .alloc_tracking = alloc_tracking,
+  .latency = latency,
+  .batch = batch,
+  .arg_count = bench_impl->arg_count,
+  .args = bench_impl->args
+ };
+ bench_impl->callback((bench_state_t)&state_impl, bench_impl->ctx);
+
+ if (!state_impl.finished) {
+  return "Benchmark callback did not run its 'bench_state_keep_running()' "
+   "loop to completion!";
+ }
+ result->elapsed_ns = state_impl.elapsed_ns;
+ result->cpu_ns = state_impl.cpu_elapsed_ns;
+ result->wall_ns = state_impl.elapsed_ns;
+ result->user_counters = state_impl.user_counters;
+ if (perf) {
+  perf_counters_add(&bench_impl->counters, &state_impl.counters);
+ }
+ if (alloc_tracking) {
+  alloc_stats_add(&bench_impl->allocs, &state_impl.allocs);
+ }
+ return NULL;
+}
+
+//utility function for `bench_run`; predicts the iterations needed for `target_ns`
+static uint64_t bench_next_iterations(
+ uint64_t iterations,
+ uint64_t elapsed_ns,
+ uint64_t target_ns
+) {
+ //grow aggressively while runs are too short to be measured reliably
+ double multiplier = 10.0;
+ if (elapsed_ns * 10 > target_ns) {
+  multiplier = (double)target_ns * 1.4 / (double)elapsed_ns;
+ }
+ if (multiplier > 10.0) {
+  multiplier = 10.0;
+ }
+
+ double next = (double)iterations * multiplier;
+ if (next <= (double)iterations) {
+  next = (double)iterations + 1;
+ }
+ if (next > (double)BENCH_MAX_ITERATIONS) {
+  return BENCH_MAX_ITERATIONS;
+ }
+ return (uint64_t)next;
+}
+
+//utility function for `bench_run`; grows `iterations` until a run takes `target_ns`
+static char const * bench_calibrate(
+ bench_impl_t * bench_impl,
+ uint64_t target_ns,
+ uint64_t * iterations
+) {
+ while (true) {
+  bench_run_result_t result;
+  char const * error = bench_run_iterations(
+   bench_impl,
+   *iterations,
+   &result,
+   NULL,
+   false,
+   NULL,
+   0
+  );
+  if (error) {
+   return error;
+  }
+  if (result.elapsed_ns >= target_ns || *iterations >= BENCH_MAX_ITERATIONS) {
+   return NULL;
+  }
+  *iterations = bench_next_iterations(*iterations, result.elapsed_ns, target_ns);
+ }
+}
+
+//utility function for `bench_run`; repeats warmup runs until timings settle
+static char const * bench_converge(
+ bench_impl_t * bench_impl,
+ uint64_t iterations,
+ bool * converged
+) {
+ double window[BENCH_CONVERGE_WINDOW];
+ *converged = false;
+ for (size_t run = 0; run < BENCH_CONVERGE_MAX_RUNS; run++) {
+  bench_run_result_t result;
+  char const * error = bench_run_iterations(
+   bench_impl,
+   iterations,
+   &result,
+   NULL,
+   false,
+   NULL,
+   0
+  );
+  if (error) {
+   return error;
+  }
+  window[run % BENCH_CONVERGE_WINDOW] = (double)result.elapsed_ns / (double)iterations;
+  if (run + 1 < BENCH_CONVERGE_WINDOW) {
+   continue;
+  }
+
+  double min = window[0], max = window[0];
+  for (size_t i = 1; i < BENCH_CONVERGE_WINDOW; i++) {
+   min = window[i] < min ? window[i] : min;
+   max = window[i] > max ? window[i] : max;
+  }
+  if (max - min <= min * BENCH_CONVERGE_TOLERANCE) {
+   *converged = true;
+   return NULL;
+  }
+ }
+ return NULL;
+}
+
+//utility type for `bench_run`; frequency range observed across repetitions
+typedef struct {
+ int cpu;
+ cpu_frequency_t first;
+ uint64_t
+  min_khz,
+  max_khz;
+ bool throttled;
+} bench_frequency_watch_t;
+
+//utility function for `bench_run`
+static void bench_frequency_watch_sample(bench_frequency_watch_t * watch, bool first) {
+ cpu_frequency_t sample;
+ cpu_frequency_sample(watch->cpu, &sample);
+ if (first) {
+  watch->first = sample;
+  watch->min_khz = sample.frequency_khz;
+  watch->max_khz = sample.frequency_khz;
+  watch->throttled = false;
+  return;
+ }
+ if (sample.frequency_available) {
+  watch->min_khz = sample.frequency_khz < watch->min_khz ? sample.frequency_khz : watch->min_khz;
+  watch->max_khz = sample.frequency_khz > watch->max_khz ? sample.frequency_khz : watch->max_khz;
+ }
+ if (sample.throttle_available && sample.throttle_count != watch->first.throttle_count) {
+  watch->throttled = true;
+ }
+}
+
+//utility function for `bench_run`; flags for the observed frequency range
+static unsigned bench_frequency_watch_flags(bench_frequency_watch_t const * watch) {
+ unsigned flags = 0;
+ if (
+  watch->first.frequency_available
+  && (double)(watch->max_khz - watch->min_khz)
+   > (double)watch->max_khz * BENCH_UNSTABLE_FREQUENCY_CHANGE
+ ) {
+  flags |= BENCH_UNSTABLE_FREQUENCY;
+ }
+ if (watch->throttled) {
+  flags |= BENCH_UNSTABLE_THROTTLED;
+ }
+ return flags;
+}
+
+//utility variable for `bench_empty_callback`; calling through a `volatile`
+//pointer keeps the fast path of `bench_state_keep_running` from being inlined
+//into the empty loop, which callbacks in other translation units never get
+static bool (* volatile bench_empty_keep_running)(bench_state_t *) =
+ bench_state_keep_running;
+
+//utility function for `bench_floor_t`
+static void bench_empty_callback(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_empty_keep_running(&state)) {}
+}
+
+//utility type for `bench_run`; empty loop runs, interleaved with repetitions
+typedef struct {
+ bench_impl_t impl;
+ uint64_t iterations;
+ //cheapest empty loop iteration so far, in nanoseconds
+ double ns;
+} bench_floor_t;
+
+//utility function for `bench_run`
+static char const * bench_floor_calibrate(bench_floor_t * floor) {
+ memset(floor, 0, sizeof(bench_floor_t));
+ floor->impl.callback = bench_empty_callback;
+ floor->iterations = 1;
+ return bench_calibrate(&floor->impl, BENCH_FLOOR_TIME_NS, &floor->iterations);
+}
+
+//utility function for `bench_run`; runs the empty loop like a repetition
+static char const * bench_floor_sample(
+ bench_floor_t * floor,
+ histogram_t * latency,
+ uint64_t batch
+) {
+ //latency recording takes the slow path every batch, so the floor does too
+ if (latency) {
+  histogram_reset(latency);
+ }
+ bench_run_result_t result;
+ char const * error = bench_run_iterations(
+  &floor->impl,
+  floor->iterations,
+  &result,
+  NULL,
+  false,
+  latency,
+  batch
+ );
+ if (error) {
+  return error;
+ }
+ double const ns = (double)result.elapsed_ns / (double)floor->iterations;
+ if (floor->ns == 0.0 || ns < floor->ns) {
+  floor->ns = ns;
+ }
+ return NULL;
+}
+
+//utility function for `bench_run`; discards the results of the previous run
+static void bench_reset_results(bench_impl_t * bench_impl) {
+ free((void *)bench_impl->samples);
+ free((void *)bench_impl->throughput);
+ free((void *)bench_impl->cpu_samples);
+ free((void *)bench_impl->counter_samples);
+ free((void *)bench_impl->latency);
+ for (size_t i = 0; i < bench_impl->counter_count; i++) {
+  free((void *)bench_impl->counter_names[i]);
+  bench_impl->counter_names[i] = NULL;
+ }
+ bench_impl->samples = NULL;
+ bench_impl->throughput = NULL;
+ bench_impl->cpu_samples = NULL;
+ bench_impl->counter_samples = NULL;
+ bench_impl->latency = NULL;
+ bench_impl->counter_count = 0;
+ bench_impl->sample_count = 0;
+ bench_impl->iterations = 0;
+ memset(&bench_impl->counters, 0, sizeof(perf_counters_t));
+ memset(&bench_impl->allocs, 0, sizeof(alloc_stats_t));
+ bench_impl->unstable = 0;
+ bench_impl->loop_floor = 0.0;
+ memset(&bench_impl->compared, 0, sizeof(bench_comparison_t));
+ free((void *)bench_impl->error);
+ bench_impl->error = NULL;
+}
+
+//utility function for `bench_run`; records the user counters of repetition `index`
+static void bench_record_user_counters(
+ bench_impl_t * bench_impl,
+ bench_user_counters_t const * counters,
+ size_t index,
+ size_t sample_size
+) {
+ for (size_t i = 0; i < counters->count; i++) {
+  //counters are matched by name, since repetitions may set them in any order
+  size_t slot = 0;
+  while (
+   slot < bench_impl->counter_count
+   && strcmp(bench_impl->counter_names[slot], counters->names[i]) != 0
+  ) {
+   slot++;
+  }
+  if (slot == BENCH_MAX_COUNTERS) {
+   continue;
+  }
+  if (slot == bench_impl->counter_count) {
+   //TODO: handle `string_format` failures
+   bench_impl->counter_names[slot] = string_format("%s", counters->names[i]);
+   bench_impl->counter_count++;
+  }
+  bench_impl->counter_samples[slot * sample_size + index] = counters->values[i];
+ }
+}
+
+//utility function for `bench_run`; allocates per-repetition results
+static char const * bench_alloc_samples(bench_impl_t * bench_impl, size_t sample_size) {
+ bench_impl->samples = calloc(sample_size, sizeof(double));
+ bench_impl->throughput = calloc(sample_size, sizeof(double));
+ bench_impl->cpu_samples = calloc(sample_size, sizeof(double));
+ bench_impl->counter_samples = calloc(sample_size * BENCH_MAX_COUNTERS, sizeof(double));
+ if (
+  !bench_impl->samples
+  || !bench_impl->throughput
+  || !bench_impl->cpu_samples
+  || !bench_impl->counter_samples
+ ) {
+  return "Failed to allocate space for benchmark samples!";
+ }
+ return NULL;
+}
+
+//utility function for `bench_run`; records the results of repetition `index`
+static void bench_record_repetition(
+ bench_impl_t * bench_impl,
+ bench_run_result_t const * result,
+ uint64_t iterations,
+ size_t index,
+ size_t sample_size
+) {
+ size_t const threads = bench_impl->thread_count > 1 ? bench_impl->thread_count : 1;
+ bench_impl->samples[index] = (double)result->elapsed_ns / (double)iterations;
+ bench_impl->cpu_samples[index] = (double)result->cpu_ns / (double)iterations;
+ bench_impl->throughput[index] = result->wall_ns
+  ? (double)iterations * (double)threads * 1e9 / (double)result->wall_ns
+  : 0.0;
+ bench_record_user_counters(bench_impl, &result->user_counters, index, sample_size);
+}
+
+//utility function for `bench_run`
+static char const * bench_run_impl(bench_impl_t * bench_impl, bench_runner_config_t runner_config) {
+ char const * error = NULL;
+ unsigned unstable = 0;
+
+ //watch for frequency changes and throttling from the start of warmup
+ bench_frequency_watch_t watch = {.cpu = cpu_current()};
+ if (runner_config.stabilize) {
+  bench_frequency_watch_sample(&watch, true);
+ }
+
+ //counters only measure the calling thread, so threaded runs go without
+ size_t const threads = bench_impl->thread_count > 1 ? bench_impl->thread_count : 1;
+
+ //per-repetition results; stored in `bench_impl` right away so they are
+ //released with it, even if the run fails
+ size_t const sample_size = runner_config.repetitions ? runner_config.repetitions : 1;
+ error = bench_alloc_samples(bench_impl, sample_size);
+ if (error) {
+  return error;
+ }
+
+ //every repetition records into its own histogram, merged into the total
+ histogram_t * repetition_latency = NULL;
+ if (runner_config.latency_batch) {
+  bench_impl->latency = malloc(sizeof(histogram_t));
+  repetition_latency = malloc(sizeof(histogram_t));
+  if (!bench_impl->latency || !repetition_latency) {
+   free((void *)repetition_latency);
+   return "Failed to allocate space for benchmark latencies!";
+  }
+  histogram_reset(bench_impl->latency);
+ }
+
+ //counters are optional; hosts without perf support just report none
+ perf_group_t perf = NULL;
+ if (runner_config.perf_counters && threads == 1) {
+  perf_group_new(&perf);
+ }
+
+ //measured once per run, since it depends on the clock source
+ bench_impl->overhead_ns = time_now_overhead_ns();
+
+ //warm up caches, branch predictors and clock frequency, then calibrate
+ uint64_t iterations = 1;
+ error = bench_calibrate(bench_impl, runner_config.warmup_time_ns, &iterations);
+ if (!error && runner_config.stabilize) {
+  bool converged = false;
+  error = bench_converge(bench_impl, iterations, &converged);
+  if (!converged) {
+   unstable |= BENCH_UNSTABLE_WARMUP;
+  }
+ }
+ if (!error) {
+  error = bench_calibrate(bench_impl, runner_config.min_time_ns, &iterations);
+ }
+
+ //cost of the timed loop itself, to detect bodies optimized away; sampled
+ //after every repetition, so both see the same clock frequency
+ bench_floor_t loop_floor;
+ if (!error) {
+  error = bench_floor_calibrate(&loop_floor);
+ }
+
+ //measured repetitions
+ for (size_t i = 0; !error && i < runner_config.repetitions; i++) {
+  bench_run_result_t result;
+  if (repetition_latency) {
+   histogram_reset(repetition_latency);
+  }
+  error = bench_run_iterations(
+   bench_impl,
+   iterations,
+   &result,
+   perf ? &perf : NULL,
+   runner_config.alloc_tracking,
+   repetition_latency,
+   runner_config.latency_batch
+  );
+  if (error) {
+   break;
+  }
+  bench_record_repetition(bench_impl, &result, iterations, i, sample_size);
+  if (repetition_latency) {
+   histogram_merge(bench_impl->latency, repetition_latency);
+  }
+  error = bench_floor_sample(&loop_floor, repetition_latency, runner_config.latency_batch);
+  if (error) {
+   break;
+  }
+  if (runner_config.stabilize) {
+   bench_frequency_watch_sample(&watch, false);
+  }
+ }
+ perf_group_free(&perf);
+ free((void *)repetition_latency);
+ if (error) {
+  return error;
+ }
+
+ bench_impl->iterations = iterations;
+ bench_impl->sample_count = runner_config.repetitions;
+ bench_impl->loop_floor = loop_floor.ns;
+
+ //flag noisy results
+ if (runner_config.stabilize) {
+  stats_summary_t summary;
+  if (
+   stats_summarize(bench_impl->samples, runner_config.repetitions, &summary)
+   && summary.mean > 0.0
+   && summary.stddev / summary.mean > BENCH_UNSTABLE_CV
+  ) {
+   unstable |= BENCH_UNSTABLE_VARIANCE;
+  }
+  unstable |= bench_frequency_watch_flags(&watch);
+ }
+ bench_impl->unstable = unstable;
+
+ return NULL;
+}
+
+//`bench_runner_setup_t` implementation
+typedef struct {
+ bench_t bench;
+ void * ctx;
+ char const * error;
+} bench_runner_setup_impl_t;
+
+//utility function
+static bench_runner_setup_impl_t * bench_runner_setup_get_impl(
+ bench_runner_setup_t * setup
+) {
+ return (bench_runner_setup_impl_t *)*setup;
+}
+
+//`bench_runner_setup_get_bench` implementation
+bench_t bench_runner_setup_get_bench(bench_runner_setup_t * setup) {
+ return bench_runner_setup_get_impl(setup)->bench;
+}
+
+//`bench_runner_setup_set_ctx` implementation
+void bench_runner_setup_set_ctx(bench_runner_setup_t * setup, void * ctx) {
+ bench_runner_setup_get_impl(setup)->ctx = ctx;
+}
+
+//`bench_runner_setup_get_ctx` implementation
+void * bench_runner_setup_get_ctx(bench_runner_setup_t * setup) {
+ return bench_runner_setup_get_impl(setup)->ctx;
+}
+
+//`bench_runner_setup_fail` implementation
+char const * bench_runner_setup_fail(bench_runner_setup_t * setup, char const * error) {
+ bench_runner_setup_impl_t * setup_impl = bench_runner_setup_get_impl(setup);
+
+ //free previous error
+ free((void *)setup_impl->error);
+ setup_impl->error = NULL;
+
+ //TODO: handle `string_format` failure
+ //copy provided error string
+ setup_impl->error = string_format("%s", error);
+
+ return NULL;
+}
+
+//utility function for `bench_run`; runs `hook`, if any, and reports its failure
+static char const * bench_run_hook(
+ void (*hook)(bench_runner_setup_t setup),
+ char const * hook_name,
+ bench_runner_setup_impl_t * setup_impl
+) {
+ //if no callback supplied, do nothing
+ if (!hook) {
+  return NULL;
+ }
+
+ //run callback
+ hook((bench_runner_setup_t)setup_impl);
+
+ //if callback succeeded, do nothing
+ if (!setup_impl->error) {
+  return NULL;
+ }
+
+ //TODO: handle `string_format` failure
+ char const * cause = string_format(
+  "Provided '%s()' callback failed with error: %s",
+  hook_name,
+  setup_impl->error
+ );
+
+ //reset setup error state
+ free((void *)setup_impl->error);
+ setup_impl->error = NULL;
+
+ return cause;
+}
+
+//`bench_run` implementation
+char const * bench_run(bench_t * bench, bench_runner_config_t runner_config) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ bench_reset_results(bench_impl);
+
+ bench_runner_setup_impl_t setup_impl = {
+  .bench = *bench,
+  .ctx = bench_impl->user_ctx,
+  .error = NULL
+ };
+
+ //run benchmark initializer; if it fails, do not run the benchmark
+ char const * error = bench_run_hook(runner_config.before_each, "before_each", &setup_impl);
+ if (!error) {
+  bench_impl->ctx = setup_impl.ctx;
+  char const * run_error = bench_run_impl(bench_impl, runner_config);
+  bench_impl->ctx = NULL;
+
+  //TODO: handle `string_format` failure
+  //run benchmark destructor, even if the benchmark failed
+  error = run_error ? string_format("%s", run_error) : NULL;
+  char const * after_error = bench_run_hook(runner_config.after_each, "after_each", &setup_impl);
+  if (error) {
+   free((void *)after_error);
+  } else {
+   error = after_error;
+  }
+ }
+
+ //failed runs keep their error, but no partial results
+ if (error) {
+  bench_reset_results(bench_impl);
+  bench_impl->error = error;
+ }
+ return error;
+}
+
+//utility function for `bench_run_comparison`; xorshift64 step
+static uint64_t bench_random_next(uint64_t * state) {
+ uint64_t value = *state;
+ value ^= value << 13;
+ value ^= value >> 7;
+ value ^= value << 17;
+ *state = value;
+ return value;
+}
+
+//utility function for `bench_run_comparison`; pairs every round with the reference
+static char const * bench_compare_variant(
+ bench_impl_t const * reference,
+ bench_impl_t * variant
+) {
+ size_t const rounds = reference->sample_count;
+ double * differences = malloc(sizeof(double) * (rounds ? rounds : 1));
+ if (!differences) {
+  return "Failed to allocate space for benchmark comparison!";
+ }
+
+ size_t count = 0;
+ for (size_t i = 0; i < rounds; i++) {
+  if (reference->samples[i] > 0.0) {
+   differences[count++] = (variant->samples[i] / reference->samples[i] - 1.0) * 100.0;
+  }
+ }
+ stats_sort(differences, count);
+ variant->compared.rounds = count;
+ variant->compared.median = count ? stats_sorted_median(differences, count) : 0.0;
+ stats_median_interval(
+  differences,
+  count,
+  BENCH_COMPARISON_CONFIDENCE,
+  &variant->compared.interval
+ );
+
+ free((void *)differences);
+ return NULL;
+}
+
+//utility function for `bench_run_comparison`
+static char const * bench_run_comparison_impl(
+ bench_impl_t * variants,
+ size_t count,
+ bench_runner_config_t runner_config
+) {
+ char const * error = NULL;
+ size_t const sample_size = runner_config.repetitions ? runner_config.repetitions : 1;
+
+ //warm up and calibrate every variant on its own
+ uint64_t * iterations = calloc(count, sizeof(uint64_t));
+ size_t * order = calloc(count, sizeof(size_t));
+ if (!iterations || !order) {
+  free((void *)iterations);
+  free((void *)order);
+  return "Failed to allocate space for benchmark comparison!";
+ }
+ for (size_t v = 0; !error && v < count; v++) {
+  error = bench_alloc_samples(variants + v, sample_size);
+  variants[v].overhead_ns = time_now_overhead_ns();
+  iterations[v] = 1;
+  if (!error) {
+   error = bench_calibrate(variants + v, runner_config.warmup_time_ns, iterations + v);
+  }
+  if (!error) {
+   error = bench_calibrate(variants + v, runner_config.min_time_ns, iterations + v);
+  }
+ }
+
+ //cost of the timed loop itself, shared by all variants; sampled after every
+ //round, like after every repetition of a single benchmark
+ bench_floor_t loop_floor;
+ if (!error) {
+  error = bench_floor_calibrate(&loop_floor);
+ }
+
+ //counters only measure the calling thread, so threaded variants go without
+ perf_group_t perf = NULL;
+ if (runner_config.perf_counters) {
+  perf_group_new(&perf);
+ }
+
+ //every round runs each variant once, in random order
+ uint64_t random = time_now_ns() | 1;
+ for (size_t round = 0; !error && round < runner_config.repetitions; round++) {
+  for (size_t v = 0; v < count; v++) {
+   order[v] = v;
+  }
+  for (size_t v = count - 1; v > 0; v--) {
+   size_t const swap = (size_t)(bench_random_next(&random) % (v + 1));
+   size_t const temp = order[v];
+   order[v] = order[swap];
+   order[swap] = temp;
+  }
+
+  for (size_t k = 0; !error && k < count; k++) {
+   bench_impl_t * variant = variants + order[k];
+   bench_run_result_t result;
+   error = bench_run_iterations(
+    variant,
+    iterations[order[k]],
+    &result,
+    perf && variant->thread_count <= 1 ? &perf : NULL,
+    runner_config.alloc_tracking,
+    NULL,
+    0
+   );
+   if (!error) {
+    bench_record_repetition(variant, &result, iterations[order[k]], round, sample_size);
+   }
+  }
+  if (!error) {
+   error = bench_floor_sample(&loop_floor, NULL, 0);
+  }
+ }
+ perf_group_free(&perf);
+
+ for (size_t v = 0; !error && v < count; v++) {
+  variants[v].iterations = iterations[v];
+  variants[v].sample_count = runner_config.repetitions;
+  variants[v].loop_floor = loop_floor.ns;
+ }
+ for (size_t v = 1; !error && v < count; v++) {
+  error = bench_compare_variant(variants, variants + v);
+ }
+
+ free((void *)iterations);
+ free((void *)order);
+ return error;
+}
+
+//utility function for `bench_suite_run_and_emit`; runs a comparison group
+static void bench_run_comparison(
+ bench_impl_t * variants,
+ size_t count,
+ bench_runner_config_t runner_config
+) {
+ for (size_t v = 0; v < count; v++) {
+  bench_reset_results(variants + v);
+ }
+ bench_runner_setup_impl_t * setups = calloc(count, sizeof(bench_runner_setup_impl_t));
+ if (!setups) {
+  //TODO: handle `string_format` failures
+  for (size_t v = 0; v < count; v++) {
+   variants[v].error = string_format("Failed to allocate space for benchmark comparison!");
+  }
+  return;
+ }
+
+ //run initializers of all variants up front, since their runs interleave
+ char const * error = NULL;
+ size_t prepared = 0;
+ for (; !error && prepared < count; prepared++) {
+  setups[prepared].bench = (bench_t)(variants + prepared);
+  setups[prepared].ctx = variants[prepared].user_ctx;
+  error = bench_run_hook(runner_config.before_each, "before_each", setups + prepared);
+  variants[prepared].ctx = setups[prepared].ctx;
+ }
+ if (error) {
+  prepared--;
+ } else {
+  //TODO: handle `string_format` failure
+  char const * run_error = bench_run_comparison_impl(variants, count, runner_config);
+  error = run_error ? string_format("%s", run_error) : NULL;
+ }
+
+ //run destructors of every initialized variant, even if the run failed
+ for (size_t v = 0; v < count; v++) {
+  variants[v].ctx = NULL;
+ }
+ for (size_t v = 0; v < prepared; v++) {
+  char const * after_error = bench_run_hook(runner_config.after_each, "after_each", setups + v);
+  if (error) {
+   free((void *)after_error);
+  } else {
+   error = after_error;
+  }
+ }
+ free((void *)setups);
+
+ //a failure of any variant fails the whole group, without partial results
+ if (error) {
+  for (size_t v = 0; v < count; v++) {
+   bench_reset_results(variants + v);
+   //TODO: handle `string_format` failures
+   variants[v].error = string_format("%s", error);
+  }
+  free((void *)error);
+ }
+}
+
+//`bench_get_name` implementation
+char const * bench_get_name(bench_t * bench, char const ** dst) {
+ *dst = NULL;
+
+ //TODO: handle `string_format` failures
+ *dst = string_format("%s", bench_get_impl(bench)->name);
+
+ return NULL;
+}
+
+//`bench_set_ctx` implementation
+void bench_set_ctx(bench_t * bench, void * ctx) {
+ bench_get_impl(bench)->user_ctx = ctx;
+}
+
+//`bench_get_family` implementation
+char const * bench_get_family(bench_t * bench, char const ** dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ *dst = NULL;
+
+ //TODO: handle `string_format` failures
+ *dst = string_format(
+  "%s",
+  bench_impl->family ? bench_impl->family : bench_impl->name
+ );
+
+ return NULL;
+}
+
+//`bench_get_stats` implementation
+char const * bench_get_stats(bench_t * bench, bench_stats_t * dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ memset(dst, 0, sizeof(bench_stats_t));
+
+ dst->iterations = bench_impl->iterations;
+ dst->counters = bench_impl->counters;
+ dst->allocs = bench_impl->allocs;
+ dst->unstable = bench_impl->unstable;
+ dst->loop_floor = bench_impl->loop_floor;
+ dst->threads = bench_impl->thread_count > 1 ? bench_impl->thread_count : 1;
+ if (
+  !stats_summarize(bench_impl->samples, bench_impl->sample_count, &dst->time)
+  || !stats_summarize(bench_impl->cpu_samples, bench_impl->sample_count, &dst->cpu_time)
+  || !stats_summarize(bench_impl->throughput, bench_impl->sample_count, &dst->throughput)
+ ) {
+  return "Failed to allocate space for benchmark statistics!";
+ }
+
+ dst->too_fast = dst->time.count
+  && dst->time.min < bench_impl->loop_floor * BENCH_FLOOR_RATIO;
+
+ return NULL;
+}
+
+//`bench_get_samples` implementation
+char const * bench_get_samples(bench_t * bench, size_t * count, double ** dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+
+ //zero destination
+ *count = 0;
+ *dst = NULL;
+
+ //if there are no samples, do nothing
+ if (!bench_impl->sample_count) {
+  return NULL;
+ }
+
+ double * copy = malloc(sizeof(double) * bench_impl->sample_count);
+ if (!copy) {
+  return "Failed to allocate space for benchmark samples!";
+ }
+ memcpy(copy, bench_impl->samples, sizeof(double) * bench_impl->sample_count);
+
+ *dst = copy;
+ *count = bench_impl->sample_count;
+
+ return NULL;
+}
+
+//utility function; copies `count` doubles into an allocated buffer
+static char const * bench_copy_doubles(double const * src, size_t count, double ** dst) {
+ *dst = NULL;
+ if (!count) {
+  return NULL;
+ }
+ double * copy = malloc(sizeof(double) * count);
+ if (!copy) {
+  return "Failed to allocate space for benchmark samples!";
+ }
+ memcpy(copy, src, sizeof(double) * count);
+ *dst = copy;
+ return NULL;
+}
+
+//`bench_get_cpu_samples` implementation
+char const * bench_get_cpu_samples(bench_t * bench, size_t * count, double ** dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ *count = 0;
+ char const * error = bench_copy_doubles(bench_impl->cpu_samples, bench_impl->sample_count, dst);
+ if (!error) {
+  *count = bench_impl->sample_count;
+ }
+ return error;
+}
+
+//`bench_get_counter_names` implementation
+char const * bench_get_counter_names(bench_t * bench, size_t * count, char *** dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+
+ //zero destination
+ *count = 0;
+ *dst = NULL;
+
+ char ** names = calloc(bench_impl->counter_count ? bench_impl->counter_count : 1, sizeof(char *));
+ if (!names) {
+  return "Failed to allocate space for benchmark counter names!";
+ }
+ //TODO: handle `string_format` failures
+ for (size_t i = 0; i < bench_impl->counter_count; i++) {
+  names[i] = string_format("%s", bench_impl->counter_names[i]);
+ }
+
+ *dst = names;
+ *count = bench_impl->counter_count;
+ return NULL;
+}
+
+//`bench_get_counter_samples` implementation
+char const * bench_get_counter_samples(
+ bench_t * bench,
+ size_t index,
+ size_t * count,
+ double ** dst
+) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ *count = 0;
+ *dst = NULL;
+ if (index >= bench_impl->counter_count) {
+  return "Benchmark counter index out of range!";
+ }
+ char const * error = bench_copy_doubles(
+  bench_impl->counter_samples + index * bench_impl->sample_count,
+  bench_impl->sample_count,
+  dst
+ );
+ if (!error) {
+  *count = bench_impl->sample_count;
+ }
+ return error;
+}
+
+//`bench_get_error` implementation
+char const * bench_get_error(bench_t * bench, char const ** dst) {
+ *dst = bench_get_impl(bench)->error;
+ return NULL;
+}
+
+//`bench_get_comparison` implementation
+char const * bench_get_comparison(bench_t * bench, bench_comparison_t * dst) {
+ *dst = bench_get_impl(bench)->compared;
+ return NULL;
+}
+
+//`bench_get_throughput` implementation
+char const * bench_get_throughput(bench_t * bench, size_t * count, double ** dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+
+ //zero destination
+ *count = 0;
+ *dst = NULL;
+
+ //if there are no samples, do nothing
+ if (!bench_impl->sample_count) {
+  return NULL;
+ }
+
+ double * copy = malloc(sizeof(double) * bench_impl->sample_count);
+ if (!copy) {
+  return "Failed to allocate space for benchmark throughput!";
+ }
+ memcpy(copy, bench_impl->throughput, sizeof(double) * bench_impl->sample_count);
+
+ *dst = copy;
+ *count = bench_impl->sample_count;
+
+ return NULL;
+}
+
+//`bench_get_latency` implementation
+char const * bench_get_latency(bench_t * bench, histogram_t ** dst) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+
+ //zero destination
+ *dst = NULL;
+
+ //if no latencies were recorded, do nothing
+ if (!bench_impl->latency) {
+  return NULL;
+ }
+
+ histogram_t * copy = malloc(sizeof(histogram_t));
+ if (!copy) {
+  return "Failed to allocate space for benchmark latencies!";
+ }
+ memcpy(copy, bench_impl->latency, sizeof(histogram_t));
+ *dst = copy;
+
+ return NULL;
+}
+
+//`bench_get_args` implementation
+char const * bench_get_args(
+ bench_t * bench,
+ size_t * count,
+ int64_t dst[BENCH_MAX_ARGS]
+) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ memset(dst, 0, sizeof(int64_t) * BENCH_MAX_ARGS);
+ *count = bench_impl->arg_count;
+ memcpy(dst, bench_impl->args, sizeof(int64_t) * bench_impl->arg_count);
+ return NULL;
+}
+
+//`bench_suite_t` implementation
+typedef struct {
+ size_t
+  bench_count,
+  bench_size;
+ bench_impl_t * benches;
+ //benchmarks waiting for `bench_suite_add_library_comparisons`, if any
+ bench_suite_t library_benches;
+ bool libraries_added;
+} bench_suite_impl_t;
+
+//utility function
+static bench_suite_impl_t * bench_suite_get_impl(bench_suite_t * suite) {
+ return (bench_suite_impl_t *)*suite;
+}
+
+//`bench_suite_new` implementation
+char const * bench_suite_new(bench_suite_t * dst) {
+ size_t const default_bench_size = 4;
+
+ //zero destination
+ *dst = NULL;
+
+ bench_suite_impl_t * suite_impl = calloc(1, sizeof(bench_suite_impl_t));
+ if (!suite_impl) {
+  return "Failed to allocate space for benchmark suite";
+ }
+ suite_impl->benches = calloc(default_bench_size, sizeof(bench_impl_t));
+ if (!suite_impl->benches) {
+  free((void *)suite_impl);
+  return "Failed to allocate space for benchmark suite";
+ }
+ suite_impl->bench_count = 0;
+ suite_impl->bench_size = default_bench_size;
+ suite_impl->library_benches = NULL;
+ suite_impl->libraries_added = false;
+ *dst = (bench_suite_t)suite_impl;
+
+ return NULL;
+}
+
+//`bench_suite_free` implementation
+void bench_suite_free(bench_suite_t * suite) {
+ bench_suite_impl_t * suite_impl = bench_suite_get_impl(suite);
+
+ //zero destination
+ *suite = NULL;
+
+ //free benchmarks
+ for (size_t i = 0; i < suite_impl->bench_count; i++) {
+  bench_free_impl(suite_impl->benches + i);
+ }
+ free((void *)suite_impl->benches);
+ if (suite_impl->library_benches) {
+  bench_suite_free(&suite_impl->library_benches);
+ }
+
+ //free suite
+ free((void *)suite_impl);
+}
+
+//`bench_suite_add` implementation
+char const * bench_suite_add(bench_suite_t * suite, bench_t * bench) {
+ bench_suite_impl_t * suite_impl = bench_suite_get_impl(suite);
+
+ //grow benchmark list if needed
+ if (suite_impl->bench_count + 1 > suite_impl->bench_size) {
+  size_t const new_size = suite_impl->bench_size * 2;
+  bench_impl_t * grown = realloc(
+   suite_impl->benches,
+   sizeof(bench_impl_t) * new_size
+  );
+  if (!grown) {
+   return "Failed to grow benchmark suite!";
+  }
+  suite_impl->benches = grown;
+  suite_impl->bench_size = new_size;
+ }
+
+ //add benchmark
+ char const * error = bench_copy_impl(
+  bench_get_impl(bench),
+  suite_impl->benches + suite_impl->bench_count
+ );
+ if (error) {
+  return error;
+ }
+ suite_impl->bench_count++;
+
+ return NULL;
+}
+
+//utility function for `bench_suite_add_args`; expands `range` into `dst`
+static char const * bench_arg_range_expand(
+ bench_arg_range_t const * range,
+ size_t * count,
+ int64_t ** dst
+) {
+ *count = 0;
+ *dst = NULL;
+
+ //explicit lists are taken as-is
+ if (range->values) {
+  if (!range->value_count) {
+   return "Benchmark argument list is empty!";
+  }
+  *dst = malloc(sizeof(int64_t) * range->value_count);
+  if (!*dst) {
+   return "Failed to allocate space for benchmark arguments!";
+  }
+  memcpy(*dst, range->values, sizeof(int64_t) * range->value_count);
+  *count = range->value_count;
+  return NULL;
+ }
+
+ if (range->start < 1 || range->limit < range->start || range->multiplier < 2) {
+  return "Invalid benchmark argument range!";
+ }
+
+ //values strictly below `limit`, then `limit`; at most 64 fit in an `int64_t`
+ int64_t buffer[64];
+ size_t value_count = 0;
+ int64_t value = range->start;
+ buffer[value_count++] = value;
+ while (value <= (range->limit - 1) / range->multiplier) {
+  value *= range->multiplier;
+  buffer[value_count++] = value;
+ }
+ if (buffer[value_count - 1] != range->limit) {
+  buffer[value_count++] = range->limit;
+ }
+
+ int64_t * values = malloc(sizeof(int64_t) * value_count);
+ if (!values) {
+  return "Failed to allocate space for benchmark arguments!";
+ }
+ memcpy(values, buffer, sizeof(int64_t) * value_count);
+
+ *dst = values;
+ *count = value_count;
+ return NULL;
+}
+
+//`bench_suite_add_args` implementation
+char const * bench_suite_add_args(
+ bench_suite_t * suite,
+ bench_t * bench,
+ size_t range_count,
+ bench_arg_range_t const * ranges
+) {
+ if (!range_count || range_count > BENCH_MAX_ARGS) {
+  return "Unsupported number of benchmark argument dimensions!";
+ }
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ char const * error = NULL;
+
+ //expand every dimension up front
+ size_t counts[BENCH_MAX_ARGS] = {0};
+ int64_t * values[BENCH_MAX_ARGS] = {NULL};
+ for (size_t i = 0; !error && i < range_count; i++) {
+  error = bench_arg_range_expand(ranges + i, counts + i, values + i);
+ }
+
+ //add one instance per combination, varying the last dimension fastest
+ size_t indices[BENCH_MAX_ARGS] = {0};
+ while (!error) {
+  bench_impl_t instance;
+  error = bench_copy_impl(bench_impl, &instance);
+  if (error) {
+   break;
+  }
+
+  //TODO: handle `string_format` failures
+  free((void *)instance.family);
+  instance.family = string_format("%s", bench_impl->name);
+  instance.arg_count = range_count;
+  for (size_t i = 0; i < range_count; i++) {
+   instance.args[i] = values[i][indices[i]];
+   char const * name = instance.name;
+   instance.name = string_format("%s/%lld", name, (long long)instance.args[i]);
+   free((void *)name);
+  }
+
+  bench_t instance_bench = (bench_t)&instance;
+  error = bench_suite_add(suite, &instance_bench);
+  bench_free_impl(&instance);
+
+  //advance to the next combination
+  size_t dimension = range_count;
+  while (dimension > 0 && ++indices[dimension - 1] == counts[dimension - 1]) {
+   indices[dimension - 1] = 0;
+   dimension--;
+  }
+  if (!dimension) {
+   break;
+  }
+ }
+
+ for (size_t i = 0; i < range_count; i++) {
+  free((void *)values[i]);
+ }
+ return error;
+}
+
+//`bench_suite_add_threads` implementation
+char const * bench_suite_add_threads(
+ bench_suite_t * suite,
+ bench_t * bench,
+ size_t count,
+ size_t const * thread_counts
+) {
+ bench_impl_t * bench_impl = bench_get_impl(bench);
+ for (size_t i = 0; i < count; i++) {
+  if (!thread_counts[i]) {
+   return "Benchmark thread count must be positive!";
+  }
+ }
+
+ for (size_t i = 0; i < count; i++) {
+  bench_impl_t instance;
+  char const * error = bench_copy_impl(bench_impl, &instance);
+  if (error) {
+   return error;
+  }
+
+  //TODO: handle `string_format` failures
+  char const * name = instance.name;
+  instance.name = string_format("%s/threads:%zu", name, thread_counts[i]);
+  free((void *)name);
+  if (!instance.family) {
+   instance.family = string_format("%s", bench_impl->name);
+  }
+  instance.thread_count = thread_counts[i];
+
+  bench_t instance_bench = (bench_t)&instance;
+  error = bench_suite_add(suite, &instance_bench);
+  bench_free_impl(&instance);
+  if (error) {
+   return error;
+  }
+ }
+ return NULL;
+}
+
+//`bench_suite_add_comparison` implementation
+char const * bench_suite_add_comparison(
+ bench_suite_t * suite,
+ char const * name,
+ size_t count,
+ bench_t * variants
+) {
+ if (count < 2) {
+  return "Benchmark comparisons need at least two variants!";
+ }
+
+ for (size_t i = 0; i < count; i++) {
+  bench_impl_t instance;
+  char const * error = bench_copy_impl(bench_get_impl(variants + i), &instance);
+  if (error) {
+   return error;
+  }
+
+  //TODO: handle `string_format` failures
+  char const * variant_name = instance.name;
+  instance.name = string_format("%s/%s", name, variant_name);
+  free((void *)variant_name);
+  free((void *)instance.comparison);
+  instance.comparison = string_format("%s", name);
+  instance.comparison_index = i;
+
+  bench_t instance_bench = (bench_t)&instance;
+  error = bench_suite_add(suite, &instance_bench);
+  bench_free_impl(&instance);
+  if (error) {
+   return error;
+  }
+ }
+ return NULL;
+}
+
+//`bench_suite_add_comparison_callbacks` implementation
+char const * bench_suite_add_comparison_callbacks(
+ bench_suite_t * suite,
+ char const * name,
+ char const * names,
+ size_t count,
+ bench_callback_t * const * callbacks
+) {
+ bench_t * variants = calloc(count ? count : 1, sizeof(bench_t));
+ if (!variants) {
+  return "Failed to allocate space for benchmark comparison!";
+ }
+
+ char const * error = NULL;
+ char const * cursor = names;
+ size_t created = 0;
+ for (; !error && created < count; created++) {
+  //split the next name off, without surrounding whitespace
+  while (*cursor == ' ' || *cursor == ',') {
+   cursor++;
+  }
+  size_t length = strcspn(cursor, ",");
+  while (length && cursor[length - 1] == ' ') {
+   length--;
+  }
+
+  //TODO: handle `string_format` failures
+  char const * variant_name = length
+   ? string_format("%.*s", (int)length, cursor)
+   : string_format("%zu", created);
+  error = bench_new(variants + created, variant_name, callbacks[created]);
+  free((void *)variant_name);
+  cursor += strcspn(cursor, ",");
+ }
+ if (!error) {
+  error = bench_suite_add_comparison(suite, name, count, variants);
+ }
+
+ for (size_t i = 0; i < created; i++) {
+  bench_free(variants + i);
+ }
+ free((void *)variants);
+ return error;
+}
+
+//`bench_suite_add_per_library` implementation
+char const * bench_suite_add_per_library(bench_suite_t * suite, bench_t * bench) {
+ bench_suite_impl_t * suite_impl = bench_suite_get_impl(suite);
+ if (!suite_impl->library_benches) {
+  char const * error = bench_suite_new(&suite_impl->library_benches);
+  if (error) {
+   return error;
+  }
+ }
+ return bench_suite_add(&suite_impl->library_benches, bench);
+}
+
+//`bench_suite_add_library_comparisons` implementation
+char const * bench_suite_add_library_comparisons(
+ bench_suite_t * suite,
+ size_t count,
+ library_t * libraries
+) {
+ bench_suite_impl_t * suite_impl = bench_suite_get_impl(suite);
+ if (!count) {
+  return "Library comparisons need at least one library!";
+ }
+ suite_impl->libraries_added = true;
+ if (!suite_impl->library_benches) {
+  return NULL;
+ }
+
+ bench_suite_impl_t * pending = bench_suite_get_impl(&suite_impl->library_benches);
+ bench_impl_t * variants = calloc(count, sizeof(bench_impl_t));
+ bench_t * variant_benches = calloc(count, sizeof(bench_t));
+ if (!variants || !variant_benches) {
+  free((void *)variants);
+  free((void *)variant_benches);
+  return "Failed to allocate space for library comparison!";
+ }
+
+ char const * error = NULL;
+ for (size_t i = 0; !error && i < pending->bench_count; i++) {
+  bench_impl_t * bench_impl = pending->benches + i;
+
+  //one instance per library, named after it, with the library as context
+  size_t created = 0;
+  for (; created < count; created++) {
+   error = bench_copy_impl(bench_impl, variants + created);
+   if (error) {
+    break;
+   }
+   //TODO: handle `string_format` failures
+   free((void *)variants[created].name);
+   variants[created].name = string_format("%s", library_get_path(libraries + created));
+   variants[created].user_ctx = (void *)libraries[created];
+   variant_benches[created] = (bench_t)(variants + created);
+  }
+
+  if (!error && count > 1) {
+   error = bench_suite_add_comparison(suite, bench_impl->name, count, variant_benches);
+  } else if (!error) {
+   //TODO: handle `string_format` failure
+   char const * name = variants[0].name;
+   variants[0].name = string_format("%s/%s", bench_impl->name, name);
+   free((void *)name);
+   error = bench_suite_add(suite, variant_benches);
+  }
+
+  for (size_t v = 0; v < created; v++) {
+   bench_free_impl(variants + v);
+  }
+ }
+
+ free((void *)variants);
+ free((void *)variant_benches);
+ return error;
+}
+
+//`bench_suite_get_benches` implementation
+char const * bench_suite_get_benches(
+ bench_suite_t * suite,
+ size_t * count,
+ bench_t ** dst
+) {
+ //zero destination
+ *dst = NULL;
+ *count = 0;
+
+ char const * error = NULL;
+ bench_suite_impl_t * suite_impl = bench_suite_get_impl(suite);
+
+ //allocate result buffer
+ bench_t * result = calloc(suite_impl->bench_count ? suite_impl->bench_count : 1, sizeof(bench_t));
+ if (!result) {
+  return "Failed to allocate space for benchmarks!";
+ }
+
+ //copy all benchmarks
+ size_t i = 0;
+ for (; i < suite_impl->bench_count; i++) {
+  bench_impl_t * bench_impl = suite_impl->benches + i;
+  error = bench_copy((bench_t *)&bench_impl, result + i);
+  if (error) {
+   break;
+  }
+ }
+
+ //clean up if we encountered an error
+ if (error) {
+  for (size_t j = 0; j < i; j++) {
+   bench_free(result + j);
+  }
+  free((void *)result);
+  return error;
+ }
+
+ //set results in destinations
+ *dst = result;
+ *count = suite_impl->bench_count;
+
+ return NULL;
+}
+
+//utility function for `bench_suite_run_and_emit`
+static void bench_emit_stats(char const * name, bench_stats_t const * stats) {
+ printf(
+  "%-40s %12llu %5zu %12.2f %12.2f %10.2f %10.2f %12.2f\n",
+  name,
+  (unsigned long long)stats->iterations,
+  stats->time.count,
+  stats->time.mean,
+  stats->time.median,
+  stats->time.stddev,
+  stats->time.mad,
+  stats->time.min
+ );
+}
+
+//utility function for `bench_suite_run_and_emit`; prints normalized counters
+static void bench_emit_counters(bench_stats_t const * stats) {
+ perf_counters_t const * counters = &stats->counters;
+ if (!perf_counters_any(counters)) {
+  return;
+ }
+ double const iterations = (double)stats->iterations * (double)stats->time.count;
+
+ printf("%-40s", "");
+ if (counters->available[PERF_CYCLES] && counters->available[PERF_INSTRUCTIONS]) {
+  printf(
+   " ipc %.2f",
+   counters->values[PERF_CYCLES]
+    ? (double)counters->values[PERF_INSTRUCTIONS]
+     / (double)counters->values[PERF_CYCLES]
+    : 0.0
+  );
+ }
+ for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+  if (!counters->available[i]) {
+   continue;
+  }
+  printf(
+   " %s/iter %.4g",
+   perf_counter_name((enum perf_counter_t)i),
+   (double)counters->values[i] / iterations
+  );
+ }
+ printf("\n");
+}
+
+//utility function for `bench_suite_run_and_emit`; prints per-iteration allocations
+static void bench_emit_allocs(bench_stats_t const * stats) {
+ double const iterations = (double)stats->iterations * (double)stats->time.count;
+ printf(
+  "%-40s allocs/op %.4g bytes/op %.4g peak-bytes %llu\n",
+  "",
+  (double)stats->allocs.allocs / iterations,
+  (double)stats->allocs.bytes / iterations,
+  (unsigned long long)stats->allocs.peak_bytes
+ );
+}
+
+//utility function for `bench_suite_run_and_emit`; prints latency percentiles
+static void bench_emit_latency(histogram_t const * latency) {
+ printf("%-40s latency ns/iter", "");
+ for (size_t i = 0; i < HISTOGRAM_REPORT_PERCENTILE_COUNT; i++) {
+  printf(
+   " p%g %llu",
+   histogram_report_percentiles[i],
+   (unsigned long long)histogram_percentile(latency, histogram_report_percentiles[i])
+  );
+ }
+ printf(" max %llu\n", (unsigned long long)latency->max);
+}
+
+//utility function for `bench_emit_complexity`; same family, same trailing args
+static bool bench_same_complexity_group(bench_impl_t const * a, bench_impl_t const * b) {
+ if (!a->family || !b->family || strcmp(a->family, b->family) != 0) {
+  return false;
+ }
+ if (a->arg_count != b->arg_count || a->thread_count != b->thread_count) {
+  return false;
+ }
+ for (size_t i = 1; i < a->arg_count; i++) {
+  if (a->args[i] != b->args[i]) {
+   return false;
+  }
+ }
+ return true;
+}
+
+//utility function for `bench_suite_run_and_emit`; fits parameterized benchmarks
+static void bench_emit_complexity(bench_suite_impl_t * suite_impl) {
+ size_t const count = suite_impl->bench_count;
+ bool * visited = calloc(count ? count : 1, sizeof(bool));
+ double * n = calloc(count ? count : 1, sizeof(double));
+ double * y = calloc(count ? count : 1, sizeof(double));
+ if (!visited || !n || !y) {
+  printf("complexity fit unavailable: failed to allocate scratch space\n");
+  free((void *)visited);
+  free((void *)n);
+  free((void *)y);
+  return;
+ }
+
+ bool header = false;
+ for (size_t i = 0; i < count; i++) {
+  bench_impl_t * first = suite_impl->benches + i;
+  if (visited[i] || !first->family || !first->arg_count || !first->sample_count) {
+   continue;
+  }
+
+  //gather medians of every instance that only differs in its first argument
+  size_t points = 0;
+  for (size_t j = i; j < count; j++) {
+   bench_impl_t * other = suite_impl->benches + j;
+   if (visited[j] || !other->sample_count || !bench_same_complexity_group(first, other)) {
+    continue;
+   }
+   visited[j] = true;
+   stats_summary_t summary;
+   if (!stats_summarize(other->samples, other->sample_count, &summary)) {
+    continue;
+   }
+   n[points] = (double)other->args[0];
+   y[points] = summary.median;
+   points++;
+  }
+
+  stats_complexity_fit_t fit;
+  if (!stats_fit_complexity(n, y, points, &fit)) {
+   continue;
+  }
+  if (!header) {
+   printf("\n%-40s %12s %16s %10s\n", "complexity (ns/iter)", "fit", "coefficient", "rms");
+   header = true;
+  }
+
+  //name the group by its family, with the fitted argument as `n`
+  //TODO: handle `string_format` failures
+  char const * name = string_format("%s/n", first->family);
+  for (size_t k = 1; k < first->arg_count; k++) {
+   char const * prefix = name;
+   name = string_format("%s/%lld", prefix, (long long)first->args[k]);
+   free((void *)prefix);
+  }
+  printf(
+   "%-40s %12s %16.4g %9.1f%%\n",
+   name,
+   stats_complexity_name(fit.complexity),
+   fit.coefficient,
+   fit.rms * 100.0
+  );
+  free((void *)name);
+ }
+
+ free((void *)visited);
+ free((void *)n);
+ free((void *)y);
+}
+
+//utility function for `bench_suite_run_and_emit`; prints median user counters
+static void bench_emit_user_counters(bench_impl_t * bench_impl) {
+ if (!bench_impl->counter_count) {
+  return;
+ }
+ printf("%-40s", "");
+ for (size_t i = 0; i < bench_impl->counter_count; i++) {
+  stats_summary_t summary;
+  if (!stats_summarize(
+   bench_impl->counter_samples + i * bench_impl->sample_count,
+   bench_impl->sample_count,
+   &summary
+  )) {
+   continue;
+  }
+  printf(" %s %.4g", bench_impl->counter_names[i], summary.median);
+ }
+ printf("\n");
+}
+
+//utility function for `bench_suite_run_and_emit`; warns about implausible timings
+static void bench_emit_too_fast(bench_stats_t const * stats) {
+ if (!stats->too_fast) {
+  return;
+ }
+ printf(
+  "%-40s too fast: an empty loop takes %.2f ns/iter; "
+  "the body may have been optimized away\n",
+  "",
+  stats->loop_floor
+ );
+}
+
+//utility function for `bench_suite_run_and_emit`; prints why a result is unreliable
+static void bench_emit_unstable(unsigned unstable) {
+ if (!unstable) {
+  return;
+ }
+ printf("%-40s unstable:", "");
+ for (unsigned flag = 1; flag <= BENCH_UNSTABLE_THROTTLED; flag <<= 1) {
+  if (unstable & flag) {
+   printf(" %s", bench_unstable_name((enum bench_unstable_t)flag));
+  }
+ }
+ printf("\n");
+}
+
+//utility function for `bench_suite_run_and_emit`; pins and reports the environment
+static cpu_env_t bench_stabilize_env(bench_runner_config_t runner_config) {
+ cpu_env_t env = NULL;
+ if (!runner_config.stabilize && !runner_config.raise_priority) {
+  return NULL;
+ }
+ char const * error = cpu_env_new(&env);
+ if (error) {
+  printf("benchmark environment unavailable: %s\n", error);
+  return NULL;
+ }
+
+ if (runner_config.stabilize) {
+  error = cpu_env_pin(&env);
+  if (error) {
+   printf("cpu pinning unavailable: %s\n", error);
+  } else {
+   printf("pinned to cpu %d\n", cpu_env_get_cpu(&env));
+  }
+
+  //dynamic governors change the frequency under load
+  cpu_frequency_t frequency;
+  cpu_frequency_sample(cpu_current(), &frequency);
+  if (frequency.governor[0] && strcmp(frequency.governor, "performance") != 0) {
+   printf(
+    "cpu %d uses the '%s' scaling governor; results may vary\n",
+    cpu_current(),
+    frequency.governor
+   );
+  }
+ }
+
+ if (runner_config.raise_priority) {
+  error = cpu_env_raise_priority(&env);
+  if (error) {
+   printf("priority unchanged: %s\n", error);
+  }
+ }
+ return env;
+}
+
+//utility function for `bench_emit_scaling`; same family and arguments
+static bool bench_same_scaling_group(bench_impl_t const * a, bench_impl_t const * b) {
+ if (!a->family || !b->family || strcmp(a->family, b->family) != 0) {
+  return false;
+ }
+ return a->arg_count == b->arg_count
+  && memcmp(a->args, b->args, sizeof(int64_t) * a->arg_count) == 0;
+}
+
+//utility function for `bench_suite_run_and_emit`; compares thread counts
+static void bench_emit_scaling(bench_suite_impl_t * suite_impl) {
+ bool header = false;
+ for (size_t i = 0; i < suite_impl->bench_count; i++) {
+  bench_impl_t * bench_impl = suite_impl->benches + i;
+  if (!bench_impl->thread_count || !bench_impl->sample_count) {
+   continue;
+  }
+  bench_t bench = (bench_t)bench_impl;
+  bench_stats_t stats;
+  if (bench_get_stats(&bench, &stats)) {
+   continue;
+  }
+
+  //single-threaded instance of the same benchmark, if any
+  double baseline = 0.0;
+  for (size_t j = 0; j < suite_impl->bench_count; j++) {
+   bench_impl_t * other = suite_impl->benches + j;
+   if (other->thread_count != 1 || !other->sample_count || !bench_same_scaling_group(bench_impl, other)) {
+    continue;
+   }
+   bench_t other_bench = (bench_t)other;
+   bench_stats_t other_stats;
+   if (!bench_get_stats(&other_bench, &other_stats)) {
+    baseline = other_stats.throughput.median;
+   }
+   break;
+  }
+
+  if (!header) {
+   printf(
+    "\n%-40s %8s %16s %10s %11s\n",
+    "scaling",
+    "threads",
+    "ops/s",
+    "speedup",
+    "efficiency"
+   );
+   header = true;
+  }
+  if (baseline > 0.0) {
+   double const speedup = stats.throughput.median / baseline;
+   printf(
+    "%-40s %8zu %16.4g %9.2fx %10.1f%%\n",
+    bench_impl->name,
+    stats.threads,
+    stats.throughput.median,
+    speedup,
+    speedup / (double)stats.threads * 100.0
+   );
+  } else {
+   printf(
+    "%-40s %8zu %16.4g %10s %11s\n",
+    bench_impl->name,
+    stats.threads,
+    stats.throughput.median,
+    "-",
+    "-"
+   );
+  }
+ }
+}
+
+//utility function for `bench_suite_run_and_emit`; variants in the group at `first`
+static size_t bench_comparison_count(bench_suite_impl_t * suite_impl, size_t first) {
+ bench_impl_t const * reference = suite_impl->benches + first;
+ size_t count = 1;
+ while (
+  first + count < suite_impl->bench_count
+  && suite_impl->benches[first + count].comparison
+  && suite_impl->benches[first + count].comparison_index == count
+  && strcmp(suite_impl->benches[first + count].comparison, reference->comparison) == 0
+ ) {
+  count++;
+ }
+ return count;
+}
+
+//utility function for `bench_suite_run_and_emit`; prints paired comparisons
+static void bench_emit_comparisons(bench_suite_impl_t * suite_impl) {
+ bool header = false;
+ bench_impl_t const * reference = NULL;
+ for (size_t i = 0; i < suite_impl->bench_count; i++) {
+  bench_impl_t const * bench_impl = suite_impl->benches + i;
+  if (!bench_impl->comparison) {
+   continue;
+  }
+  if (!bench_impl->comparison_index) {
+   reference = bench_impl;
+   continue;
+  }
+  if (!reference || !bench_impl->compared.rounds) {
+   continue;
+  }
+
+  if (!header) {
+   printf(
+    "\n%-40s %-30s %9s %21s %8s\n",
+    "comparison",
+    "reference",
+    "median",
+    "interval",
+    "verdict"
+   );
+   header = true;
+  }
+  bench_comparison_t const * compared = &bench_impl->compared;
+  char const * verdict = "same";
+  if (compared->interval.upper < 0.0) {
+   verdict = "faster";
+  } else if (compared->interval.lower > 0.0) {
+   verdict = "slower";
+  }
+  //TODO: handle `string_format` failures
+  char const * interval = string_format(
+   "[%+.1f%%, %+.1f%%] %2.0f%%",
+   compared->interval.lower,
+   compared->interval.upper,
+   compared->interval.confidence * 100.0
+  );
+  printf(
+   "%-40s %-30s %+8.1f%% %21s %8s\n",
+   bench_impl->name,
+   reference->name,
+   compared->median,
+   interval,
+   verdict
+  );
+  free((void *)interval);
+ }
+}
+
+//`bench_suite_run_and_emit` implementation
+size_t bench_suite_run_and_emit(
+ bench_suite_t * suite,
+ bench_runner_config_t runner_config
+) {
+ size_t failures_encountered = 0;
+ bench_suite_impl_t * suite_impl = bench_suite_get_impl(suite);
+
+ //let the user know up front when requested counters cannot be sampled
+ if (runner_config.perf_counters) {
+  perf_group_t probe = NULL;
+  char const * error = perf_group_new(&probe);
+  if (error) {
+   printf("perf counters unavailable: %s\n", error);
+  }
+  perf_group_free(&probe);
+ }
+ if (runner_config.alloc_tracking && !alloc_tracking_available()) {
+  printf("allocation tracking unavailable: no allocation interposer linked\n");
+ }
+
+ //benchmarks registered per library never run without libraries
+ if (suite_impl->library_benches && !suite_impl->libraries_added) {
+  printf(
+   "skipping %zu per-library benchmark(s): no libraries loaded\n",
+   bench_suite_get_impl(&suite_impl->library_benches)->bench_count
+  );
+ }
+
+ cpu_env_t env = bench_stabilize_env(runner_config);
+
+ printf(
+  "%-40s %12s %5s %12s %12s %10s %10s %12s\n",
+  "benchmark (ns/iter)",
+  "iterations",
+  "reps",
+  "mean",
+  "median",
+  "stddev",
+  "mad",
+  "min"
+ );
+
+ for (size_t i = 0; i < suite_impl->bench_count; i++) {
+  bench_impl_t * bench_impl = suite_impl->benches + i;
+  bench_t bench = (bench_t)bench_impl;
+
+  //run benchmark; comparison groups run all their variants on reaching the
+  //first. If it fails, make note and skip
+  char const * error = NULL;
+  if (!bench_impl->comparison) {
+   error = bench_run(&bench, runner_config);
+  } else {
+   if (!bench_impl->comparison_index) {
+    bench_run_comparison(
+     bench_impl,
+     bench_comparison_count(suite_impl, i),
+     runner_config
+    );
+   }
+   error = bench_impl->error;
+  }
+  if (error) {
+   printf("%-40s error: %s\n", bench_impl->name, error);
+   failures_encountered++;
+   continue;
+  }
+
+  bench_stats_t stats;
+  handle_internal_failure(bench_get_stats(&bench, &stats), __func__);
+  bench_emit_stats(bench_impl->name, &stats);
+  bench_emit_unstable(stats.unstable);
+  bench_emit_too_fast(&stats);
+  bench_emit_user_counters(bench_impl);
+  bench_emit_counters(&stats);
+  if (runner_config.alloc_tracking) {
+   bench_emit_allocs(&stats);
+  }
+  if (bench_impl->latency) {
+   bench_emit_latency(bench_impl->latency);
+  }
+ }
+
+ //fit parameterized benchmarks to complexity models
+ bench_emit_complexity(suite_impl);
+
+ //compare threaded benchmarks against their single-threaded instance
+ bench_emit_scaling(suite_impl);
+
+ //compare the variants of every comparison group against their reference
+ bench_emit_comparisons(suite_impl);
+
+ //restore affinity and priority
+ cpu_env_free(&env);
+
+ return failures_encountered;
+}
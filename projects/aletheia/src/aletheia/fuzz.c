@@ -0,0 +1,615 @@
+#define _GNU_SOURCE
+
+#include <aletheia/fuzz.h>
+#include <aletheia/util/random.h>
+#include <aletheia/util/string.h>
+#include <aletheia/util/time.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//maximum number of coverage guards; guards beyond it are not tracked
+#define FUZZ_MAX_GUARDS ((size_t)1 << 20)
+//mutations stacked onto a single input, at most
+#define FUZZ_MAX_MUTATIONS 4
+//runs between checks of the time limit
+#define FUZZ_TIME_CHECK_INTERVAL 1024
+
+//coverage state, shared by all instrumented modules; index `0` is unused, so
+//that a zero guard means untracked
+static uint32_t fuzz_guard_count = 0;
+static uint8_t fuzz_counters[FUZZ_MAX_GUARDS];
+
+//called once per instrumented module by `-fsanitize-coverage=trace-pc-guard`
+void __sanitizer_cov_trace_pc_guard_init(uint32_t * start, uint32_t * stop);
+void __sanitizer_cov_trace_pc_guard_init(uint32_t * start, uint32_t * stop) {
+ if (start == stop || *start) {
+  return;
+ }
+ for (uint32_t * guard = start; guard < stop; guard++) {
+  *guard = fuzz_guard_count + 1 < FUZZ_MAX_GUARDS ? ++fuzz_guard_count : 0;
+ }
+}
+
+//called on every instrumented edge; counters saturate instead of wrapping
+void __sanitizer_cov_trace_pc_guard(uint32_t * guard);
+void __sanitizer_cov_trace_pc_guard(uint32_t * guard) {
+ uint8_t * counter = fuzz_counters + *guard;
+ *counter += *counter != UINT8_MAX;
+}
+
+//registered targets, and the corpus root directory
+static fuzz_target_t * fuzz_targets = NULL;
+static char const * fuzz_corpus = NULL;
+
+//`fuzz_set_corpus` implementation
+void fuzz_set_corpus(char const * path) {
+ fuzz_corpus = path;
+}
+
+//single corpus input; mapped inputs are owned by the mapping
+typedef struct {
+ char * name;
+ uint8_t * data;
+ size_t size;
+ bool mapped;
+} fuzz_input_t;
+
+//inputs of a target
+typedef struct {
+ size_t
+  count,
+  capacity;
+ fuzz_input_t * inputs;
+} fuzz_corpus_t;
+
+//utility function; appends `input`, taking ownership of its contents
+static void fuzz_corpus_push(fuzz_corpus_t * corpus, fuzz_input_t input) {
+ if (corpus->count == corpus->capacity) {
+  corpus->capacity = corpus->capacity ? corpus->capacity * 2 : 16;
+  //TODO: handle `realloc` failure
+  corpus->inputs = realloc(corpus->inputs, corpus->capacity * sizeof(fuzz_input_t));
+ }
+ corpus->inputs[corpus->count++] = input;
+}
+
+static void fuzz_corpus_free(fuzz_corpus_t * corpus) {
+ for (size_t i = 0; i < corpus->count; i++) {
+  fuzz_input_t * input = corpus->inputs + i;
+  if (input->mapped) {
+   munmap((void *)input->data, input->size);
+  } else {
+   free((void *)input->data);
+  }
+  free((void *)input->name);
+ }
+ free((void *)corpus->inputs);
+ memset(corpus, 0, sizeof(fuzz_corpus_t));
+}
+
+//utility function; path of the corpus directory of `target`, or `NULL`
+static char * fuzz_corpus_path(fuzz_target_t const * target) {
+ if (!fuzz_corpus) {
+  return NULL;
+ }
+ //TODO: handle `string_format` failures
+ return string_format("%s/%s", fuzz_corpus, target->name);
+}
+
+static int fuzz_corpus_filter(struct dirent const * entry) {
+ return entry->d_name[0] != '.';
+}
+
+/**
+ *utility function; maps every regular file in `path` into `corpus`, sorted by
+ *name. Inputs are mapped read-only rather than copied; empty inputs have no
+ *mapping. A missing directory is an empty corpus
+ */
+static char const * fuzz_corpus_load(fuzz_corpus_t * corpus, char const * path) {
+ struct dirent ** entries = NULL;
+ int const entry_count = scandir(path, &entries, fuzz_corpus_filter, alphasort);
+ if (entry_count < 0) {
+  return errno == ENOENT ? NULL : "Failed to list fuzz corpus directory!";
+ }
+
+ char const * error = NULL;
+ for (int i = 0; i < entry_count; i++) {
+  //TODO: handle `string_format` failures
+  char * file_path = string_format("%s/%s", path, entries[i]->d_name);
+  int const fd = open(file_path, O_RDONLY | O_CLOEXEC);
+  free((void *)file_path);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0) {
+   error = error ? error : "Failed to open fuzz corpus input!";
+  } else if (S_ISREG(status.st_mode)) {
+   fuzz_input_t input = {
+    .name = string_format("%s", entries[i]->d_name),
+    .data = NULL,
+    .size = (size_t)status.st_size,
+    .mapped = status.st_size > 0
+   };
+   if (input.mapped) {
+    void * data = mmap(NULL, input.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+     error = error ? error : "Failed to map fuzz corpus input!";
+     free((void *)input.name);
+     input.name = NULL;
+    } else {
+     input.data = data;
+    }
+   }
+   if (input.name) {
+    fuzz_corpus_push(corpus, input);
+   }
+  }
+  if (fd >= 0) {
+   close(fd);
+  }
+  free((void *)entries[i]);
+ }
+ free((void *)entries);
+ return error;
+}
+
+//utility function; FNV-1a hash naming inputs written to disk
+static uint64_t fuzz_hash(uint8_t const * data, size_t size) {
+ uint64_t hash = UINT64_C(0xcbf29ce484222325);
+ for (size_t i = 0; i < size; i++) {
+  hash = (hash ^ data[i]) * UINT64_C(0x100000001b3);
+ }
+ return hash;
+}
+
+//utility function; writes `size` bytes of `data` to a new file at `path`
+static char const * fuzz_write_file(char const * path, uint8_t const * data, size_t size) {
+ FILE * file = fopen(path, "wb");
+ if (!file) {
+  return "Failed to create fuzz input file!";
+ }
+ bool const written = fwrite(data, 1, size, file) == size;
+ if (fclose(file) != 0 || !written) {
+  return "Failed to write fuzz input file!";
+ }
+ return NULL;
+}
+
+//utility function; whether the failures of `test` fail it
+static bool fuzz_test_failed(test_t * test) {
+ enum test_status_t status = TEST_NOT_RUN;
+ test_get_status(test, &status);
+ return status == TEST_FAIL || status == TEST_OK_OTHER_FAIL;
+}
+
+//utility function for `fuzz_replay`; runs a single input against a scratch
+//test, then reports its failures on `test` along with the input's name
+static void fuzz_replay_input(
+ fuzz_target_t * target,
+ test_t * test,
+ char const * name,
+ uint8_t const * data,
+ size_t size
+) {
+ test_t scratch;
+ handle_internal_failure(test_new(&scratch, target->name, NULL), __func__);
+ target->callback(scratch, data, size);
+
+ size_t failure_count = 0;
+ test_failure_t * failures = NULL;
+ handle_internal_failure(test_get_failures(&scratch, &failure_count, &failures), __func__);
+ char const * error = NULL;
+ for (size_t i = 0; i < failure_count && !error; i++) {
+  //TODO: handle `string_format` failures
+  char * cause = string_format("Input '%s' (%zu bytes): %s", name, size, failures[i].cause);
+  error = (failures[i].fatal ? test_push_failure : test_push_opt_failure)(
+   test,
+   failures[i].file,
+   failures[i].line,
+   cause
+  );
+  free((void *)cause);
+ }
+ test_failures_free(&failure_count, &failures);
+ test_free(&scratch);
+ handle_internal_failure(error, __func__);
+}
+
+//test callback replaying the corpus of the fuzz target in `ctx`
+static void fuzz_replay(test_t test, void * ctx) {
+ fuzz_target_t * target = ctx;
+ fuzz_corpus_t corpus;
+ memset(&corpus, 0, sizeof(corpus));
+ char * path = fuzz_corpus_path(target);
+ char const * error = path ? fuzz_corpus_load(&corpus, path) : NULL;
+ free((void *)path);
+ if (error) {
+  test_push_failure(&test, __FILE__, __LINE__, error);
+ }
+
+ //without any corpus, at least the empty input runs
+ if (!corpus.count) {
+  fuzz_replay_input(target, &test, "<empty>", NULL, 0);
+ }
+ for (size_t i = 0; i < corpus.count; i++) {
+  fuzz_input_t const * input = corpus.inputs + i;
+  fuzz_replay_input(target, &test, input->name, input->data, input->size);
+ }
+ fuzz_corpus_free(&corpus);
+ test_ok(&test);
+}
+
+//`fuzz_test_new` implementation
+char const * fuzz_test_new(test_t * dst, fuzz_target_t * target) {
+ char const * error = test_new(dst, target->name, fuzz_replay);
+ if (error) {
+  return error;
+ }
+ test_set_ctx(dst, (void *)target);
+ if (!target->registered) {
+  target->registered = true;
+  target->next = fuzz_targets;
+  fuzz_targets = target;
+ }
+ return NULL;
+}
+
+//state of a fuzzing session
+typedef struct {
+ fuzz_target_t * target;
+ fuzz_config_t config;
+ random_t random;
+ fuzz_corpus_t corpus;
+ //corpus directory to save new inputs to, if any
+ char * corpus_path;
+ //hit count buckets seen so far, per guard
+ uint8_t * seen;
+ size_t features;
+ //reused across runs; failures end the session, so it never needs a reset
+ test_t test;
+ //scratch buffer inputs are mutated in
+ uint8_t * buffer;
+} fuzz_session_t;
+
+//utility function; bucket of a non-zero hit count, as a bit
+static uint8_t fuzz_bucket(uint8_t count) {
+ if (count < 4) {
+  return (uint8_t)(1u << (count - 1));
+ }
+ if (count < 8) {
+  return 1u << 3;
+ }
+ if (count < 16) {
+  return 1u << 4;
+ }
+ if (count < 32) {
+  return 1u << 5;
+ }
+ return count < 128 ? 1u << 6 : 1u << 7;
+}
+
+//utility function; adds the features hit by the last run, returning how many
+//were new
+static size_t fuzz_collect(fuzz_session_t * session) {
+ size_t found = 0;
+ size_t const count = (size_t)fuzz_guard_count + 1;
+ for (size_t i = 1; i < count; i++) {
+  if (!fuzz_counters[i]) {
+   continue;
+  }
+  uint8_t const bucket = fuzz_bucket(fuzz_counters[i]);
+  if (!(session->seen[i] & bucket)) {
+   session->seen[i] |= bucket;
+   found++;
+  }
+ }
+ session->features += found;
+ return found;
+}
+
+//utility function; runs `size` bytes of `data`, which must be an exact-size
+//allocation so that overreads are caught by sanitizers, and returns whether
+//the target failed
+static bool fuzz_execute(fuzz_session_t * session, uint8_t const * data, size_t size) {
+ memset(fuzz_counters, 0, (size_t)fuzz_guard_count + 1);
+ session->target->callback(session->test, data, size);
+ return fuzz_test_failed(&session->test);
+}
+
+//utility function for `fuzz_mutate`; inserts `count` bytes of `src` at `at`
+static size_t fuzz_insert(
+ uint8_t * buffer,
+ size_t length,
+ size_t at,
+ uint8_t const * src,
+ size_t count
+) {
+ memmove(buffer + at + count, buffer + at, length - at);
+ memmove(buffer + at, src, count);
+ return length + count;
+}
+
+//utility function; applies a single random mutation to the `length` bytes in
+//`buffer`, returning the new length
+static size_t fuzz_mutate(fuzz_session_t * session, uint8_t * buffer, size_t length) {
+ static uint8_t const interesting[] = {0x00, 0x01, 0x10, 0x20, 0x40, 0x7f, 0x80, 0xff};
+ random_t * random = &session->random;
+ size_t const max_length = session->config.max_length;
+ unsigned kind = (unsigned)random_below(random, 8);
+ //empty inputs only grow, and full ones only shrink or change
+ if (!length) {
+  kind = 5;
+ } else if (length == max_length && kind >= 5) {
+  kind = 4;
+ }
+
+ size_t const at = (size_t)random_below(random, length ? length : 1);
+ switch (kind) {
+  case 0: {
+   buffer[at] ^= (uint8_t)(1u << random_below(random, 8));
+   return length;
+  }
+  case 1: {
+   buffer[at] = (uint8_t)random_next(random);
+   return length;
+  }
+  case 2: {
+   buffer[at] = interesting[random_below(random, sizeof(interesting))];
+   return length;
+  }
+  case 3: {
+   buffer[at] = (uint8_t)(buffer[at] + random_below(random, 17) - 8);
+   return length;
+  }
+  case 4: {
+   size_t const max_count = length - at < FUZZ_MAX_MUTATIONS ? length - at : FUZZ_MAX_MUTATIONS;
+   size_t const count = 1 + (size_t)random_below(random, max_count);
+   memmove(buffer + at, buffer + at + count, length - at - count);
+   return length - count;
+  }
+  case 5: {
+   uint8_t bytes[FUZZ_MAX_MUTATIONS];
+   size_t const room = max_length - length;
+   size_t const count = 1 + (size_t)random_below(random, room < FUZZ_MAX_MUTATIONS ? room : FUZZ_MAX_MUTATIONS);
+   for (size_t i = 0; i < count; i++) {
+    bytes[i] = (uint8_t)random_next(random);
+   }
+   return fuzz_insert(buffer, length, (size_t)random_below(random, length + 1), bytes, count);
+  }
+  case 6: {
+   //duplicate a chunk of the input itself
+   uint8_t chunk[64];
+   size_t const room = max_length - length;
+   size_t count = 1 + (size_t)random_below(random, length - at);
+   count = count < room ? count : room;
+   count = count < sizeof(chunk) ? count : sizeof(chunk);
+   memcpy(chunk, buffer + at, count);
+   return fuzz_insert(buffer, length, (size_t)random_below(random, length + 1), chunk, count);
+  }
+  default: {
+   //splice in a chunk of another corpus input
+   fuzz_corpus_t const * corpus = &session->corpus;
+   fuzz_input_t const * other = corpus->inputs + random_below(random, corpus->count);
+   if (!other->size) {
+    return length;
+   }
+   size_t const from = (size_t)random_below(random, other->size);
+   size_t const room = max_length - length;
+   size_t count = 1 + (size_t)random_below(random, other->size - from);
+   count = count < room ? count : room;
+   return fuzz_insert(buffer, length, (size_t)random_below(random, length + 1), other->data + from, count);
+  }
+ }
+}
+
+//utility function; saves `input` as a new corpus input, if there is a corpus
+//directory
+static void fuzz_save(fuzz_session_t * session, fuzz_input_t * input) {
+ if (!session->corpus_path) {
+  return;
+ }
+ //TODO: handle `string_format` failures
+ char * path = string_format("%s/%s", session->corpus_path, input->name);
+ char const * error = fuzz_write_file(path, input->data, input->size);
+ if (error) {
+  printf("%s ('%s')\n", error, path);
+ }
+ free((void *)path);
+}
+
+//utility function; writes the failing input and prints the target's failures
+static void fuzz_report_failure(fuzz_session_t * session, uint8_t const * data, size_t size) {
+ //TODO: handle `string_format` failures
+ char * path = string_format(
+  "%s%s%s-crash-%016llx",
+  fuzz_corpus ? fuzz_corpus : "",
+  fuzz_corpus ? "/" : "",
+  session->target->name,
+  (unsigned long long)fuzz_hash(data, size)
+ );
+ char const * error = fuzz_write_file(path, data, size);
+ printf(
+  "fuzz target '%s' failed on a %zu byte input, %s '%s':\n",
+  session->target->name,
+  size,
+  error ? "failed to write it to" : "written to",
+  path
+ );
+ free((void *)path);
+
+ size_t failure_count = 0;
+ test_failure_t * failures = NULL;
+ handle_internal_failure(test_get_failures(&session->test, &failure_count, &failures), __func__);
+ for (size_t i = 0; i < failure_count; i++) {
+  printf("%s:%d: %s\n", failures[i].file, failures[i].line, failures[i].cause);
+ }
+ test_failures_free(&failure_count, &failures);
+}
+
+/**
+ *utility function; runs `size` bytes of `data` and returns whether the target
+ *failed. If `keep` is set, inputs reaching new features are added to the
+ *corpus and saved; corpus inputs being replayed only add their features
+ */
+static bool fuzz_try(
+ fuzz_session_t * session,
+ uint8_t const * data,
+ size_t size,
+ bool keep,
+ fuzz_stats_t * dst
+) {
+ //TODO: handle `malloc` failure
+ uint8_t * copy = malloc(size ? size : 1);
+ if (size) {
+  memcpy(copy, data, size);
+ } else {
+  //empty inputs still get a valid, initialized pointer
+  *copy = 0;
+ }
+ dst->runs++;
+ if (fuzz_execute(session, copy, size)) {
+  fuzz_report_failure(session, copy, size);
+  free((void *)copy);
+  return true;
+ }
+ if (!fuzz_collect(session) || !keep) {
+  free((void *)copy);
+  return false;
+ }
+
+ fuzz_input_t input = {
+  .name = string_format("%016llx", (unsigned long long)fuzz_hash(copy, size)),
+  .data = copy,
+  .size = size,
+  .mapped = false
+ };
+ fuzz_save(session, &input);
+ fuzz_corpus_push(&session->corpus, input);
+ printf(
+  "#%llu\tnew\tfeatures: %zu\tcorpus: %zu\tlength: %zu\n",
+  (unsigned long long)dst->runs,
+  session->features,
+  session->corpus.count,
+  size
+ );
+ return false;
+}
+
+//`fuzz_run` implementation
+char const * fuzz_run(char const * name, fuzz_config_t config, fuzz_stats_t * dst) {
+ memset(dst, 0, sizeof(fuzz_stats_t));
+ fuzz_target_t * target = fuzz_targets;
+ while (target && strcmp(target->name, name) != 0) {
+  target = target->next;
+ }
+ if (!target) {
+  return "No fuzz target with the given name is registered!";
+ }
+ if (!config.max_length) {
+  return "Fuzzing needs a non-zero maximum input length!";
+ }
+
+ fuzz_session_t session;
+ memset(&session, 0, sizeof(session));
+ session.target = target;
+ session.config = config;
+ random_seed(&session.random, config.seed ? config.seed : random_mix(time_now_ns()));
+ session.seen = calloc(FUZZ_MAX_GUARDS, 1);
+ session.buffer = malloc(config.max_length);
+ if (!session.seen || !session.buffer) {
+  free((void *)session.seen);
+  free((void *)session.buffer);
+  return "Failed to allocate space for fuzzing!";
+ }
+ handle_internal_failure(test_new(&session.test, target->name, NULL), __func__);
+
+ //prepare the corpus directory, then load its inputs
+ fuzz_corpus_t initial;
+ memset(&initial, 0, sizeof(initial));
+ char const * error = NULL;
+ session.corpus_path = fuzz_corpus_path(target);
+ if (session.corpus_path) {
+  mkdir(fuzz_corpus, 0777);
+  mkdir(session.corpus_path, 0777);
+  error = fuzz_corpus_load(&initial, session.corpus_path);
+ }
+ if (!fuzz_guard_count) {
+  printf("warning: no coverage instrumentation found; build with `-fsanitize-coverage=trace-pc-guard`\n");
+ }
+
+ //replay existing inputs first, so that only new features grow the corpus
+ uint64_t const start_ns = time_now_ns();
+ bool failed = false;
+ if (!initial.count) {
+  failed = fuzz_try(&session, NULL, 0, true, dst);
+  if (!failed && !session.corpus.count) {
+   fuzz_corpus_push(&session.corpus, (fuzz_input_t) {
+    .name = string_format("<empty>"),
+    .data = NULL,
+    .size = 0,
+    .mapped = false
+   });
+  }
+ }
+ for (size_t i = 0; i < initial.count && !failed; i++) {
+  failed = fuzz_try(&session, initial.inputs[i].data, initial.inputs[i].size, false, dst);
+ }
+ //every existing input is mutated, whether it reached new features or not
+ for (size_t i = 0; i < initial.count; i++) {
+  fuzz_corpus_push(&session.corpus, initial.inputs[i]);
+ }
+ free((void *)initial.inputs);
+
+ //mutate inputs until a limit is hit or an input fails
+ while (!failed && !error) {
+  if (config.max_runs && dst->runs >= config.max_runs) {
+   break;
+  }
+  if (
+   config.max_time_ns
+   && dst->runs % FUZZ_TIME_CHECK_INTERVAL == 0
+   && time_now_ns() - start_ns >= config.max_time_ns
+  ) {
+   break;
+  }
+  fuzz_input_t const * input = session.corpus.inputs
+   + random_below(&session.random, session.corpus.count);
+  size_t length = input->size < config.max_length ? input->size : config.max_length;
+  if (length) {
+   memcpy(session.buffer, input->data, length);
+  }
+  size_t const mutations = 1 + (size_t)random_below(&session.random, FUZZ_MAX_MUTATIONS);
+  for (size_t i = 0; i < mutations; i++) {
+   length = fuzz_mutate(&session, session.buffer, length);
+  }
+  failed = fuzz_try(&session, session.buffer, length, true, dst);
+ }
+
+ dst->elapsed_ns = time_now_ns() - start_ns;
+ dst->corpus_size = session.corpus.count;
+ dst->features = session.features;
+ dst->failed = failed;
+ printf(
+  "fuzzed '%s': %llu runs in %.3f s (%.0f runs/s), %zu features, corpus of %zu inputs\n",
+  target->name,
+  (unsigned long long)dst->runs,
+  (double)dst->elapsed_ns / 1e9,
+  dst->elapsed_ns ? (double)dst->runs * 1e9 / (double)dst->elapsed_ns : 0.0,
+  dst->features,
+  dst->corpus_size
+ );
+
+ test_free(&session.test);
+ fuzz_corpus_free(&session.corpus);
+ free((void *)session.corpus_path);
+ free((void *)session.seen);
+ free((void *)session.buffer);
+ return error;
+}
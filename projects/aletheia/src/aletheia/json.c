@@ -0,0 +1,386 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <aletheia/json.h>
+#include <aletheia/test.h>
+#include <aletheia/util/cpu.h>
+#include <aletheia/util/string.h>
+#include <aletheia/util/stats.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <unistd.h>
+
+//maximum number of caches described in the context block
+#define BENCH_JSON_MAX_CACHES 16
+
+//`bench_json_write_string` implementation
+void bench_json_write_string(FILE * dst, char const * value) {
+ fputc('"', dst);
+ for (unsigned char const * c = (unsigned char const *)value; *c; c++) {
+  switch (*c) {
+   case '"': fputs("\\\"", dst); break;
+   case '\\': fputs("\\\\", dst); break;
+   case '\b': fputs("\\b", dst); break;
+   case '\f': fputs("\\f", dst); break;
+   case '\n': fputs("\\n", dst); break;
+   case '\r': fputs("\\r", dst); break;
+   case '\t': fputs("\\t", dst); break;
+   default:
+    if (*c < 0x20) {
+     fprintf(dst, "\\u%04x", (unsigned)*c);
+    } else {
+     fputc(*c, dst);
+    }
+    break;
+  }
+ }
+ fputc('"', dst);
+}
+
+//utility function; JSON has no representation for non-finite numbers
+static void bench_json_write_number(FILE * dst, double value) {
+ fprintf(dst, "%.17g", isfinite(value) ? value : 0.0);
+}
+
+//utility function; writes the `context` block
+static void bench_json_write_context(FILE * dst, char const * executable) {
+ //ISO 8601 local time, with a `+hh:mm` offset
+ char date[64] = "";
+ time_t const now = time(NULL);
+ struct tm local;
+ if (localtime_r(&now, &local) && strftime(date, sizeof(date) - 1, "%Y-%m-%dT%H:%M:%S%z", &local)) {
+  size_t const length = strlen(date);
+  if (length >= 5) {
+   memmove(date + length - 1, date + length - 2, 3);
+   date[length - 2] = ':';
+  }
+ }
+
+ char host_name[256] = "";
+ if (gethostname(host_name, sizeof(host_name) - 1) != 0) {
+  host_name[0] = '\0';
+ }
+
+ cpu_frequency_t frequency;
+ cpu_frequency_sample(0, &frequency);
+
+ fputs(" \"context\": {\n  \"date\": ", dst);
+ bench_json_write_string(dst, date);
+ fputs(",\n  \"host_name\": ", dst);
+ bench_json_write_string(dst, host_name);
+ fputs(",\n  \"executable\": ", dst);
+ bench_json_write_string(dst, executable ? executable : "");
+ fprintf(dst, ",\n  \"num_cpus\": %zu", cpu_count());
+ fputs(",\n  \"mhz_per_cpu\": ", dst);
+ fprintf(dst, "%.0f", cpu_mhz());
+ fprintf(
+  dst,
+  ",\n  \"cpu_scaling_enabled\": %s",
+  frequency.governor[0] && strcmp(frequency.governor, "performance") != 0
+   ? "true"
+   : "false"
+ );
+
+ //caches of the first cpu
+ cpu_cache_t caches[BENCH_JSON_MAX_CACHES];
+ size_t const cache_count = cpu_caches(caches, BENCH_JSON_MAX_CACHES);
+ fputs(",\n  \"caches\": [", dst);
+ for (size_t i = 0; i < cache_count; i++) {
+  fputs(i ? ",\n   {" : "\n   {", dst);
+  fputs("\"type\": ", dst);
+  bench_json_write_string(dst, caches[i].type);
+  fprintf(
+   dst,
+   ", \"level\": %d, \"size\": %llu, \"num_sharing\": %zu}",
+   caches[i].level,
+   (unsigned long long)caches[i].size,
+   caches[i].sharing
+  );
+ }
+ fputs(cache_count ? "\n  ]" : "]", dst);
+
+ double load[3];
+ if (cpu_load_average(load)) {
+  fputs(",\n  \"load_avg\": [", dst);
+  for (size_t i = 0; i < 3; i++) {
+   if (i) {
+    fputs(", ", dst);
+   }
+   bench_json_write_number(dst, load[i]);
+  }
+  fputs("]", dst);
+ }
+
+#ifdef NDEBUG
+ fputs(",\n  \"library_build_type\": \"release\"", dst);
+#else
+ fputs(",\n  \"library_build_type\": \"debug\"", dst);
+#endif
+ fputs("\n },\n", dst);
+}
+
+//utility type for `bench_json_write`; everything written for one benchmark
+typedef struct {
+ char const * name;
+ size_t family_index;
+ size_t instance_index;
+ bench_stats_t stats;
+ char const * error;
+ size_t sample_count;
+ double * samples;
+ double * cpu_samples;
+ size_t counter_count;
+ char ** counter_names;
+ double ** counter_samples;
+} bench_json_entry_t;
+
+//utility function for `bench_json_write`
+static void bench_json_entry_free(bench_json_entry_t * entry) {
+ free((void *)entry->name);
+ free((void *)entry->samples);
+ free((void *)entry->cpu_samples);
+ for (size_t i = 0; i < entry->counter_count; i++) {
+  free((void *)entry->counter_names[i]);
+  if (entry->counter_samples) {
+   free((void *)entry->counter_samples[i]);
+  }
+ }
+ free((void *)entry->counter_names);
+ free((void *)entry->counter_samples);
+ memset(entry, 0, sizeof(bench_json_entry_t));
+}
+
+//utility function for `bench_json_write`
+static char const * bench_json_entry_load(bench_t * bench, bench_json_entry_t * entry) {
+ char const * error = NULL;
+ memset(entry, 0, sizeof(bench_json_entry_t));
+
+ if (
+  (error = bench_get_name(bench, &entry->name))
+  || (error = bench_get_error(bench, &entry->error))
+  || (error = bench_get_stats(bench, &entry->stats))
+  || (error = bench_get_samples(bench, &entry->sample_count, &entry->samples))
+  || (error = bench_get_cpu_samples(bench, &entry->sample_count, &entry->cpu_samples))
+  || (error = bench_get_counter_names(bench, &entry->counter_count, &entry->counter_names))
+ ) {
+  bench_json_entry_free(entry);
+  return error;
+ }
+
+ entry->counter_samples = calloc(entry->counter_count ? entry->counter_count : 1, sizeof(double *));
+ if (!entry->counter_samples) {
+  bench_json_entry_free(entry);
+  return "Failed to allocate space for benchmark counters!";
+ }
+ for (size_t i = 0; i < entry->counter_count; i++) {
+  size_t count = 0;
+  error = bench_get_counter_samples(bench, i, &count, entry->counter_samples + i);
+  if (error) {
+   bench_json_entry_free(entry);
+   return error;
+  }
+ }
+ return NULL;
+}
+
+//utility function for `bench_json_write`; members shared by every run
+static void bench_json_write_run_header(
+ FILE * dst,
+ bench_json_entry_t const * entry,
+ char const * suffix,
+ char const * run_type
+) {
+ //aggregate runs are named after their run, with the aggregate as suffix
+ //TODO: handle `string_format` failures
+ char const * name = string_format("%s%s", entry->name, suffix);
+ fputs("  {\n   \"name\": ", dst);
+ bench_json_write_string(dst, name);
+ free((void *)name);
+ fprintf(dst, ",\n   \"family_index\": %zu", entry->family_index);
+ fprintf(dst, ",\n   \"per_family_instance_index\": %zu", entry->instance_index);
+ fputs(",\n   \"run_name\": ", dst);
+ bench_json_write_string(dst, entry->name);
+ fprintf(dst, ",\n   \"run_type\": \"%s\"", run_type);
+ fprintf(dst, ",\n   \"repetitions\": %zu", entry->sample_count ? entry->sample_count : 1);
+}
+
+//utility function for `bench_json_write`; one run per measured repetition
+static void bench_json_write_iterations(FILE * dst, bench_json_entry_t const * entry, bool * first) {
+ //failed benchmarks are reported as a single errored run
+ if (entry->error || !entry->sample_count) {
+  fputs(*first ? "" : ",\n", dst);
+  *first = false;
+  bench_json_write_run_header(dst, entry, "", "iteration");
+  fprintf(dst, ",\n   \"repetition_index\": 0");
+  fprintf(dst, ",\n   \"threads\": %zu", entry->stats.threads ? entry->stats.threads : 1);
+  fputs(",\n   \"iterations\": 0,\n   \"real_time\": 0,\n   \"cpu_time\": 0", dst);
+  fputs(",\n   \"time_unit\": \"ns\",\n   \"error_occurred\": true", dst);
+  fputs(",\n   \"error_message\": ", dst);
+  bench_json_write_string(dst, entry->error ? entry->error : "Benchmark did not run!");
+  fputs("\n  }", dst);
+  return;
+ }
+
+ for (size_t i = 0; i < entry->sample_count; i++) {
+  fputs(*first ? "" : ",\n", dst);
+  *first = false;
+  bench_json_write_run_header(dst, entry, "", "iteration");
+  fprintf(dst, ",\n   \"repetition_index\": %zu", i);
+  fprintf(dst, ",\n   \"threads\": %zu", entry->stats.threads);
+  fprintf(dst, ",\n   \"iterations\": %llu", (unsigned long long)entry->stats.iterations);
+  fputs(",\n   \"real_time\": ", dst);
+  bench_json_write_number(dst, entry->samples[i]);
+  fputs(",\n   \"cpu_time\": ", dst);
+  bench_json_write_number(dst, entry->cpu_samples[i]);
+  fputs(",\n   \"time_unit\": \"ns\"", dst);
+  for (size_t c = 0; c < entry->counter_count; c++) {
+   fputs(",\n   ", dst);
+   bench_json_write_string(dst, entry->counter_names[c]);
+   fputs(": ", dst);
+   bench_json_write_number(dst, entry->counter_samples[c][i]);
+  }
+  fputs("\n  }", dst);
+ }
+}
+
+//aggregates written for benchmarks with more than one repetition
+enum bench_json_aggregate_t {
+ BENCH_JSON_MEAN,
+ BENCH_JSON_MEDIAN,
+ BENCH_JSON_STDDEV,
+ BENCH_JSON_CV,
+ BENCH_JSON_AGGREGATE_COUNT
+};
+
+//utility function for `bench_json_write_aggregates`
+static double bench_json_aggregate(enum bench_json_aggregate_t aggregate, stats_summary_t const * summary) {
+ switch (aggregate) {
+  case BENCH_JSON_MEAN: return summary->mean;
+  case BENCH_JSON_MEDIAN: return summary->median;
+  case BENCH_JSON_STDDEV: return summary->stddev;
+  default: return summary->mean != 0.0 ? summary->stddev / summary->mean : 0.0;
+ }
+}
+
+//utility function for `bench_json_write`
+static void bench_json_write_aggregates(FILE * dst, bench_json_entry_t const * entry, bool * first) {
+ static char const * const names[BENCH_JSON_AGGREGATE_COUNT] = {
+  "mean",
+  "median",
+  "stddev",
+  "cv"
+ };
+ if (entry->error || entry->sample_count < 2) {
+  return;
+ }
+
+ //summaries of every user counter
+ stats_summary_t counters[BENCH_MAX_COUNTERS];
+ for (size_t c = 0; c < entry->counter_count && c < BENCH_MAX_COUNTERS; c++) {
+  if (!stats_summarize(entry->counter_samples[c], entry->sample_count, counters + c)) {
+   memset(counters + c, 0, sizeof(stats_summary_t));
+  }
+ }
+
+ for (size_t a = 0; a < BENCH_JSON_AGGREGATE_COUNT; a++) {
+  enum bench_json_aggregate_t const aggregate = (enum bench_json_aggregate_t)a;
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), "_%s", names[a]);
+
+  fputs(",\n", dst);
+  *first = false;
+  bench_json_write_run_header(dst, entry, suffix, "aggregate");
+  fprintf(dst, ",\n   \"threads\": %zu", entry->stats.threads);
+  fprintf(dst, ",\n   \"aggregate_name\": \"%s\"", names[a]);
+  fprintf(
+   dst,
+   ",\n   \"aggregate_unit\": \"%s\"",
+   aggregate == BENCH_JSON_CV ? "percentage" : "time"
+  );
+  //aggregates report the number of repetitions as their iterations
+  fprintf(dst, ",\n   \"iterations\": %zu", entry->sample_count);
+  fputs(",\n   \"real_time\": ", dst);
+  bench_json_write_number(dst, bench_json_aggregate(aggregate, &entry->stats.time));
+  fputs(",\n   \"cpu_time\": ", dst);
+  bench_json_write_number(dst, bench_json_aggregate(aggregate, &entry->stats.cpu_time));
+  fputs(",\n   \"time_unit\": \"ns\"", dst);
+  for (size_t c = 0; c < entry->counter_count && c < BENCH_MAX_COUNTERS; c++) {
+   fputs(",\n   ", dst);
+   bench_json_write_string(dst, entry->counter_names[c]);
+   fputs(": ", dst);
+   bench_json_write_number(dst, bench_json_aggregate(aggregate, counters + c));
+  }
+  fputs("\n  }", dst);
+ }
+}
+
+//`bench_json_write` implementation
+char const * bench_json_write(
+ bench_suite_t * suite,
+ FILE * dst,
+ char const * executable
+) {
+ size_t count = 0;
+ bench_t * benches = NULL;
+ char const * error = bench_suite_get_benches(suite, &count, &benches);
+ if (error) {
+  return error;
+ }
+
+ //families are numbered in registration order
+ char const ** families = calloc(count ? count : 1, sizeof(char const *));
+ size_t * instances = calloc(count ? count : 1, sizeof(size_t));
+ if (!families || !instances) {
+  error = "Failed to allocate space for benchmark families!";
+ }
+ size_t family_count = 0;
+
+ fputs("{\n", dst);
+ bench_json_write_context(dst, executable);
+ fputs(" \"benchmarks\": [\n", dst);
+
+ bool first = true;
+ for (size_t i = 0; !error && i < count; i++) {
+  bench_json_entry_t entry;
+  char const * family = NULL;
+  error = bench_get_family(benches + i, &family);
+  if (error) {
+   break;
+  }
+  size_t index = 0;
+  while (index < family_count && strcmp(families[index], family) != 0) {
+   index++;
+  }
+  if (index == family_count) {
+   families[family_count++] = family;
+  } else {
+   free((void *)family);
+  }
+
+  error = bench_json_entry_load(benches + i, &entry);
+  if (error) {
+   break;
+  }
+  entry.family_index = index;
+  entry.instance_index = instances[index]++;
+  bench_json_write_iterations(dst, &entry, &first);
+  bench_json_write_aggregates(dst, &entry, &first);
+  bench_json_entry_free(&entry);
+ }
+ fputs(first ? " ]\n}\n" : "\n ]\n}\n", dst);
+
+ for (size_t i = 0; i < family_count; i++) {
+  free((void *)families[i]);
+ }
+ free((void *)families);
+ free((void *)instances);
+ for (size_t i = 0; i < count; i++) {
+  bench_free(benches + i);
+ }
+ free((void *)benches);
+ return error;
+}
@@ -0,0 +1,466 @@
+#include <aletheia/test.h>
+#include <aletheia/bench.h>
+#include <aletheia/results.h>
+#include <aletheia/baseline.h>
+#include <aletheia/json.h>
+#include <aletheia/property.h>
+#include <aletheia/fuzz.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+//maximum number of `--bench-library` options
+#define TEST_MAIN_MAX_LIBRARIES 8
+
+//command line options for `test_suite_main`
+typedef struct {
+ //path to write the result file to, if any
+ char const * results_path;
+ test_runner_config_t runner_config;
+ //run benchmarks instead of tests
+ bool bench;
+ bench_runner_config_t bench_config;
+ //path to write Google Benchmark compatible JSON to, if any
+ char const * json_path;
+ //path to write a trace of the test run to, if any
+ char const * trace_path;
+ //path to write folded stacks of a sampling profile to, if any, and the
+ //sampling frequency
+ char const * profile_path;
+ uint64_t profile_hz;
+ //overrides for every property, where non-zero
+ uint64_t property_seed;
+ size_t property_cases;
+ //corpus root for fuzz targets, and the target to fuzz instead of running
+ //tests, if any
+ char const * fuzz_corpus;
+ char const * fuzz_target;
+ fuzz_config_t fuzz_config;
+ //result file to compare benchmarks against, if any
+ char const * baseline_path;
+ bench_baseline_config_t baseline_config;
+ //shared libraries to run per-library benchmarks against
+ size_t library_count;
+ char const * library_paths[TEST_MAIN_MAX_LIBRARIES];
+} test_main_options_t;
+
+//utility function; matches `--name=value` and `--name value` forms
+static bool test_main_match_option(
+ char const * name,
+ int argc,
+ char ** argv,
+ int * i,
+ char const ** value
+) {
+ size_t const length = strlen(name);
+ char const * arg = argv[*i];
+ if (strncmp(arg, name, length) != 0) {
+  return false;
+ }
+ if (arg[length] == '=') {
+  *value = arg + length + 1;
+  return true;
+ }
+ if (arg[length] == '\0' && *i + 1 < argc) {
+  *value = argv[++*i];
+  return true;
+ }
+ return false;
+}
+
+//utility function; parses a non-negative integer option value
+static bool test_main_parse_size(char const * value, uint64_t scale, uint64_t * dst) {
+ char * end = NULL;
+ unsigned long long const parsed = strtoull(value, &end, 10);
+ if (!*value || *end || *value == '-') {
+  printf("invalid numeric option value: '%s'\n", value);
+  return false;
+ }
+ *dst = (uint64_t)parsed * scale;
+ return true;
+}
+
+//utility function; parses a non-negative floating point option value
+static bool test_main_parse_double(char const * value, double * dst) {
+ char * end = NULL;
+ double const parsed = strtod(value, &end);
+ if (!*value || *end || parsed < 0.0) {
+  printf("invalid numeric option value: '%s'\n", value);
+  return false;
+ }
+ *dst = parsed;
+ return true;
+}
+
+//utility function for `test_suite_main`
+static bool test_main_parse_options(
+ int argc,
+ char ** argv,
+ test_main_options_t * options
+) {
+ for (int i = 1; i < argc; i++) {
+  char const * value = NULL;
+  uint64_t parsed = 0;
+  if (test_main_match_option("--results", argc, argv, &i, &options->results_path)) {
+   continue;
+  }
+  if (test_main_match_option("--trace", argc, argv, &i, &options->trace_path)) {
+   continue;
+  }
+  if (test_main_match_option("--profile", argc, argv, &i, &options->profile_path)) {
+   continue;
+  }
+  if (test_main_match_option("--profile-hz", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &options->profile_hz) || !options->profile_hz) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--slowest", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &parsed)) {
+    return false;
+   }
+   options->runner_config.slowest_count = (size_t)parsed;
+   continue;
+  }
+  if (test_main_match_option("--assertion-report", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &parsed)) {
+    return false;
+   }
+   options->runner_config.site_report_count = (size_t)parsed;
+   continue;
+  }
+  if (test_main_match_option("--property-seed", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &options->property_seed)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--property-cases", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &parsed)) {
+    return false;
+   }
+   options->property_cases = (size_t)parsed;
+   continue;
+  }
+  if (test_main_match_option("--fuzz-corpus", argc, argv, &i, &options->fuzz_corpus)) {
+   continue;
+  }
+  if (test_main_match_option("--fuzz", argc, argv, &i, &options->fuzz_target)) {
+   continue;
+  }
+  if (test_main_match_option("--fuzz-runs", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &options->fuzz_config.max_runs)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--fuzz-time-ms", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, UINT64_C(1000000), &options->fuzz_config.max_time_ns)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--fuzz-max-len", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &parsed) || !parsed) {
+    return false;
+   }
+   options->fuzz_config.max_length = (size_t)parsed;
+   continue;
+  }
+  if (test_main_match_option("--test-budget-ms", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, UINT64_C(1000000), &options->runner_config.test_budget_ns)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--suite-budget-ms", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, UINT64_C(1000000), &options->runner_config.suite_budget_ns)) {
+    return false;
+   }
+   continue;
+  }
+  if (strcmp(argv[i], "--bench") == 0) {
+   options->bench = true;
+   continue;
+  }
+  if (strcmp(argv[i], "--alloc-tracking") == 0) {
+   options->runner_config.alloc_tracking = true;
+   options->bench_config.alloc_tracking = true;
+   continue;
+  }
+  if (strcmp(argv[i], "--leak-check") == 0) {
+   options->runner_config.leak_check = true;
+   continue;
+  }
+  if (strcmp(argv[i], "--capture-output") == 0) {
+   options->runner_config.capture_output = true;
+   continue;
+  }
+  if (strcmp(argv[i], "--keep-output") == 0) {
+   options->runner_config.capture_output = true;
+   options->runner_config.keep_output = true;
+   continue;
+  }
+  if (strcmp(argv[i], "--perf-counters") == 0) {
+   options->runner_config.perf_counters = true;
+   options->bench_config.perf_counters = true;
+   continue;
+  }
+  if (test_main_match_option("--bench-min-time-ms", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, UINT64_C(1000000), &options->bench_config.min_time_ns)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--bench-warmup-ms", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, UINT64_C(1000000), &options->bench_config.warmup_time_ns)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--bench-repetitions", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &parsed) || !parsed) {
+    return false;
+   }
+   options->bench_config.repetitions = (size_t)parsed;
+   continue;
+  }
+  if (strcmp(argv[i], "--bench-stabilize") == 0) {
+   options->bench_config.stabilize = true;
+   continue;
+  }
+  if (strcmp(argv[i], "--bench-raise-priority") == 0) {
+   options->bench_config.raise_priority = true;
+   continue;
+  }
+  if (test_main_match_option("--bench-latency-batch", argc, argv, &i, &value)) {
+   if (!test_main_parse_size(value, 1, &options->bench_config.latency_batch)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--bench-json", argc, argv, &i, &options->json_path)) {
+   options->bench = true;
+   continue;
+  }
+  if (test_main_match_option("--bench-baseline", argc, argv, &i, &options->baseline_path)) {
+   options->bench = true;
+   continue;
+  }
+  if (test_main_match_option("--bench-library", argc, argv, &i, &value)) {
+   if (options->library_count == TEST_MAIN_MAX_LIBRARIES) {
+    printf("too many libraries, at most %d are supported\n", TEST_MAIN_MAX_LIBRARIES);
+    return false;
+   }
+   options->library_paths[options->library_count++] = value;
+   options->bench = true;
+   continue;
+  }
+  if (test_main_match_option("--bench-alpha", argc, argv, &i, &value)) {
+   if (!test_main_parse_double(value, &options->baseline_config.alpha)) {
+    return false;
+   }
+   continue;
+  }
+  if (test_main_match_option("--bench-threshold", argc, argv, &i, &value)) {
+   if (!test_main_parse_double(value, &options->baseline_config.threshold_percent)) {
+    return false;
+   }
+   continue;
+  }
+  printf("unknown option: '%s'\n", argv[i]);
+  printf(
+   "usage: %s [--results <path>] [--trace <path>] [--perf-counters] [--alloc-tracking] "
+   "[--leak-check] [--capture-output] [--keep-output] [--profile <path> [--profile-hz <n>]] "
+   "[--slowest <n>] [--assertion-report <n>] "
+   "[--test-budget-ms <ms>] [--suite-budget-ms <ms>] "
+   "[--property-seed <n>] [--property-cases <n>] "
+   "[--fuzz-corpus <dir>] [--fuzz <target> [--fuzz-runs <n>] [--fuzz-time-ms <ms>] "
+   "[--fuzz-max-len <n>]] "
+   "[--bench [--bench-min-time-ms <ms>] "
+   "[--bench-warmup-ms <ms>] [--bench-repetitions <n>] "
+   "[--bench-latency-batch <n>] [--bench-stabilize] [--bench-raise-priority] "
+   "[--bench-json <path>] [--bench-library <path>]... "
+   "[--bench-baseline <path> [--bench-alpha <p>] [--bench-threshold <%%>]]]\n",
+   argv[0]
+  );
+  return false;
+ }
+ return true;
+}
+
+//utility function for `test_suite_main`
+static FILE * test_main_open(char const * path, char const * mode) {
+ FILE * file = fopen(path, mode);
+ if (!file) {
+  printf("failed to open result file '%s'\n", path);
+  exit(-1);
+ }
+ return file;
+}
+
+//utility function for `test_suite_main`
+static int test_main_run_benches(
+ test_suite_t * suite,
+ test_main_options_t const * options,
+ char const * executable
+) {
+ bench_suite_t * bench_suite = test_suite_get_bench_suite(suite);
+
+ //load baseline up front so a bad path fails before measuring anything
+ bench_baseline_t baseline = NULL;
+ if (options->baseline_path) {
+  FILE * file = test_main_open(options->baseline_path, "r");
+  handle_internal_failure(bench_baseline_load(&baseline, file), __func__);
+  fclose(file);
+ }
+
+ //load libraries for per-library benchmarks, if any
+ library_t libraries[TEST_MAIN_MAX_LIBRARIES];
+ for (size_t i = 0; i < options->library_count; i++) {
+  handle_internal_failure(library_open(libraries + i, options->library_paths[i]), __func__);
+ }
+ if (options->library_count) {
+  handle_internal_failure(
+   bench_suite_add_library_comparisons(bench_suite, options->library_count, libraries),
+   __func__
+  );
+ }
+
+ size_t result = bench_suite_run_and_emit(bench_suite, options->bench_config);
+
+ //persist results, if requested
+ if (options->results_path) {
+  FILE * file = test_main_open(options->results_path, "w");
+  handle_internal_failure(test_results_write_benches(bench_suite, file), __func__);
+  fclose(file);
+ }
+ if (options->json_path) {
+  FILE * file = test_main_open(options->json_path, "w");
+  handle_internal_failure(bench_json_write(bench_suite, file, executable), __func__);
+  fclose(file);
+ }
+
+ //compare against baseline, if requested
+ if (baseline) {
+  printf("\n");
+  result += bench_baseline_compare_and_emit(
+   &baseline,
+   bench_suite,
+   options->baseline_config
+  );
+  bench_baseline_free(&baseline);
+ }
+
+ for (size_t i = 0; i < options->library_count; i++) {
+  library_free(libraries + i);
+ }
+
+ return (int)result;
+}
+
+//`test_suite_main` implementation
+int test_suite_main(test_suite_t * suite, int argc, char ** argv) {
+ test_main_options_t options = {
+  .results_path = NULL,
+  .runner_config = TEST_RUNNER_DEFAULT,
+  .bench = false,
+  .bench_config = BENCH_RUNNER_DEFAULT,
+  .json_path = NULL,
+  .trace_path = NULL,
+  .profile_path = NULL,
+  .profile_hz = 1000000 / PROFILE_DEFAULT_INTERVAL_US,
+  .property_seed = 0,
+  .property_cases = 0,
+  .fuzz_corpus = NULL,
+  .fuzz_target = NULL,
+  .fuzz_config = FUZZ_DEFAULT,
+  .baseline_path = NULL,
+  .baseline_config = BENCH_BASELINE_DEFAULT,
+  .library_count = 0
+ };
+ if (!test_main_parse_options(argc, argv, &options)) {
+  return -1;
+ }
+
+ //run benchmarks instead of tests, if requested
+ if (options.bench) {
+  return test_main_run_benches(suite, &options, argv[0]);
+ }
+
+ property_override(options.property_seed, options.property_cases);
+ fuzz_set_corpus(options.fuzz_corpus);
+
+ //fuzz a single target instead of running tests, if requested; fuzzing is
+ //neither traced nor profiled
+ if (options.fuzz_target) {
+  if (options.trace_path || options.profile_path) {
+   printf("--trace and --profile cannot be combined with --fuzz\n");
+   return -1;
+  }
+  fuzz_stats_t stats;
+  handle_internal_failure(
+   fuzz_run(options.fuzz_target, options.fuzz_config, &stats),
+   __func__
+  );
+  return stats.failed ? 1 : 0;
+ }
+
+ //record a trace of the run, if requested
+ if (options.trace_path) {
+  handle_internal_failure(
+   trace_new(&options.runner_config.trace, TRACE_DEFAULT_CAPACITY),
+   __func__
+  );
+ }
+
+
+ //sample the run, if requested
+ if (options.profile_path) {
+  handle_internal_failure(
+   profile_new(
+    &options.runner_config.profile,
+    PROFILE_DEFAULT_CAPACITY,
+    options.profile_hz >= 1000000 ? 1 : 1000000 / options.profile_hz
+   ),
+   __func__
+  );
+  handle_internal_failure(profile_start(&options.runner_config.profile), __func__);
+ }
+
+ //run tests
+ size_t const result = test_suite_run_and_emit(suite, options.runner_config);
+ if (options.trace_path) {
+  FILE * file = test_main_open(options.trace_path, "w");
+  handle_internal_failure(trace_write(&options.runner_config.trace, file), __func__);
+  fclose(file);
+  trace_free(&options.runner_config.trace);
+ }
+ if (options.profile_path) {
+  profile_stop(&options.runner_config.profile);
+  size_t dropped = 0;
+  profile_get_sample_count(&options.runner_config.profile, &dropped);
+  if (dropped) {
+   printf("profile buffer full; dropped %zu samples\n", dropped);
+  }
+  FILE * file = test_main_open(options.profile_path, "w");
+  handle_internal_failure(
+   profile_write_folded(&options.runner_config.profile, file),
+   __func__
+  );
+  fclose(file);
+  profile_free(&options.runner_config.profile);
+ }
+
+ //persist results, if requested
+ if (options.results_path) {
+  FILE * file = test_main_open(options.results_path, "w");
+  handle_internal_failure(test_results_write(suite, file), __func__);
+  fclose(file);
+ }
+
+ return (int)result;
+}
@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+
+#include <aletheia/profile.h>
+#include <aletheia/util/string.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <sys/time.h>
+
+//single sample; `ready` is set once the handler finished writing it
+typedef struct {
+ bool ready;
+ char const * tag;
+ size_t depth;
+ uintptr_t frames[PROFILE_MAX_DEPTH];
+} profile_sample_t;
+
+//`profile_t` implementation
+typedef struct {
+ size_t capacity;
+ uint64_t interval_us;
+ //samples claimed so far, possibly beyond `capacity`
+ size_t sample_count;
+ profile_sample_t * samples;
+ char const * tag;
+ //stack bounds of the profiled thread
+ uintptr_t
+  stack_low,
+  stack_high;
+ //signal disposition and timer replaced while running
+ struct sigaction previous_action;
+ bool running;
+} profile_impl_t;
+
+//utility function
+static profile_impl_t * profile_get_impl(profile_t * profile) {
+ return (profile_impl_t *)*profile;
+}
+
+//profile sampled by the signal handler, if any
+static profile_impl_t * profile_active = NULL;
+
+//`profile_new` implementation
+char const * profile_new(profile_t * dst, size_t capacity, uint64_t interval_us) {
+ *dst = NULL;
+ if (!capacity || !interval_us) {
+  return "Profiles need a non-zero capacity and sampling interval!";
+ }
+
+ profile_impl_t * result = calloc(1, sizeof(profile_impl_t));
+ if (!result) {
+  return "Failed to allocate space for profile!";
+ }
+ result->samples = calloc(capacity, sizeof(profile_sample_t));
+ if (!result->samples) {
+  free((void *)result);
+  return "Failed to allocate space for profile samples!";
+ }
+ result->capacity = capacity;
+ result->interval_us = interval_us;
+
+ *dst = (profile_t)result;
+ return NULL;
+}
+
+//`profile_free` implementation
+void profile_free(profile_t * profile) {
+ if (!profile || !*profile) {
+  return;
+ }
+
+ //zero destination
+ profile_impl_t * impl = profile_get_impl(profile);
+ *profile = NULL;
+
+ //stop sampling, then free samples and profile
+ profile_t to_stop = (profile_t)impl;
+ profile_stop(&to_stop);
+ free((void *)impl->samples);
+ free((void *)impl);
+}
+
+//utility function for `profile_handler`; walks the frame pointer chain of the
+//interrupted context, returning the number of frames recorded
+static size_t profile_unwind(
+ ucontext_t const * context,
+ profile_impl_t const * impl,
+ uintptr_t * frames
+) {
+#if defined(__x86_64__)
+ uintptr_t const
+  pc = (uintptr_t)context->uc_mcontext.gregs[REG_RIP],
+  sp = (uintptr_t)context->uc_mcontext.gregs[REG_RSP];
+ uintptr_t fp = (uintptr_t)context->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+ uintptr_t const
+  pc = (uintptr_t)context->uc_mcontext.pc,
+  sp = (uintptr_t)context->uc_mcontext.sp;
+ uintptr_t fp = (uintptr_t)context->uc_mcontext.regs[29];
+#else
+ //no known way to read the interrupted program counter
+ (void)context;
+ (void)impl;
+ (void)frames;
+ return 0;
+#endif
+
+#if defined(__x86_64__) || defined(__aarch64__)
+ size_t depth = 0;
+ frames[depth++] = pc;
+
+ //only the profiled thread's stack is known to be mapped between the stack
+ //pointer and its top; frames must move strictly towards it
+ if (sp < impl->stack_low || sp >= impl->stack_high) {
+  return depth;
+ }
+ while (
+  depth < PROFILE_MAX_DEPTH
+  && fp >= sp
+  && fp % sizeof(uintptr_t) == 0
+  && fp + 2 * sizeof(uintptr_t) <= impl->stack_high
+ ) {
+  uintptr_t const * frame = (uintptr_t const *)fp;
+  if (!frame[1]) {
+   break;
+  }
+  frames[depth++] = frame[1];
+  if (frame[0] <= fp) {
+   break;
+  }
+  fp = frame[0];
+ }
+ return depth;
+#endif
+}
+
+//`SIGPROF` handler; must stay async-signal-safe and allocation-free
+static void profile_handler(int signal, siginfo_t * info, void * context) {
+ (void)signal;
+ (void)info;
+ int const saved_errno = errno;
+ profile_impl_t * impl = __atomic_load_n(&profile_active, __ATOMIC_ACQUIRE);
+ if (impl) {
+  size_t const index = __atomic_fetch_add(&impl->sample_count, 1, __ATOMIC_RELAXED);
+  if (index < impl->capacity) {
+   profile_sample_t * sample = impl->samples + index;
+   sample->tag = __atomic_load_n(&impl->tag, __ATOMIC_RELAXED);
+   sample->depth = profile_unwind((ucontext_t const *)context, impl, sample->frames);
+   __atomic_store_n(&sample->ready, true, __ATOMIC_RELEASE);
+  }
+ }
+ errno = saved_errno;
+}
+
+//`profile_start` implementation
+char const * profile_start(profile_t * profile) {
+ profile_impl_t * impl = profile_get_impl(profile);
+ profile_impl_t * expected = NULL;
+ if (!__atomic_compare_exchange_n(
+  &profile_active,
+  &expected,
+  impl,
+  false,
+  __ATOMIC_ACQ_REL,
+  __ATOMIC_ACQUIRE
+ )) {
+  return "Another profile is already running!";
+ }
+
+ //bounds of the calling thread's stack, for unwinding
+ pthread_attr_t attr;
+ void * stack = NULL;
+ size_t stack_size = 0;
+ if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+  if (pthread_attr_getstack(&attr, &stack, &stack_size) != 0) {
+   stack = NULL;
+   stack_size = 0;
+  }
+  pthread_attr_destroy(&attr);
+ }
+ impl->stack_low = (uintptr_t)stack;
+ impl->stack_high = (uintptr_t)stack + stack_size;
+
+ //install handler, then start the timer
+ struct sigaction action;
+ memset(&action, 0, sizeof(action));
+ action.sa_sigaction = profile_handler;
+ action.sa_flags = SA_SIGINFO | SA_RESTART;
+ sigemptyset(&action.sa_mask);
+ if (sigaction(SIGPROF, &action, &impl->previous_action) != 0) {
+  __atomic_store_n(&profile_active, NULL, __ATOMIC_RELEASE);
+  return "Failed to install SIGPROF handler!";
+ }
+ struct itimerval timer = {
+  .it_interval = {
+   .tv_sec = (time_t)(impl->interval_us / 1000000),
+   .tv_usec = (suseconds_t)(impl->interval_us % 1000000)
+  }
+ };
+ timer.it_value = timer.it_interval;
+ if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+  sigaction(SIGPROF, &impl->previous_action, NULL);
+  __atomic_store_n(&profile_active, NULL, __ATOMIC_RELEASE);
+  return "Failed to start profiling timer!";
+ }
+ impl->running = true;
+ return NULL;
+}
+
+//`profile_stop` implementation
+void profile_stop(profile_t * profile) {
+ profile_impl_t * impl = profile_get_impl(profile);
+ if (!impl->running) {
+  return;
+ }
+
+ //stop the timer first, so no signal finds the previous disposition
+ struct itimerval const timer = {
+  .it_interval = {0, 0},
+  .it_value = {0, 0}
+ };
+ setitimer(ITIMER_PROF, &timer, NULL);
+ __atomic_store_n(&profile_active, NULL, __ATOMIC_RELEASE);
+ sigaction(SIGPROF, &impl->previous_action, NULL);
+ impl->running = false;
+}
+
+//`profile_set_tag` implementation
+void profile_set_tag(profile_t * profile, char const * tag) {
+ profile_impl_t * impl = profile_get_impl(profile);
+ if (!impl) {
+  return;
+ }
+ __atomic_store_n(&impl->tag, tag, __ATOMIC_RELAXED);
+}
+
+//`profile_get_sample_count` implementation
+size_t profile_get_sample_count(profile_t * profile, size_t * dropped) {
+ profile_impl_t * impl = profile_get_impl(profile);
+ size_t const count = __atomic_load_n(&impl->sample_count, __ATOMIC_ACQUIRE);
+ *dropped = count > impl->capacity ? count - impl->capacity : 0;
+ return count;
+}
+
+//utility function for `profile_write_folded`; appends the name of `address`
+static void profile_append_frame(char * line, size_t size, uintptr_t address, bool leaf) {
+ size_t const length = strlen(line);
+ //return addresses point behind the call; look up the call itself
+ uintptr_t const lookup = leaf ? address : address - 1;
+ Dl_info info;
+ memset(&info, 0, sizeof(info));
+ if (dladdr((void const *)lookup, &info) && info.dli_sname) {
+  snprintf(line + length, size - length, ";%s", info.dli_sname);
+ } else if (info.dli_fname) {
+  char const * module = strrchr(info.dli_fname, '/');
+  snprintf(
+   line + length,
+   size - length,
+   ";%s+0x%lx",
+   module ? module + 1 : info.dli_fname,
+   (unsigned long)(lookup - (uintptr_t)info.dli_fbase)
+  );
+ } else {
+  snprintf(line + length, size - length, ";0x%lx", (unsigned long)lookup);
+ }
+}
+
+static int profile_line_compare(void const * a, void const * b) {
+ return strcmp(*(char const * const *)a, *(char const * const *)b);
+}
+
+//`profile_write_folded` implementation
+char const * profile_write_folded(profile_t * profile, FILE * dst) {
+ profile_impl_t * impl = profile_get_impl(profile);
+ size_t count = __atomic_load_n(&impl->sample_count, __ATOMIC_ACQUIRE);
+ if (count > impl->capacity) {
+  count = impl->capacity;
+ }
+
+ //render every sample as a folded line, outermost frame first
+ char const ** lines = calloc(count ? count : 1, sizeof(char const *));
+ if (!lines) {
+  return "Failed to allocate space for folded stacks!";
+ }
+ size_t line_count = 0;
+ char line[4096];
+ for (size_t i = 0; i < count; i++) {
+  profile_sample_t const * sample = impl->samples + i;
+  if (!__atomic_load_n(&sample->ready, __ATOMIC_ACQUIRE) || !sample->depth) {
+   continue;
+  }
+  snprintf(line, sizeof(line), "%s", sample->tag ? sample->tag : "[untagged]");
+  for (size_t j = sample->depth; j > 0; j--) {
+   profile_append_frame(line, sizeof(line), sample->frames[j - 1], j == 1);
+  }
+  //TODO: handle `string_format` failure
+  lines[line_count++] = string_format("%s", line);
+ }
+
+ //identical stacks are adjacent once sorted
+ qsort(lines, line_count, sizeof(char const *), profile_line_compare);
+ for (size_t i = 0; i < line_count;) {
+  size_t j = i + 1;
+  while (j < line_count && strcmp(lines[i], lines[j]) == 0) {
+   j++;
+  }
+  fprintf(dst, "%s %zu\n", lines[i], j - i);
+  i = j;
+ }
+
+ for (size_t i = 0; i < line_count; i++) {
+  free((void *)lines[i]);
+ }
+ free((void *)lines);
+ if (ferror(dst)) {
+  return "Failed to write folded stacks!";
+ }
+ return NULL;
+}
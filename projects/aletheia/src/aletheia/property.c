@@ -0,0 +1,635 @@
+#include <aletheia/property.h>
+#include <aletheia/alloc.h>
+#include <aletheia/util/random.h>
+#include <aletheia/util/string.h>
+#include <aletheia/util/time.h>
+#include <aletheia/util/cpu.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include <pthread.h>
+
+//choices drawn before a generating case stops drawing random ones, so that
+//collection generators always terminate
+#define PROPERTY_MAX_CHOICES ((size_t)1 << 16)
+//maximum number of threads running cases
+#define PROPERTY_MAX_WORKERS 64
+//no failing case found
+#define PROPERTY_NO_FAILURE SIZE_MAX
+
+//overrides set by `property_override`
+static uint64_t property_seed_override = 0;
+static size_t property_cases_override = 0;
+
+//`property_override` implementation
+void property_override(uint64_t seed, size_t cases) {
+ property_seed_override = seed;
+ property_cases_override = cases;
+}
+
+//`property_t` implementation; a single case
+typedef struct {
+ //choices drawn so far
+ size_t
+  choice_count,
+  choice_capacity;
+ uint64_t * choices;
+ //choices to replay before drawing fresh ones, if generating, or zeros
+ size_t replay_count;
+ uint64_t const * replay;
+ bool generating;
+ random_t random;
+ //buffers handed out by generators, freed when the case ends
+ size_t
+  block_count,
+  block_capacity;
+ void ** blocks;
+ //generated values, only described for the reported counterexample
+ bool describe;
+ char * description;
+} property_case_impl_t;
+
+//utility function
+static property_case_impl_t * property_get_impl(property_t * property) {
+ return (property_case_impl_t *)*property;
+}
+
+//utility function; draws the next choice in `[0, max]`
+static uint64_t property_draw(property_case_impl_t * impl, uint64_t max) {
+ uint64_t value = 0;
+ if (impl->choice_count < impl->replay_count) {
+  value = impl->replay[impl->choice_count];
+ } else if (impl->generating && impl->choice_count < PROPERTY_MAX_CHOICES) {
+  //boundaries and small values find most bugs; favour them
+  uint64_t const kind = random_next(&impl->random) & 15;
+  if (kind == 0) {
+   value = max;
+  } else if (kind < 5) {
+   value = random_below(&impl->random, (max < 16 ? max : 16) + 1);
+  } else {
+   value = max == UINT64_MAX ? random_next(&impl->random) : random_below(&impl->random, max + 1);
+  }
+ }
+ if (value > max) {
+  value = max;
+ }
+
+ //record choice
+ if (impl->choice_count == impl->choice_capacity) {
+  size_t const capacity = impl->choice_capacity ? impl->choice_capacity * 2 : 64;
+  uint64_t * choices = realloc(impl->choices, capacity * sizeof(uint64_t));
+  if (!choices) {
+   handle_internal_failure("Failed to allocate space for property choices!", __func__);
+  }
+  impl->choices = choices;
+  impl->choice_capacity = capacity;
+ }
+ impl->choices[impl->choice_count++] = value;
+ return value;
+}
+
+//utility function; allocates a buffer freed when the case ends
+static void * property_alloc(property_case_impl_t * impl, size_t size) {
+ if (impl->block_count == impl->block_capacity) {
+  size_t const capacity = impl->block_capacity ? impl->block_capacity * 2 : 8;
+  void ** blocks = realloc((void *)impl->blocks, capacity * sizeof(void *));
+  if (!blocks) {
+   handle_internal_failure("Failed to allocate space for property values!", __func__);
+  }
+  impl->blocks = blocks;
+  impl->block_capacity = capacity;
+ }
+ void * block = malloc(size ? size : 1);
+ if (!block) {
+  handle_internal_failure("Failed to allocate space for property values!", __func__);
+ }
+ impl->blocks[impl->block_count++] = block;
+ return block;
+}
+
+//utility function; appends a generated value to the case description
+static void property_describe(property_case_impl_t * impl, char const * fmt, ...) {
+ if (!impl->describe) {
+  return;
+ }
+ va_list args;
+ va_start(args, fmt);
+ //TODO: handle `string_format` failures
+ char * value = vstring_format(fmt, args);
+ va_end(args);
+ char * description = impl->description
+  ? string_format("%s, %s", impl->description, value)
+  : string_format("%s", value);
+ free((void *)value);
+ free((void *)impl->description);
+ impl->description = description;
+}
+
+//utility function for collection generators; whether to generate another
+//element, averaging 7 elements
+static bool property_more(property_case_impl_t * impl, size_t length, size_t max_length) {
+ if (length >= max_length) {
+  return false;
+ }
+ return property_draw(impl, 7) != 0;
+}
+
+//`property_uint` implementation
+uint64_t property_uint(property_t * property, uint64_t max) {
+ property_case_impl_t * impl = property_get_impl(property);
+ uint64_t const value = property_draw(impl, max);
+ property_describe(impl, "%llu", (unsigned long long)value);
+ return value;
+}
+
+//utility function for `property_int` and `property_int_array`
+static int64_t property_draw_int(property_case_impl_t * impl, int64_t min, int64_t max) {
+ uint64_t const choice = property_draw(impl, (uint64_t)max - (uint64_t)min);
+ if (min > 0) {
+  return (int64_t)((uint64_t)min + choice);
+ }
+ if (max < 0) {
+  return (int64_t)((uint64_t)max - choice);
+ }
+
+ //zigzag order around zero, 0, -1, 1, -2, 2, ..., as far as both sides
+ //reach; further choices continue on the longer side
+ uint64_t const
+  negatives = (uint64_t)-(min + 1) + 1,
+  positives = (uint64_t)max,
+  both = negatives < positives ? negatives : positives;
+ if (choice <= 2 * both) {
+  uint64_t const magnitude = (choice + 1) / 2;
+  return choice & 1 ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+ }
+ return positives > negatives
+  ? (int64_t)(choice - negatives)
+  : (int64_t)(0 - (choice - positives));
+}
+
+//`property_int` implementation
+int64_t property_int(property_t * property, int64_t min, int64_t max) {
+ property_case_impl_t * impl = property_get_impl(property);
+ int64_t const value = property_draw_int(impl, min, max);
+ property_describe(impl, "%lld", (long long)value);
+ return value;
+}
+
+//`property_bool` implementation
+bool property_bool(property_t * property) {
+ property_case_impl_t * impl = property_get_impl(property);
+ bool const value = property_draw(impl, 1) != 0;
+ property_describe(impl, "%s", value ? "true" : "false");
+ return value;
+}
+
+//`property_bytes` implementation
+uint8_t const * property_bytes(property_t * property, size_t max_length, size_t * length) {
+ property_case_impl_t * impl = property_get_impl(property);
+ uint8_t * result = property_alloc(impl, max_length < 64 ? max_length : 64);
+ size_t capacity = max_length < 64 ? max_length : 64;
+ *length = 0;
+ while (property_more(impl, *length, max_length)) {
+  if (*length == capacity) {
+   //grown in place of the tracked block
+   capacity *= 2;
+   uint8_t * grown = realloc(result, capacity);
+   if (!grown) {
+    handle_internal_failure("Failed to allocate space for property values!", __func__);
+   }
+   impl->blocks[impl->block_count - 1] = grown;
+   result = grown;
+  }
+  result[(*length)++] = (uint8_t)property_draw(impl, 255);
+ }
+
+ //TODO: handle `string_format` failures
+ if (impl->describe) {
+  char * hex = calloc(*length * 3 + 1, 1);
+  for (size_t i = 0; i < *length; i++) {
+   snprintf(hex + (i ? i * 3 - 1 : 0), 4, i ? " %02x" : "%02x", result[i]);
+  }
+  property_describe(impl, "{%s}", hex);
+  free((void *)hex);
+ }
+ return result;
+}
+
+//`property_string` implementation
+char const * property_string(property_t * property, size_t max_length) {
+ property_case_impl_t * impl = property_get_impl(property);
+ size_t capacity = (max_length < 64 ? max_length : 64) + 1;
+ char * result = property_alloc(impl, capacity);
+ size_t length = 0;
+ while (property_more(impl, length, max_length)) {
+  if (length + 1 == capacity) {
+   capacity *= 2;
+   char * grown = realloc(result, capacity);
+   if (!grown) {
+    handle_internal_failure("Failed to allocate space for property values!", __func__);
+   }
+   impl->blocks[impl->block_count - 1] = grown;
+   result = grown;
+  }
+  //printable characters, shrinking towards 'a'
+  result[length++] = (char)(' ' + (property_draw(impl, 94) + 65) % 95);
+ }
+ result[length] = '\0';
+ property_describe(impl, "\"%s\"", result);
+ return result;
+}
+
+//`property_int_array` implementation
+int64_t const * property_int_array(
+ property_t * property,
+ size_t max_length,
+ int64_t min,
+ int64_t max,
+ size_t * length
+) {
+ property_case_impl_t * impl = property_get_impl(property);
+ size_t capacity = max_length < 16 ? max_length : 16;
+ int64_t * result = property_alloc(impl, capacity * sizeof(int64_t));
+ *length = 0;
+ while (property_more(impl, *length, max_length)) {
+  if (*length == capacity) {
+   capacity *= 2;
+   int64_t * grown = realloc(result, capacity * sizeof(int64_t));
+   if (!grown) {
+    handle_internal_failure("Failed to allocate space for property values!", __func__);
+   }
+   impl->blocks[impl->block_count - 1] = grown;
+   result = grown;
+  }
+  result[(*length)++] = property_draw_int(impl, min, max);
+ }
+
+ //TODO: handle `string_format` failures
+ if (impl->describe) {
+  char * values = string_format("%s", "");
+  for (size_t i = 0; i < *length; i++) {
+   char * next = string_format(i ? "%s, %lld" : "%s%lld", values, (long long)result[i]);
+   free((void *)values);
+   values = next;
+  }
+  property_describe(impl, "[%s]", values);
+  free((void *)values);
+ }
+ return result;
+}
+
+//state of a property run, shared by its workers
+typedef struct {
+ char const * name;
+ property_callback_t * callback;
+ void * ctx;
+ uint64_t seed;
+ size_t cases;
+ //next case to claim, and lowest failing case found
+ size_t next_case;
+ size_t failing_case;
+} property_run_t;
+
+//utility function; seed of case `index`; the first case uses the run's seed,
+//so reporting a case's seed reproduces it as first case of a later run
+static uint64_t property_case_seed(uint64_t seed, size_t index) {
+ return index ? random_mix(seed + (uint64_t)index * UINT64_C(0x9e3779b97f4a7c15)) : seed;
+}
+
+//utility function; frees the values of `impl` and resets it for another case
+static void property_case_reset(property_case_impl_t * impl) {
+ for (size_t i = 0; i < impl->block_count; i++) {
+  free(impl->blocks[i]);
+ }
+ impl->block_count = 0;
+ impl->choice_count = 0;
+ free((void *)impl->description);
+ impl->description = NULL;
+}
+
+static void property_case_free(property_case_impl_t * impl) {
+ property_case_reset(impl);
+ free((void *)impl->blocks);
+ free((void *)impl->choices);
+}
+
+/**
+ *utility function; runs a single case, either generating from `seed` or
+ *replaying `replay`, and returns whether it failed. If `dst` is not `NULL`,
+ *the case's test is kept there for its failures
+ */
+static bool property_run_case(
+ property_run_t * run,
+ property_case_impl_t * impl,
+ uint64_t seed,
+ uint64_t const * replay,
+ size_t replay_count,
+ test_t * dst
+) {
+ property_case_reset(impl);
+ impl->replay = replay;
+ impl->replay_count = replay_count;
+ impl->generating = !replay;
+ random_seed(&impl->random, seed);
+
+ test_t test;
+ handle_internal_failure(test_new(&test, run->name, NULL), __func__);
+ property_t property = (property_t)impl;
+ run->callback(test, property, run->ctx);
+ enum test_status_t status = TEST_NOT_RUN;
+ test_get_status(&test, &status);
+ bool const failed = status == TEST_FAIL || status == TEST_OK_OTHER_FAIL;
+ if (dst) {
+  *dst = test;
+ } else {
+  test_free(&test);
+ }
+ return failed;
+}
+
+//utility function; runs cases until all ran or one below the next failed
+static void * property_worker(void * arg) {
+ property_run_t * run = arg;
+ property_case_impl_t impl;
+ memset(&impl, 0, sizeof(impl));
+ for (;;) {
+  size_t const index = __atomic_fetch_add(&run->next_case, 1, __ATOMIC_RELAXED);
+  if (index >= run->cases || index > __atomic_load_n(&run->failing_case, __ATOMIC_RELAXED)) {
+   break;
+  }
+  if (!property_run_case(run, &impl, property_case_seed(run->seed, index), NULL, 0, NULL)) {
+   continue;
+  }
+
+  //keep the lowest failing case, so results do not depend on scheduling
+  size_t failing = __atomic_load_n(&run->failing_case, __ATOMIC_RELAXED);
+  while (index < failing && !__atomic_compare_exchange_n(
+   &run->failing_case,
+   &failing,
+   index,
+   false,
+   __ATOMIC_RELAXED,
+   __ATOMIC_RELAXED
+  )) {}
+ }
+ property_case_free(&impl);
+ return NULL;
+}
+
+//utility function; whether choices `a` are simpler than `b`: fewer, or
+//lexicographically smaller
+static bool property_simpler(
+ uint64_t const * a,
+ size_t a_count,
+ uint64_t const * b,
+ size_t b_count
+) {
+ if (a_count != b_count) {
+  return a_count < b_count;
+ }
+ for (size_t i = 0; i < a_count; i++) {
+  if (a[i] != b[i]) {
+   return a[i] < b[i];
+  }
+ }
+ return false;
+}
+
+//state of the shrinker; `choices` always reproduce the failure
+typedef struct {
+ property_run_t * run;
+ property_case_impl_t impl;
+ uint64_t * choices;
+ size_t choice_count;
+ size_t attempts;
+ size_t max_attempts;
+ size_t shrinks;
+} property_shrinker_t;
+
+//utility function for `property_shrink`; replays `candidate` and keeps the
+//choices it consumed if the case still fails with simpler ones
+static bool property_try(
+ property_shrinker_t * shrinker,
+ uint64_t const * candidate,
+ size_t candidate_count
+) {
+ shrinker->attempts++;
+ if (!property_run_case(shrinker->run, &shrinker->impl, 0, candidate, candidate_count, NULL)) {
+  return false;
+ }
+ property_case_impl_t * impl = &shrinker->impl;
+ if (!property_simpler(
+  impl->choices,
+  impl->choice_count,
+  shrinker->choices,
+  shrinker->choice_count
+ )) {
+  return false;
+ }
+ memcpy(shrinker->choices, impl->choices, impl->choice_count * sizeof(uint64_t));
+ shrinker->choice_count = impl->choice_count;
+ shrinker->shrinks++;
+ return true;
+}
+
+//utility function; shrinks `shrinker->choices` until no pass improves them
+static void property_shrink(property_shrinker_t * shrinker) {
+ //TODO: handle `malloc` failure
+ uint64_t * candidate = malloc((shrinker->choice_count + 1) * sizeof(uint64_t));
+ bool improved = true;
+ while (improved && shrinker->attempts < shrinker->max_attempts) {
+  improved = false;
+
+  //delete chunks of choices, e.g. collection elements with their flags
+  for (size_t chunk = 8; chunk > 0; chunk /= 2) {
+   size_t i = 0;
+   while (i + chunk <= shrinker->choice_count && shrinker->attempts < shrinker->max_attempts) {
+    size_t const count = shrinker->choice_count - chunk;
+    memcpy(candidate, shrinker->choices, i * sizeof(uint64_t));
+    memcpy(
+     candidate + i,
+     shrinker->choices + i + chunk,
+     (count - i) * sizeof(uint64_t)
+    );
+    if (property_try(shrinker, candidate, count)) {
+     improved = true;
+    } else {
+     i++;
+    }
+   }
+  }
+
+  //minimize each choice, zero first, then by binary search
+  for (size_t i = 0; i < shrinker->choice_count; i++) {
+   if (!shrinker->choices[i] || shrinker->attempts >= shrinker->max_attempts) {
+    continue;
+   }
+   memcpy(candidate, shrinker->choices, shrinker->choice_count * sizeof(uint64_t));
+   candidate[i] = 0;
+   if (property_try(shrinker, candidate, shrinker->choice_count)) {
+    improved = true;
+    continue;
+   }
+
+   //`low` is known to pass, the current choice to fail
+   uint64_t low = 0;
+   while (
+    i < shrinker->choice_count
+    && low + 1 < shrinker->choices[i]
+    && shrinker->attempts < shrinker->max_attempts
+   ) {
+    uint64_t const mid = low + (shrinker->choices[i] - low) / 2;
+    memcpy(candidate, shrinker->choices, shrinker->choice_count * sizeof(uint64_t));
+    candidate[i] = mid;
+    if (property_try(shrinker, candidate, shrinker->choice_count)) {
+     improved = true;
+    } else {
+     low = mid;
+    }
+   }
+  }
+ }
+ free((void *)candidate);
+}
+
+//utility function; cause reported for each failure of the counterexample
+static char * property_cause(
+ property_run_t const * run,
+ size_t failing_case,
+ size_t shrinks,
+ char const * description,
+ char const * cause
+) {
+ //TODO: handle `string_format` failure
+ return string_format(
+  "Property '%s' failed for seed %llu (case %zu of %zu, shrunk %zu times) "
+  "with counterexample (%s): %s",
+  run->name,
+  (unsigned long long)property_case_seed(run->seed, failing_case),
+  failing_case + 1,
+  run->cases,
+  shrinks,
+  description ? description : "",
+  cause
+ );
+}
+
+//`test_stmt_property__impl` implementation
+bool test_stmt_property__impl(
+ test_t * test,
+ test_site_t * site,
+ bool assertion,
+ property_config_t config,
+ property_callback_t * callback,
+ void * ctx
+) {
+ property_run_t run = {
+  .name = site->identifier_name,
+  .callback = callback,
+  .ctx = ctx,
+  .seed = property_seed_override ? property_seed_override : config.seed,
+  .cases = property_cases_override ? property_cases_override : config.cases,
+  .next_case = 0,
+  .failing_case = PROPERTY_NO_FAILURE
+ };
+ if (!run.seed) {
+  run.seed = random_mix(time_now_ns()) | 1;
+ }
+
+ //cases are not attributed to the test's own allocation counters
+ alloc_tracking_state_t tracking;
+ alloc_tracking_save(&tracking);
+
+ //run cases; the calling thread is one of the workers
+ size_t workers = config.workers ? config.workers : cpu_count();
+ if (workers > PROPERTY_MAX_WORKERS) {
+  workers = PROPERTY_MAX_WORKERS;
+ }
+ if (workers > run.cases) {
+  workers = run.cases;
+ }
+ pthread_t threads[PROPERTY_MAX_WORKERS];
+ size_t started = 0;
+ for (; started + 1 < workers; started++) {
+  if (pthread_create(threads + started, NULL, property_worker, &run) != 0) {
+   break;
+  }
+ }
+ property_worker(&run);
+ for (size_t i = 0; i < started; i++) {
+  pthread_join(threads[i], NULL);
+ }
+
+ size_t const failing_case = run.failing_case;
+ if (failing_case == PROPERTY_NO_FAILURE) {
+  alloc_tracking_restore(&tracking);
+  test_site_count(site, false);
+  return false;
+ }
+
+ //regenerate the failing case and shrink its choices
+ property_shrinker_t shrinker;
+ memset(&shrinker, 0, sizeof(shrinker));
+ shrinker.run = &run;
+ shrinker.max_attempts = config.max_shrinks;
+ property_run_case(
+  &run,
+  &shrinker.impl,
+  property_case_seed(run.seed, failing_case),
+  NULL,
+  0,
+  NULL
+ );
+ shrinker.choice_count = shrinker.impl.choice_count;
+ //TODO: handle `malloc` failure
+ shrinker.choices = malloc((shrinker.choice_count + 1) * sizeof(uint64_t));
+ memcpy(shrinker.choices, shrinker.impl.choices, shrinker.choice_count * sizeof(uint64_t));
+ property_shrink(&shrinker);
+
+ //replay the counterexample once more, describing its values
+ test_t counterexample;
+ shrinker.impl.describe = true;
+ property_run_case(
+  &run,
+  &shrinker.impl,
+  0,
+  shrinker.choices,
+  shrinker.choice_count,
+  &counterexample
+ );
+ char const * description = shrinker.impl.description;
+ alloc_tracking_restore(&tracking);
+ test_site_count(site, true);
+
+ //report every failure of the counterexample, where it happened
+ size_t failure_count = 0;
+ test_failure_t * failures = NULL;
+ handle_internal_failure(test_get_failures(&counterexample, &failure_count, &failures), __func__);
+ alloc_tracking_suspend();
+ char const * (* fail)(test_t *, char const *, int, char const *) = assertion
+  ? test_push_failure
+  : test_push_opt_failure;
+ char const * error = NULL;
+ for (size_t i = 0; i < failure_count && !error; i++) {
+  char * cause = property_cause(&run, failing_case, shrinker.shrinks, description, failures[i].cause);
+  error = fail(test, failures[i].file, failures[i].line, cause);
+  free((void *)cause);
+ }
+ //a counterexample that stopped failing when replayed still fails the test
+ if (!failure_count) {
+  char * cause = property_cause(&run, failing_case, shrinker.shrinks, description, "not reproducible");
+  error = fail(test, site->file, site->line, cause);
+  free((void *)cause);
+ }
+ test_failures_free(&failure_count, &failures);
+ test_free(&counterexample);
+ property_case_free(&shrinker.impl);
+ free((void *)shrinker.choices);
+ alloc_tracking_resume();
+ handle_internal_failure(error, __func__);
+ return true;
+}
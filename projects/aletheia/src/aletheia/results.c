@@ -0,0 +1,775 @@
+#include <aletheia/results.h>
+#include <aletheia/util/string.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+//`test_results_record_free` implementation
+void test_results_record_free(test_results_record_t * record) {
+ //zero destination
+ size_t const field_count = record->field_count;
+ char ** fields = record->fields;
+ char * text = record->text;
+ record->field_count = 0;
+ record->fields = NULL;
+ record->text_length = 0;
+ record->text = NULL;
+
+ //free fields and text
+ for (size_t i = 0; i < field_count; i++) {
+  free((void *)fields[i]);
+ }
+ free((void *)fields);
+ free((void *)text);
+}
+
+//`test_results_status_name` implementation
+char const * test_results_status_name(enum test_status_t status) {
+ switch (status) {
+  case TEST_OK: return "ok";
+  case TEST_FAIL: return "fail";
+  case TEST_OK_OTHER_FAIL: return "ok-other-fail";
+  case TEST_NOT_RUN:
+  default: return "not-run";
+ }
+}
+
+//`test_results_status_parse` implementation
+enum test_status_t test_results_status_parse(char const * name) {
+ if (strcmp(name, "ok") == 0) {
+  return TEST_OK;
+ }
+ if (strcmp(name, "fail") == 0) {
+  return TEST_FAIL;
+ }
+ if (strcmp(name, "ok-other-fail") == 0) {
+  return TEST_OK_OTHER_FAIL;
+ }
+ return TEST_NOT_RUN;
+}
+
+//`test_results_escape` implementation
+char * test_results_escape(char const * value) {
+ if (!value) {
+  value = "";
+ }
+
+ //worst case, every character is escaped
+ char * result = malloc(strlen(value) * 2 + 1);
+ if (!result) {
+  return NULL;
+ }
+ char * out = result;
+ for (; *value; value++) {
+  switch (*value) {
+   case '\\': *out++ = '\\'; *out++ = '\\'; break;
+   case '\t': *out++ = '\\'; *out++ = 't'; break;
+   case '\n': *out++ = '\\'; *out++ = 'n'; break;
+   default: *out++ = *value; break;
+  }
+ }
+ *out = '\0';
+
+ return result;
+}
+
+//utility function for `test_results_reader_next`; unescapes in place
+static void test_results_unescape(char * value) {
+ char * out = value;
+ for (; *value; value++) {
+  if (*value != '\\' || !value[1]) {
+   *out++ = *value;
+   continue;
+  }
+  value++;
+  switch (*value) {
+   case 't': *out++ = '\t'; break;
+   case 'n': *out++ = '\n'; break;
+   default: *out++ = *value; break;
+  }
+ }
+ *out = '\0';
+}
+
+//utility function; writes a `perf` child line with counters divided by `scale`
+static void test_results_write_counters(
+ FILE * dst,
+ perf_counters_t const * counters,
+ double scale
+) {
+ if (!perf_counters_any(counters)) {
+  return;
+ }
+ fputs("\tperf", dst);
+ if (counters->available[PERF_CYCLES] && counters->available[PERF_INSTRUCTIONS]) {
+  fprintf(
+   dst,
+   "\tipc=%.17g",
+   counters->values[PERF_CYCLES]
+    ? (double)counters->values[PERF_INSTRUCTIONS]
+     / (double)counters->values[PERF_CYCLES]
+    : 0.0
+  );
+ }
+ for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+  if (counters->available[i]) {
+   fprintf(
+    dst,
+    "\t%s=%.17g",
+    perf_counter_name((enum perf_counter_t)i),
+    (double)counters->values[i] / scale
+   );
+  }
+ }
+ fputc('\n', dst);
+}
+
+//utility function; writes an `alloc` child line with counts divided by `scale`
+static void test_results_write_allocs(
+ FILE * dst,
+ alloc_stats_t const * allocs,
+ double scale
+) {
+ if (!allocs->allocs && !allocs->frees) {
+  return;
+ }
+ fprintf(
+  dst,
+  "\talloc\tallocs=%.17g\tfrees=%.17g\tbytes=%.17g\tpeak-bytes=%llu\n",
+  (double)allocs->allocs / scale,
+  (double)allocs->frees / scale,
+  (double)allocs->bytes / scale,
+  (unsigned long long)allocs->peak_bytes
+ );
+}
+
+//utility function; writes a `usage` child line for `phase`, if it ran
+static void test_results_write_usage(FILE * dst, char const * phase, usage_t const * usage) {
+ if (!usage_any(usage)) {
+  return;
+ }
+ fprintf(
+  dst,
+  "\tusage\t%s\twall-ns=%llu\tuser-ns=%llu\tsys-ns=%llu\tmax-rss-kb=%llu"
+  "\tminor-faults=%llu\tmajor-faults=%llu\n",
+  phase,
+  (unsigned long long)usage->wall_ns,
+  (unsigned long long)usage->user_ns,
+  (unsigned long long)usage->sys_ns,
+  (unsigned long long)usage->max_rss_kb,
+  (unsigned long long)usage->minor_faults,
+  (unsigned long long)usage->major_faults
+ );
+}
+
+//utility type for `test_results_write`
+typedef struct {
+ char const * name;
+ test_t * test;
+} test_results_entry_t;
+
+static int test_results_entry_compare(void const * a, void const * b) {
+ return strcmp(
+  ((test_results_entry_t const *)a)->name,
+  ((test_results_entry_t const *)b)->name
+ );
+}
+
+//utility function for `test_results_write`
+static void test_results_write_test(FILE * dst, test_results_entry_t * entry) {
+ enum test_status_t status = 0;
+ size_t failure_count = 0;
+ test_failure_t * failures = NULL;
+ test_get_status(entry->test, &status);
+ handle_internal_failure(
+  test_get_failures(entry->test, &failure_count, &failures),
+  __func__
+ );
+
+ //TODO: handle `test_results_escape` failure
+ char * name = test_results_escape(entry->name);
+ fprintf(
+  dst,
+  "test\t%s\t%s\t%zu\n",
+  name,
+  test_results_status_name(status),
+  failure_count
+ );
+ free((void *)name);
+
+ for (size_t i = 0; i < failure_count; i++) {
+  char
+   * file = test_results_escape(failures[i].file),
+   * cause = test_results_escape(failures[i].cause);
+  fprintf(
+   dst,
+   "\tfailure\t%d\t%d\t%s\t%s\n",
+   failures[i].fatal ? 1 : 0,
+   failures[i].line,
+   file,
+   cause
+  );
+  free((void *)file);
+  free((void *)cause);
+ }
+ test_failures_free(&failure_count, &failures);
+
+ //raw counters for the test callback, if sampled
+ perf_counters_t counters;
+ test_get_perf_counters(entry->test, &counters);
+ test_results_write_counters(dst, &counters, 1.0);
+
+ //raw allocation counters for the test callback, if tracked
+ alloc_stats_t allocs;
+ test_get_alloc_stats(entry->test, &allocs);
+ test_results_write_allocs(dst, &allocs, 1.0);
+
+ //usage of the test callback and its hooks
+ test_usage_t usage;
+ test_get_usage(entry->test, &usage);
+ test_results_write_usage(dst, "before-each", &usage.before_each);
+ test_results_write_usage(dst, "test", &usage.test);
+ test_results_write_usage(dst, "after-each", &usage.after_each);
+
+ //captured output, if kept
+ char const * output = NULL;
+ test_get_output(entry->test, &output);
+ if (output) {
+  //TODO: handle `test_results_escape` failure
+  char * escaped = test_results_escape(output);
+  fprintf(dst, "\toutput\t%s\n", escaped);
+  free((void *)escaped);
+ }
+}
+
+//`test_results_write` implementation
+char const * test_results_write(test_suite_t * suite, FILE * dst) {
+ size_t count = 0;
+ test_t * tests = NULL;
+ char const * error = test_suite_get_tests(suite, &count, &tests);
+ if (error) {
+  return error;
+ }
+
+ //sort tests by name so result files can be merged in a single pass
+ test_results_entry_t * entries = calloc(count ? count : 1, sizeof(test_results_entry_t));
+ if (!entries) {
+  error = "Failed to allocate space for result entries!";
+ }
+ for (size_t i = 0; !error && i < count; i++) {
+  entries[i].test = tests + i;
+  test_get_name(tests + i, &entries[i].name);
+ }
+ if (!error) {
+  qsort(entries, count, sizeof(test_results_entry_t), test_results_entry_compare);
+ }
+
+ //write header and records
+ if (!error) {
+  fprintf(dst, "%s\n", TEST_RESULTS_HEADER);
+  for (size_t i = 0; i < count; i++) {
+   test_results_write_test(dst, entries + i);
+  }
+  if (ferror(dst)) {
+   error = "Failed to write result file!";
+  }
+ }
+
+ //clean up
+ for (size_t i = 0; entries && i < count; i++) {
+  free((void *)entries[i].name);
+ }
+ free((void *)entries);
+ for (size_t i = 0; i < count; i++) {
+  test_free(tests + i);
+ }
+ free((void *)tests);
+
+ return error;
+}
+
+//utility function; writes a `latency` child line with percentiles and maximum
+static void test_results_write_latency(FILE * dst, histogram_t const * latency) {
+ if (!latency || !latency->count) {
+  return;
+ }
+ fprintf(dst, "\tlatency\tcount=%llu", (unsigned long long)latency->count);
+ for (size_t i = 0; i < HISTOGRAM_REPORT_PERCENTILE_COUNT; i++) {
+  fprintf(
+   dst,
+   "\tp%g=%llu",
+   histogram_report_percentiles[i],
+   (unsigned long long)histogram_percentile(latency, histogram_report_percentiles[i])
+  );
+ }
+ fprintf(dst, "\tmax=%llu\n", (unsigned long long)latency->max);
+}
+
+//utility type for `test_results_write_benches`
+typedef struct {
+ char const * name;
+ bench_t * bench;
+} test_results_bench_entry_t;
+
+static int test_results_bench_entry_compare(void const * a, void const * b) {
+ return strcmp(
+  ((test_results_bench_entry_t const *)a)->name,
+  ((test_results_bench_entry_t const *)b)->name
+ );
+}
+
+//utility function for `test_results_write_benches`
+static void test_results_write_bench(
+ FILE * dst,
+ test_results_bench_entry_t * entry
+) {
+ bench_stats_t stats;
+ size_t sample_count = 0;
+ double * samples = NULL;
+ handle_internal_failure(bench_get_stats(entry->bench, &stats), __func__);
+ handle_internal_failure(
+  bench_get_samples(entry->bench, &sample_count, &samples),
+  __func__
+ );
+
+ //TODO: handle `test_results_escape` failure
+ char * name = test_results_escape(entry->name);
+ fprintf(
+  dst,
+  "bench\t%s\t%llu\t%.17g\n",
+  name,
+  (unsigned long long)stats.iterations,
+  stats.time.median
+ );
+ free((void *)name);
+
+ //samples are written with full precision so baselines compare exactly
+ fputs("\tsamples", dst);
+ for (size_t i = 0; i < sample_count; i++) {
+  fprintf(dst, "\t%.17g", samples[i]);
+ }
+ fputc('\n', dst);
+ free((void *)samples);
+
+ //counters normalized per iteration, if sampled
+ double const iterations =
+  (double)stats.iterations * (double)(sample_count ? sample_count : 1);
+ test_results_write_counters(dst, &stats.counters, iterations);
+ test_results_write_allocs(dst, &stats.allocs, iterations);
+
+ //median user counters, if any were set
+ size_t counter_count = 0;
+ char ** counter_names = NULL;
+ handle_internal_failure(
+  bench_get_counter_names(entry->bench, &counter_count, &counter_names),
+  __func__
+ );
+ if (counter_count) {
+  fputs("\tcounters", dst);
+ }
+ for (size_t i = 0; i < counter_count; i++) {
+  size_t count = 0;
+  double * values = NULL;
+  stats_summary_t summary;
+  handle_internal_failure(
+   bench_get_counter_samples(entry->bench, i, &count, &values),
+   __func__
+  );
+  //TODO: handle `test_results_escape` failure
+  char * counter_name = test_results_escape(counter_names[i]);
+  fprintf(
+   dst,
+   "\t%s=%.17g",
+   counter_name,
+   stats_summarize(values, count, &summary) ? summary.median : 0.0
+  );
+  free((void *)counter_name);
+  free((void *)values);
+  free((void *)counter_names[i]);
+ }
+ if (counter_count) {
+  fputc('\n', dst);
+ }
+ free((void *)counter_names);
+
+ //aggregate throughput of threaded benchmarks
+ if (stats.threads > 1) {
+  fprintf(
+   dst,
+   "\tthroughput\tthreads=%zu\tops-per-second=%.17g\n",
+   stats.threads,
+   stats.throughput.median
+  );
+ }
+
+ //reasons the result may be unreliable, if flagged
+ if (stats.unstable) {
+  fputs("\tunstable", dst);
+  for (unsigned flag = 1; flag <= BENCH_UNSTABLE_THROTTLED; flag <<= 1) {
+   if (stats.unstable & flag) {
+    fprintf(dst, "\t%s", bench_unstable_name((enum bench_unstable_t)flag));
+   }
+  }
+  fputc('\n', dst);
+ }
+
+ //latency distribution, if recorded
+ histogram_t * latency = NULL;
+ handle_internal_failure(bench_get_latency(entry->bench, &latency), __func__);
+ test_results_write_latency(dst, latency);
+ free((void *)latency);
+}
+
+//`test_results_write_benches` implementation
+char const * test_results_write_benches(bench_suite_t * suite, FILE * dst) {
+ size_t count = 0;
+ bench_t * benches = NULL;
+ char const * error = bench_suite_get_benches(suite, &count, &benches);
+ if (error) {
+  return error;
+ }
+
+ //sort benchmarks by name so result files can be merged in a single pass
+ test_results_bench_entry_t * entries = calloc(
+  count ? count : 1,
+  sizeof(test_results_bench_entry_t)
+ );
+ if (!entries) {
+  error = "Failed to allocate space for result entries!";
+ }
+ for (size_t i = 0; !error && i < count; i++) {
+  entries[i].bench = benches + i;
+  bench_get_name(benches + i, &entries[i].name);
+ }
+ if (!error) {
+  qsort(
+   entries,
+   count,
+   sizeof(test_results_bench_entry_t),
+   test_results_bench_entry_compare
+  );
+ }
+
+ //write header and records
+ if (!error) {
+  fprintf(dst, "%s\n", TEST_RESULTS_HEADER);
+  for (size_t i = 0; i < count; i++) {
+   test_results_write_bench(dst, entries + i);
+  }
+  if (ferror(dst)) {
+   error = "Failed to write result file!";
+  }
+ }
+
+ //clean up
+ for (size_t i = 0; entries && i < count; i++) {
+  free((void *)entries[i].name);
+ }
+ free((void *)entries);
+ for (size_t i = 0; i < count; i++) {
+  bench_free(benches + i);
+ }
+ free((void *)benches);
+
+ return error;
+}
+
+//`test_results_record_failed` implementation
+bool test_results_record_failed(test_results_record_t const * record) {
+ char const * const prefix = "\n\tfailure\t";
+ if (record->field_count < 3) {
+  return false;
+ }
+ enum test_status_t const status = test_results_status_parse(record->fields[2]);
+ if (status != TEST_OK_OTHER_FAIL) {
+  return status != TEST_OK;
+ }
+
+ //causes are escaped, but the budget text has nothing to escape
+ for (
+  char const * line = strstr(record->text, prefix);
+  line;
+  line = strstr(line + 1, prefix)
+ ) {
+  size_t const length = strcspn(line + 1, "\n");
+  char const * const cause = strstr(line, TEST_BUDGET_CAUSE);
+  if (!cause || cause > line + 1 + length) {
+   return true;
+  }
+ }
+ return false;
+}
+
+//`test_results_record_get_samples` implementation
+char const * test_results_record_get_samples(
+ test_results_record_t const * record,
+ size_t * count,
+ double ** dst
+) {
+ char const * const prefix = "\n\tsamples";
+
+ //zero destination
+ *count = 0;
+ *dst = NULL;
+
+ //find samples line
+ char const * line = strstr(record->text, prefix);
+ if (!line) {
+  return "Result record has no samples!";
+ }
+ line += strlen(prefix);
+ size_t const length = strcspn(line, "\n");
+
+ //count and parse samples
+ size_t sample_count = 0;
+ for (size_t i = 0; i < length; i++) {
+  sample_count += line[i] == '\t';
+ }
+ double * samples = calloc(sample_count ? sample_count : 1, sizeof(double));
+ if (!samples) {
+  return "Failed to allocate space for samples!";
+ }
+ char const * cursor = line;
+ for (size_t i = 0; i < sample_count; i++) {
+  char * end = NULL;
+  samples[i] = strtod(cursor + 1, &end);
+  if (end == cursor + 1 || (*end != '\t' && *end != '\n' && *end != '\0')) {
+   free((void *)samples);
+   return "Malformed samples in result record!";
+  }
+  cursor = end;
+ }
+
+ *dst = samples;
+ *count = sample_count;
+ return NULL;
+}
+
+//`test_results_reader_t` implementation
+typedef struct {
+ FILE * file;
+ //line buffer
+ size_t
+  line_length,
+  line_size;
+ char * line;
+ //whether `line` holds an unconsumed top-level line
+ bool pending;
+} test_results_reader_impl_t;
+
+//utility function
+static test_results_reader_impl_t * test_results_reader_get_impl(
+ test_results_reader_t * reader
+) {
+ return (test_results_reader_impl_t *)*reader;
+}
+
+//utility function; reads a full line, without its newline, into `line`
+static bool test_results_reader_read_line(test_results_reader_impl_t * impl) {
+ impl->line_length = 0;
+ while (true) {
+  //grow line buffer if needed
+  if (impl->line_size - impl->line_length < 2) {
+   size_t const new_size = impl->line_size * 2;
+   char * grown = realloc(impl->line, new_size);
+   if (!grown) {
+    return false;
+   }
+   impl->line = grown;
+   impl->line_size = new_size;
+  }
+
+  char * chunk = impl->line + impl->line_length;
+  if (!fgets(chunk, (int)(impl->line_size - impl->line_length), impl->file)) {
+   return impl->line_length > 0;
+  }
+  impl->line_length += strlen(chunk);
+
+  //strip newline and stop at end of line
+  if (impl->line_length && impl->line[impl->line_length - 1] == '\n') {
+   impl->line[--impl->line_length] = '\0';
+   return true;
+  }
+ }
+}
+
+//`test_results_reader_new` implementation
+char const * test_results_reader_new(
+ test_results_reader_t * dst,
+ FILE * file
+) {
+ size_t const default_line_size = 256;
+ *dst = NULL;
+
+ test_results_reader_impl_t * impl = calloc(1, sizeof(test_results_reader_impl_t));
+ if (!impl) {
+  return "Failed to allocate space for result reader!";
+ }
+ impl->file = file;
+ impl->line_size = default_line_size;
+ impl->line = malloc(default_line_size);
+ if (!impl->line) {
+  free((void *)impl);
+  return "Failed to allocate space for result reader!";
+ }
+
+ //validate header
+ if (
+  !test_results_reader_read_line(impl)
+  || strcmp(impl->line, TEST_RESULTS_HEADER) != 0
+ ) {
+  free((void *)impl->line);
+  free((void *)impl);
+  return "Not an aletheia result file!";
+ }
+
+ *dst = (test_results_reader_t)impl;
+ return NULL;
+}
+
+//`test_results_reader_free` implementation
+void test_results_reader_free(test_results_reader_t * reader) {
+ if (!reader || !*reader) {
+  return;
+ }
+
+ //zero destination
+ test_results_reader_impl_t * impl = test_results_reader_get_impl(reader);
+ *reader = NULL;
+
+ //free reader; the file is owned by the caller
+ free((void *)impl->line);
+ free((void *)impl);
+}
+
+//utility function; appends the current line to the record text
+static bool test_results_record_append(
+ test_results_record_t * record,
+ size_t * text_size,
+ char const * line,
+ size_t length
+) {
+ if (record->text_length + length + 2 > *text_size) {
+  size_t new_size = *text_size ? *text_size : 64;
+  while (record->text_length + length + 2 > new_size) {
+   new_size *= 2;
+  }
+  char * grown = realloc(record->text, new_size);
+  if (!grown) {
+   return false;
+  }
+  record->text = grown;
+  *text_size = new_size;
+ }
+ memcpy(record->text + record->text_length, line, length);
+ record->text_length += length;
+ record->text[record->text_length++] = '\n';
+ record->text[record->text_length] = '\0';
+ return true;
+}
+
+//utility function; splits a top-level line into unescaped fields
+static bool test_results_record_split(
+ test_results_record_t * record,
+ char const * line
+) {
+ size_t field_count = 1;
+ for (char const * c = line; *c; c++) {
+  field_count += *c == '\t';
+ }
+ record->fields = calloc(field_count, sizeof(char *));
+ if (!record->fields) {
+  return false;
+ }
+
+ char const * start = line;
+ for (size_t i = 0; i < field_count; i++) {
+  size_t const length = strcspn(start, "\t");
+  char * field = malloc(length + 1);
+  if (!field) {
+   return false;
+  }
+  memcpy(field, start, length);
+  field[length] = '\0';
+  test_results_unescape(field);
+  record->fields[record->field_count++] = field;
+  start += length + 1;
+ }
+ return true;
+}
+
+//`test_results_reader_next` implementation
+char const * test_results_reader_next(
+ test_results_reader_t * reader,
+ test_results_record_t * dst,
+ bool * done
+) {
+ char const * const oom = "Failed to allocate space for result record!";
+ test_results_reader_impl_t * impl = test_results_reader_get_impl(reader);
+
+ //zero destination
+ *dst = (test_results_record_t) {
+  .field_count = 0,
+  .fields = NULL,
+  .text_length = 0,
+  .text = NULL
+ };
+ *done = false;
+
+ //find the next top-level line
+ if (!impl->pending) {
+  do {
+   if (!test_results_reader_read_line(impl)) {
+    *done = true;
+    return NULL;
+   }
+  } while (!impl->line_length);
+ }
+ impl->pending = false;
+ if (impl->line[0] == '\t') {
+  return "Malformed result file, expected a top-level record!";
+ }
+
+ //split header fields and copy header text
+ size_t text_size = 0;
+ if (
+  !test_results_record_split(dst, impl->line)
+  || !test_results_record_append(dst, &text_size, impl->line, impl->line_length)
+ ) {
+  test_results_record_free(dst);
+  return oom;
+ }
+ if (dst->field_count < 2) {
+  test_results_record_free(dst);
+  return "Malformed result file, record has no name!";
+ }
+
+ //copy child lines until the next top-level line
+ while (test_results_reader_read_line(impl)) {
+  if (!impl->line_length) {
+   continue;
+  }
+  if (impl->line[0] != '\t') {
+   impl->pending = true;
+   break;
+  }
+  if (!test_results_record_append(dst, &text_size, impl->line, impl->line_length)) {
+   test_results_record_free(dst);
+   return oom;
+  }
+ }
+
+ return NULL;
+}
+
+//`test_results_record_compare` implementation
+int test_results_record_compare(
+ test_results_record_t const * a,
+ test_results_record_t const * b
+) {
+ int const kind = strcmp(a->fields[0], b->fields[0]);
+ if (kind) {
+  return kind;
+ }
+ return strcmp(a->fields[1], b->fields[1]);
+}
@@ -1,11 +1,16 @@
 #include <aletheia/test.h>
 #include <aletheia/util/string.h>
+#include <aletheia/alloc.h>
+#include <aletheia/util/capture.h>
+#include <aletheia/util/time.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 
+#include <pthread.h>
+
 //TODO: switch all grow functions to realloc
 
 //`test_failure_free` implementation
@@ -61,6 +66,15 @@ typedef struct {
   failure_count,
   failure_size;
  test_failure_t * failures;
+ //counters sampled around the test callback, if requested
+ perf_counters_t counters;
+ alloc_stats_t allocs;
+ //usage of the test callback and its hooks
+ test_usage_t usage;
+ //captured output of the last run, if kept
+ char const * output;
+ //context passed to the callback instead of the runner's, if set
+ void * ctx;
 } test_impl_t;
 
 //utility function
@@ -107,15 +121,18 @@ static void test_free_impl(test_impl_t * test_impl) {
  char const * name = test_impl->name;
  size_t failure_count = test_impl->failure_count;
  test_failure_t * failures = test_impl->failures;
+ char const * output = test_impl->output;
  test_impl->name = NULL;
  test_impl->callback = NULL;
  test_impl->status = 0;
  test_impl->failure_count = 0;
  test_impl->failure_size = 0;
  test_impl->failures = NULL;
+ test_impl->output = NULL;
 
- //free name
+ //free name and output
  free((void *)name);
+ free((void *)output);
 
  //free failures
  test_failures_free(&failure_count, &failures);
@@ -147,12 +164,24 @@ static char const * test_copy_impl(test_impl_t * test_impl, test_impl_t * dst) {
  dst->failure_count = 0;
  dst->failure_size = 0;
  dst->failures = NULL;
+ memset(&dst->counters, 0, sizeof(perf_counters_t));
+ memset(&dst->allocs, 0, sizeof(alloc_stats_t));
+ memset(&dst->usage, 0, sizeof(test_usage_t));
+ dst->output = NULL;
+ dst->ctx = NULL;
 
  //copy all contents
  //TODO: handle string format failure
  dst->name = string_format("%s", test_impl->name);
  dst->callback = test_impl->callback;
  dst->status = test_impl->status;
+ dst->counters = test_impl->counters;
+ dst->allocs = test_impl->allocs;
+ dst->usage = test_impl->usage;
+ dst->ctx = test_impl->ctx;
+ if (test_impl->output) {
+  dst->output = string_format("%s", test_impl->output);
+ }
 
  //TODO: handle calloc failure
  //copy failures
@@ -234,6 +263,8 @@ char const * test_push_failure(
  int line,
  char const * cause
 ) {
+ //framework bookkeeping is not attributed to the code under test
+ alloc_tracking_suspend();
  test_impl_t * test_impl = test_get_impl(test);
  test_grow_failures_if_needed(test_impl);
 
@@ -255,6 +286,7 @@ char const * test_push_failure(
  //update test status
  test_impl->status = TEST_FAIL;
 
+ alloc_tracking_resume();
  return NULL;
 }
 
@@ -265,6 +297,8 @@ char const * test_push_opt_failure(
  int line,
  char const * cause
 ) {
+ //framework bookkeeping is not attributed to the code under test
+ alloc_tracking_suspend();
  test_impl_t * test_impl = test_get_impl(test);
  test_grow_failures_if_needed(test_impl);
 
@@ -288,6 +322,7 @@ char const * test_push_opt_failure(
   test_impl->status = TEST_OK_OTHER_FAIL;
  }
 
+ alloc_tracking_resume();
  return NULL;
 }
 
@@ -308,7 +343,9 @@ char const * test_get_name(test_t * test, char const ** dst) {
 
  //TODO: handle `string_format` failures
  test_impl_t * test_impl = test_get_impl(test);
+ alloc_tracking_suspend();
  *dst = string_format("%s", test_impl->name);
+ alloc_tracking_resume();
 
  return NULL;
 }
@@ -338,6 +375,7 @@ char const * test_get_failures(test_t * test, size_t * count, test_failure_t **
  }
 
  //copy failures
+ alloc_tracking_suspend();
  test_failure_t * copy = calloc(test_impl->failure_count, sizeof(test_failure_t));
  size_t copied = 0;
  for (; copied < test_impl->failure_count; copied++) {
@@ -346,6 +384,7 @@ char const * test_get_failures(test_t * test, size_t * count, test_failure_t **
    break;
   }
  }
+ alloc_tracking_resume();
  //if copying failures failed, free all failures copied thus far
  if (error) {
   test_failures_free(&copied, &copy);
@@ -359,6 +398,35 @@ char const * test_get_failures(test_t * test, size_t * count, test_failure_t **
  return NULL;
 }
 
+//`test_get_perf_counters` implementation
+char const * test_get_perf_counters(test_t * test, perf_counters_t * dst) {
+ *dst = test_get_impl(test)->counters;
+ return NULL;
+}
+
+//`test_get_alloc_stats` implementation
+char const * test_get_alloc_stats(test_t * test, alloc_stats_t * dst) {
+ *dst = test_get_impl(test)->allocs;
+ return NULL;
+}
+
+//`test_get_usage` implementation
+char const * test_get_usage(test_t * test, test_usage_t * dst) {
+ *dst = test_get_impl(test)->usage;
+ return NULL;
+}
+
+//`test_set_ctx` implementation
+void test_set_ctx(test_t * test, void * ctx) {
+ test_get_impl(test)->ctx = ctx;
+}
+
+//`test_get_output` implementation
+char const * test_get_output(test_t * test, char const ** dst) {
+ *dst = test_get_impl(test)->output;
+ return NULL;
+}
+
 //`test_runner_setup_t` implementation
 typedef struct {
  test_suite_t suite;
@@ -424,6 +492,10 @@ typedef struct {
   test_count,
   test_size;
  test_impl_t * tests;
+ //benchmarks registered alongside the tests
+ bench_suite_t benches;
+ //usage of the suite-wide hooks in the last run
+ test_suite_usage_t usage;
 } test_suite_impl_t;
 
 //utility function
@@ -445,6 +517,12 @@ char const * test_suite_new(test_suite_t * dst) {
  suite_impl->test_count = 0;
  suite_impl->test_size = default_test_size;
  suite_impl->tests = calloc(default_test_size, sizeof(test_impl_t));
+ char const * error = bench_suite_new(&suite_impl->benches);
+ if (error) {
+  free((void *)suite_impl->tests);
+  free((void *)suite_impl);
+  return error;
+ }
  *dst = (test_suite_t)suite_impl;
 
  return NULL;
@@ -470,6 +548,9 @@ void test_suite_free(test_suite_t * suite) {
  suite_impl->tests = NULL;
  free((void *)to_free);
 
+ //free benchmarks
+ bench_suite_free(&suite_impl->benches);
+
  //free suite
  free((void *)suite_impl);
 }
@@ -545,7 +626,28 @@ char const * test_suite_get_tests(
  return NULL;
 }
 
+//`test_suite_get_bench_suite` implementation
+bench_suite_t * test_suite_get_bench_suite(test_suite_t * suite) {
+ return &test_suite_get_impl(suite)->benches;
+}
+
+//`test_suite_get_usage` implementation
+char const * test_suite_get_usage(test_suite_t * suite, test_suite_usage_t * dst) {
+ *dst = test_suite_get_impl(suite)->usage;
+ return NULL;
+}
+
 //utility functions for `test_suite_run_and_emit`
+//attributes usage since `mark` to `dst` and moves `mark` to now; `mark` is
+//sampled again right before each phase, leaving the runner's own bookkeeping
+//between phases out of them
+static void test_usage_lap(usage_t * mark, usage_t * dst) {
+ usage_t now;
+ usage_sample(&now);
+ usage_delta(mark, &now, dst);
+ *mark = now;
+}
+
 //TODO: change error handling
 static bool test_suite_run_before_all(
  test_runner_config_t * runner_config,
@@ -559,7 +661,11 @@ static bool test_suite_run_before_all(
  }
 
  //run callback
+ profile_set_tag(&runner_config->profile, "before_all");
+ trace_begin(&runner_config->trace, "before_all", "hook");
  runner_config->before_all((test_runner_setup_t)runner_impl);
+ trace_end(&runner_config->trace, "before_all", "hook");
+ profile_set_tag(&runner_config->profile, NULL);
 
  //if callback succeeded, do nothing
  if (!runner_impl->error) {
@@ -603,7 +709,11 @@ static bool test_suite_run_after_all(
  }
 
  //run callback
+ profile_set_tag(&runner_config->profile, "after_all");
+ trace_begin(&runner_config->trace, "after_all", "hook");
  runner_config->after_all((test_runner_setup_t)runner_impl);
+ trace_end(&runner_config->trace, "after_all", "hook");
+ profile_set_tag(&runner_config->profile, NULL);
 
  //if callback succeeded, do nothing
  if (!runner_impl->error) {
@@ -645,7 +755,9 @@ static bool test_suite_run_before_each(
  }
 
  //run callback
+ trace_begin(&runner_config->trace, "before_each", "hook");
  runner_config->before_each((test_runner_setup_t)runner_impl);
+ trace_end(&runner_config->trace, "before_each", "hook");
 
  //if callback succeeded, do nothing
  if (!runner_impl->error) {
@@ -684,7 +796,9 @@ static bool test_suite_run_after_each(
  }
 
  //run callback
+ trace_begin(&runner_config->trace, "after_each", "hook");
  runner_config->after_each((test_runner_setup_t)runner_impl);
+ trace_end(&runner_config->trace, "after_each", "hook");
 
  //if callback succeeded, do nothing
  if (!runner_impl->error) {
@@ -712,6 +826,195 @@ static bool test_suite_run_after_each(
  return false;
 }
 
+//utility type for `test_suite_emit_slowest`
+typedef struct {
+ char const * name;
+ char const * phase;
+ uint64_t wall_ns;
+} test_slowest_entry_t;
+
+static int test_slowest_entry_compare(void const * a, void const * b) {
+ uint64_t const
+  a_ns = ((test_slowest_entry_t const *)a)->wall_ns,
+  b_ns = ((test_slowest_entry_t const *)b)->wall_ns;
+ return (a_ns < b_ns) - (a_ns > b_ns);
+}
+
+//utility function for `test_suite_run_and_emit`; lists the slowest phases
+static void test_suite_emit_slowest(
+ test_suite_impl_t * suite_impl,
+ size_t slowest_count,
+ uint64_t total_ns
+) {
+ //TODO: handle `calloc` failure
+ size_t count = 0;
+ test_slowest_entry_t * entries = calloc(
+  suite_impl->test_count * 3 + 2,
+  sizeof(test_slowest_entry_t)
+ );
+ entries[count++] = (test_slowest_entry_t) {
+  "", "before_all", suite_impl->usage.before_all.wall_ns
+ };
+ entries[count++] = (test_slowest_entry_t) {
+  "", "after_all", suite_impl->usage.after_all.wall_ns
+ };
+ for (size_t i = 0; i < suite_impl->test_count; i++) {
+  test_impl_t const * test = suite_impl->tests + i;
+  entries[count++] = (test_slowest_entry_t) {
+   test->name, "before_each", test->usage.before_each.wall_ns
+  };
+  entries[count++] = (test_slowest_entry_t) {
+   test->name, "test", test->usage.test.wall_ns
+  };
+  entries[count++] = (test_slowest_entry_t) {
+   test->name, "after_each", test->usage.after_each.wall_ns
+  };
+ }
+ qsort(entries, count, sizeof(test_slowest_entry_t), test_slowest_entry_compare);
+
+ //phases that did not run are skipped
+ printf("\nsuite took %.3f ms; slowest tests and hooks:\n", (double)total_ns / 1e6);
+ for (size_t i = 0; i < count && i < slowest_count && entries[i].wall_ns; i++) {
+  printf(
+   "%12.3f ms  %-12s %s\n",
+   (double)entries[i].wall_ns / 1e6,
+   entries[i].phase,
+   entries[i].name
+  );
+ }
+ free((void *)entries);
+}
+
+//utility function for `test_suite_run_and_emit`; checks time budgets of `test`,
+//whose own budget covers only its callback
+static void test_suite_check_budgets(
+ test_runner_config_t * runner_config,
+ test_impl_t * test,
+ uint64_t elapsed_ns
+) {
+ //TODO: handle `string_format` failures
+ if (runner_config->test_budget_ns && test->usage.test.wall_ns > runner_config->test_budget_ns) {
+  char const * cause = string_format(
+   "Test took %.3f ms, " TEST_BUDGET_CAUSE " %.3f ms!",
+   (double)test->usage.test.wall_ns / 1e6,
+   (double)runner_config->test_budget_ns / 1e6
+  );
+  test_push_opt_failure((test_t *)&test, NULL, 0, cause);
+  free((void *)cause);
+ }
+ if (runner_config->suite_budget_ns && elapsed_ns > runner_config->suite_budget_ns) {
+  char const * cause = string_format(
+   "Suite has run for %.3f ms, " TEST_BUDGET_CAUSE " %.3f ms!",
+   (double)elapsed_ns / 1e6,
+   (double)runner_config->suite_budget_ns / 1e6
+  );
+  test_push_opt_failure((test_t *)&test, NULL, 0, cause);
+  free((void *)cause);
+ }
+}
+
+//number of leaked blocks listed in a leak failure
+#define TEST_LEAKS_REPORTED 8
+
+//utility variables for `test_suite_run_and_emit`; stdio allocates the
+//buffer of `stdout` on its first write and keeps it, so leak-checked runs
+//hand it one up front instead of blaming whichever test writes first
+static pthread_once_t test_stdout_buffer_once = PTHREAD_ONCE_INIT;
+static char test_stdout_buffer[BUFSIZ];
+
+static void test_stdout_buffer_set(void) {
+ //TODO: handle `setvbuf` failure
+ fflush(stdout);
+ setvbuf(stdout, test_stdout_buffer, _IOLBF, sizeof(test_stdout_buffer));
+}
+
+//utility function for `test_suite_run_and_emit`; fails `test` if it leaked
+static bool test_suite_check_leaks(test_impl_t * test) {
+ alloc_block_t blocks[TEST_LEAKS_REPORTED];
+ bool overflowed = false;
+ size_t const count = alloc_leaks_stop(blocks, TEST_LEAKS_REPORTED, &overflowed);
+ if (!count && !overflowed) {
+  return false;
+ }
+
+ //TODO: handle `string_format` failures
+ char const * cause = string_format("Leaked %zu block(s):", count);
+ size_t const reported = count < TEST_LEAKS_REPORTED ? count : TEST_LEAKS_REPORTED;
+ for (size_t i = 0; i < reported; i++) {
+  char const * previous = cause;
+  cause = string_format(
+   "%s%s %zu bytes allocated at %p",
+   previous,
+   i ? "," : "",
+   blocks[i].size,
+   blocks[i].site
+  );
+  free((void *)previous);
+ }
+ if (count > reported || overflowed) {
+  char const * previous = cause;
+  cause = string_format(
+   "%s%s",
+   previous,
+   overflowed ? " and more; too many live blocks to track them all" : " and more"
+  );
+  free((void *)previous);
+ }
+ test_push_failure((test_t *)&test, NULL, 0, cause);
+ free((void *)cause);
+ return true;
+}
+
+//utility function for `test_suite_run_and_emit`; starts capturing the output
+//of `test`, dropping output kept from a previous run
+static void test_suite_start_capture(capture_t * capture, test_impl_t * test) {
+ free((void *)test->output);
+ test->output = NULL;
+ if (*capture) {
+  handle_internal_failure(capture_start(capture), __func__);
+ }
+}
+
+//utility function for `test_suite_run_and_emit`; stops capturing, handing the
+//output to `test` until its status is known
+static void test_suite_stop_capture(capture_t * capture, test_impl_t * test) {
+ if (!*capture) {
+  return;
+ }
+ //the buffer is not part of the test's allocations
+ char * output = NULL;
+ alloc_tracking_suspend();
+ char const * error = capture_stop(capture, &output);
+ alloc_tracking_resume();
+ handle_internal_failure(error, __func__);
+ test->output = output;
+}
+
+//utility function for `test_suite_run_and_emit`; prints the output of tests
+//that did not pass and discards that of passing tests, unless it is kept
+static void test_suite_emit_output(
+ test_runner_config_t const * runner_config,
+ test_impl_t * test
+) {
+ if (!test->output) {
+  return;
+ }
+ if (test->status != TEST_OK) {
+  size_t const length = strlen(test->output);
+  printf(
+   "output of '%s':\n%s%s",
+   test->name,
+   test->output,
+   length && test->output[length - 1] == '\n' ? "" : "\n"
+  );
+  return;
+ }
+ if (!runner_config->keep_output) {
+  free((void *)test->output);
+  test->output = NULL;
+ }
+}
+
 //TODO: do the emission part...
 //TODO: change error handling
 //`test_suite_run_and_emit` implementation
@@ -730,8 +1033,40 @@ size_t test_suite_run_and_emit(
   .error = NULL
  };
 
+ //counters are optional; hosts without perf support just report none
+ perf_group_t perf = NULL;
+ if (runner_config.perf_counters) {
+  perf_group_new(&perf);
+ }
+
+ if (runner_config.leak_check) {
+  pthread_once(&test_stdout_buffer_once, test_stdout_buffer_set);
+ }
+
+ //a single buffer is reused for the output of every test
+ capture_t capture = NULL;
+ if (runner_config.capture_output) {
+  handle_internal_failure(capture_new(&capture), __func__);
+ }
+
+ //assertion sites are reported for this run only
+ if (runner_config.site_report_count) {
+  test_sites_reset();
+ }
+
  //run suite initializer; if suite initializer fails, exit immediately
- if (!test_suite_run_before_all(&runner_config, &runner_impl)) {
+ memset(&suite_impl->usage, 0, sizeof(test_suite_usage_t));
+ //each phase covers only its own hook or callback
+ usage_t mark;
+ usage_sample(&mark);
+ uint64_t const start_ns = mark.wall_ns;
+ bool const initialized = test_suite_run_before_all(&runner_config, &runner_impl);
+ if (runner_config.before_all) {
+  test_usage_lap(&mark, &suite_impl->usage.before_all);
+ }
+ if (!initialized) {
+  capture_free(&capture);
+  perf_group_free(&perf);
   test_runner_setup_free(&runner_impl);
   return 1;
  }
@@ -743,13 +1078,50 @@ size_t test_suite_run_and_emit(
   runner_impl.test = (test_t)test;
 
   //run test initializer; if test initializer fails, make note and skip
-  if (!test_suite_run_before_each(&runner_config, &runner_impl)) {
+  memset(&test->usage, 0, sizeof(test_usage_t));
+  //samples of the test and its hooks are attributed to the test
+  profile_set_tag(&runner_config.profile, test->name);
+  if (runner_config.leak_check) {
+   alloc_leaks_start();
+  }
+  test_suite_start_capture(&capture, test);
+  if (runner_config.before_each) {
+   usage_sample(&mark);
+  }
+  bool const prepared = test_suite_run_before_each(&runner_config, &runner_impl);
+  if (runner_config.before_each) {
+   test_usage_lap(&mark, &test->usage.before_each);
+  }
+  if (!prepared) {
+   profile_set_tag(&runner_config.profile, NULL);
+   test_suite_stop_capture(&capture, test);
+   if (runner_config.leak_check) {
+    test_suite_check_leaks(test);
+   }
+   test_suite_emit_output(&runner_config, test);
    failures_encountered++;
    continue;
   }
 
-  //run test
-  test->callback((test_t)test, runner_impl.ctx);
+  //run test; its usage, budget and rank among the slowest cover the
+  //callback alone
+  if (runner_config.alloc_tracking) {
+   alloc_tracking_start();
+  }
+  if (perf) {
+   perf_group_start(&perf);
+  }
+  trace_begin(&runner_config.trace, test->name, "test");
+  usage_sample(&mark);
+  test->callback((test_t)test, test->ctx ? test->ctx : runner_impl.ctx);
+  test_usage_lap(&mark, &test->usage.test);
+  trace_end(&runner_config.trace, test->name, "test");
+  if (perf) {
+   perf_group_stop(&perf, &test->counters);
+  }
+  if (runner_config.alloc_tracking) {
+   alloc_tracking_stop(&test->allocs);
+  }
 
   //TODO: if test did not encounter any failures, call `test_ok`
 
@@ -759,19 +1131,50 @@ size_t test_suite_run_and_emit(
   }
 
   //run test destructor; if test destructor fails, make note
+  if (runner_config.after_each) {
+   usage_sample(&mark);
+  }
   if (!test_suite_run_after_each(&runner_config, &runner_impl)) {
    failures_encountered++;
   }
+  if (runner_config.after_each) {
+   test_usage_lap(&mark, &test->usage.after_each);
+  }
+  profile_set_tag(&runner_config.profile, NULL);
+  test_suite_stop_capture(&capture, test);
+
+  //blocks still live after `after_each` are leaks
+  if (runner_config.leak_check && test_suite_check_leaks(test)) {
+   failures_encountered++;
+  }
+
+  //budget overruns are reported, but do not fail the run
+  test_suite_check_budgets(&runner_config, test, time_now_ns() - start_ns);
+  test_suite_emit_output(&runner_config, test);
  }
 
  //clear last test in `runner_impl`
  runner_impl.test = NULL;
 
  //run suite destructor; if suite destructor fails, make note
+ if (runner_config.after_all) {
+  usage_sample(&mark);
+ }
  if (!test_suite_run_after_all(&runner_config, &runner_impl)) {
   failures_encountered++;
  }
+ if (runner_config.after_all) {
+  test_usage_lap(&mark, &suite_impl->usage.after_all);
+ }
+ if (runner_config.slowest_count) {
+  test_suite_emit_slowest(suite_impl, runner_config.slowest_count, time_now_ns() - start_ns);
+ }
+ if (runner_config.site_report_count) {
+  test_sites_emit_report(runner_config.site_report_count);
+ }
 
+ capture_free(&capture);
+ perf_group_free(&perf);
  test_runner_setup_free(&runner_impl);
  return failures_encountered;
 }
@@ -795,30 +1198,419 @@ typedef char const * test_fail_func_t(
  char const * cause
 );
 
+//per-thread assertion site counters; evaluations and failures of the site
+//with id `i + 1` at `counts[2 * i]`, only ever written by the thread using them
+typedef struct test_site_counters_t {
+ size_t capacity;
+ uint64_t * counts;
+ //whether a live thread owns these counters
+ bool in_use;
+ struct test_site_counters_t * next;
+} test_site_counters_t;
+
+/**
+ *registered assertion sites and the counters of every thread that evaluated
+ *any of them; counters of exited threads keep their counts and are handed to
+ *the next thread needing counters, so there are only as many as threads ever
+ *evaluated assertions at once
+ */
+static struct {
+ bool lock;
+ size_t count;
+ size_t capacity;
+ test_site_t ** sites;
+ test_site_counters_t * counters;
+} test_sites = {
+ .lock = false,
+ .count = 0,
+ .capacity = 0,
+ .sites = NULL,
+ .counters = NULL
+};
+
+static __thread test_site_counters_t * test_site_thread_counters = NULL;
+//releases the counters of exiting threads
+static pthread_key_t test_site_counters_key;
+static pthread_once_t test_site_counters_once = PTHREAD_ONCE_INIT;
+
+//utility functions for the site registry
+static void test_sites_lock(void) {
+ while (__atomic_test_and_set(&test_sites.lock, __ATOMIC_ACQUIRE)) {}
+}
+
+static void test_sites_unlock(void) {
+ __atomic_clear(&test_sites.lock, __ATOMIC_RELEASE);
+}
+
+//utility function for `test_site_count`; registers `site`, unless another
+//thread won the race, and returns its id
+static size_t test_site_register(test_site_t * site) {
+ //registry allocations are not attributed to the evaluating test
+ alloc_tracking_suspend();
+ test_sites_lock();
+ size_t id = site->id;
+ if (!id) {
+  if (test_sites.count == test_sites.capacity) {
+   size_t const capacity = test_sites.capacity ? test_sites.capacity * 2 : 64;
+   test_site_t ** sites = realloc(
+    (void *)test_sites.sites,
+    capacity * sizeof(test_site_t *)
+   );
+   if (!sites) {
+    test_sites_unlock();
+    handle_internal_failure("Failed to allocate space for assertion sites!", __func__);
+   }
+   test_sites.sites = sites;
+   test_sites.capacity = capacity;
+  }
+  test_sites.sites[test_sites.count++] = site;
+  id = test_sites.count;
+  __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+ }
+ test_sites_unlock();
+ alloc_tracking_resume();
+ return id;
+}
+
+//destructor of `test_site_counters_key`; the counts stay in the registry
+static void test_site_release_counters(void * value) {
+ test_site_counters_t * counters = value;
+ test_sites_lock();
+ counters->in_use = false;
+ test_sites_unlock();
+ test_site_thread_counters = NULL;
+}
+
+static void test_site_create_counters_key(void) {
+ if (pthread_key_create(&test_site_counters_key, test_site_release_counters) != 0) {
+  handle_internal_failure("Failed to create key for assertion counters!", __func__);
+ }
+}
+
+//utility function for `test_site_grow_counters`; claims counters released by
+//an exited thread, or registers new ones
+static test_site_counters_t * test_site_claim_counters(void) {
+ pthread_once(&test_site_counters_once, test_site_create_counters_key);
+ test_sites_lock();
+ test_site_counters_t * counters = test_sites.counters;
+ while (counters && counters->in_use) {
+  counters = counters->next;
+ }
+ if (!counters) {
+  counters = calloc(1, sizeof(test_site_counters_t));
+  if (!counters) {
+   test_sites_unlock();
+   handle_internal_failure("Failed to allocate space for assertion counters!", __func__);
+  }
+  counters->next = test_sites.counters;
+  test_sites.counters = counters;
+ }
+ counters->in_use = true;
+ test_sites_unlock();
+ if (pthread_setspecific(test_site_counters_key, counters) != 0) {
+  handle_internal_failure("Failed to register assertion counters!", __func__);
+ }
+ return counters;
+}
+
+//utility function for `test_site_count`; grows the calling thread's counters
+//to hold at least `id` sites
+static test_site_counters_t * test_site_grow_counters(size_t id) {
+ alloc_tracking_suspend();
+ test_site_counters_t * counters = test_site_thread_counters;
+ if (!counters) {
+  counters = test_site_claim_counters();
+  test_site_thread_counters = counters;
+  if (counters->capacity >= id) {
+   alloc_tracking_resume();
+   return counters;
+  }
+ }
+
+ size_t capacity = counters->capacity ? counters->capacity : 64;
+ while (capacity < id) {
+  capacity *= 2;
+ }
+ //readers hold the lock, so the counts never move under them
+ test_sites_lock();
+ uint64_t * counts = realloc(counters->counts, capacity * 2 * sizeof(uint64_t));
+ if (!counts) {
+  test_sites_unlock();
+  handle_internal_failure("Failed to allocate space for assertion counters!", __func__);
+ }
+ memset(
+  counts + 2 * counters->capacity,
+  0,
+  (capacity - counters->capacity) * 2 * sizeof(uint64_t)
+ );
+ counters->counts = counts;
+ counters->capacity = capacity;
+ test_sites_unlock();
+ alloc_tracking_resume();
+ return counters;
+}
+
+//`test_site_count` implementation
+void test_site_count(test_site_t * site, bool failed) {
+ size_t id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+ if (!id) {
+  id = test_site_register(site);
+ }
+ test_site_counters_t * counters = test_site_thread_counters;
+ if (!counters || counters->capacity < id) {
+  counters = test_site_grow_counters(id);
+ }
+
+ //single writer; atomic stores only keep concurrent reports tear-free
+ uint64_t * counts = counters->counts + 2 * (id - 1);
+ __atomic_store_n(counts, counts[0] + 1, __ATOMIC_RELAXED);
+ if (failed) {
+  __atomic_store_n(counts + 1, counts[1] + 1, __ATOMIC_RELAXED);
+ }
+}
+
+//`test_sites_get_stats` implementation
+size_t test_sites_get_stats(test_site_stats_t * dst, size_t capacity) {
+ test_sites_lock();
+ size_t const count = test_sites.count;
+ for (size_t i = 0; i < count && i < capacity; i++) {
+  dst[i] = (test_site_stats_t) {
+   .site = test_sites.sites[i],
+   .evaluations = 0,
+   .failures = 0
+  };
+  for (test_site_counters_t * counters = test_sites.counters; counters; counters = counters->next) {
+   if (i < counters->capacity) {
+    dst[i].evaluations += __atomic_load_n(counters->counts + 2 * i, __ATOMIC_RELAXED);
+    dst[i].failures += __atomic_load_n(counters->counts + 2 * i + 1, __ATOMIC_RELAXED);
+   }
+  }
+ }
+ test_sites_unlock();
+ return count;
+}
+
+//`test_sites_reset` implementation
+void test_sites_reset(void) {
+ test_sites_lock();
+ for (test_site_counters_t * counters = test_sites.counters; counters; counters = counters->next) {
+  for (size_t i = 0; i < counters->capacity * 2; i++) {
+   __atomic_store_n(counters->counts + i, 0, __ATOMIC_RELAXED);
+  }
+ }
+ test_sites_unlock();
+}
+
+static int test_site_evaluations_compare(void const * a, void const * b) {
+ uint64_t const
+  a_count = ((test_site_stats_t const *)a)->evaluations,
+  b_count = ((test_site_stats_t const *)b)->evaluations;
+ return (a_count < b_count) - (a_count > b_count);
+}
+
+static int test_site_failures_compare(void const * a, void const * b) {
+ uint64_t const
+  a_count = ((test_site_stats_t const *)a)->failures,
+  b_count = ((test_site_stats_t const *)b)->failures;
+ return (a_count < b_count) - (a_count > b_count);
+}
+
+//utility function for `test_sites_emit_report`
+static void test_sites_emit_list(
+ char const * title,
+ test_site_stats_t const * stats,
+ size_t stats_count,
+ size_t count,
+ bool failing
+) {
+ printf("\n%s:\n", title);
+ for (size_t i = 0; i < stats_count && i < count; i++) {
+  //sites that never ran, or never failed, are skipped
+  if (!(failing ? stats[i].failures : stats[i].evaluations)) {
+   break;
+  }
+  printf(
+   "%12llu evals %10llu fails  %s:%d  %s\n",
+   (unsigned long long)stats[i].evaluations,
+   (unsigned long long)stats[i].failures,
+   stats[i].site->file,
+   stats[i].site->line,
+   stats[i].site->identifier_name
+  );
+ }
+}
+
+//`test_sites_emit_report` implementation
+void test_sites_emit_report(size_t count) {
+ //TODO: handle `calloc` failure
+ size_t const site_count = test_sites_get_stats(NULL, 0);
+ test_site_stats_t * stats = calloc(site_count ? site_count : 1, sizeof(test_site_stats_t));
+ size_t const stats_count = test_sites_get_stats(stats, site_count);
+ size_t const copied = stats_count < site_count ? stats_count : site_count;
+
+ qsort(stats, copied, sizeof(test_site_stats_t), test_site_evaluations_compare);
+ test_sites_emit_list("hottest assertion sites", stats, copied, count, false);
+ qsort(stats, copied, sizeof(test_site_stats_t), test_site_failures_compare);
+ test_sites_emit_list("most failing assertion sites", stats, copied, count, true);
+ free((void *)stats);
+}
+
 //`test_stmt_bool_eq__impl` implementation
 bool test_stmt_bool_eq__impl(
- test_stmt_t details,
+ test_t * test,
+ test_site_t * site,
  bool assertion,
  bool expected,
  bool value
 ) {
+ test_site_count(site, value != expected);
  if (value == expected) {
   return false;
  }
+ alloc_tracking_suspend();
  char const * cause = string_format(
   "Expected value of '%s' (%s) to be %s!",
-  details.identifier_name,
+  site->identifier_name,
   value ? "true" : "false",
   expected ? "true" : "false"
  );
  test_fail_func_t * fail = assertion ? test_push_failure : test_push_opt_failure;
  char const * error = fail(
-  details.test,
-  details.file,
-  details.line,
+  test,
+  site->file,
+  site->line,
+  cause
+ );
+ free((void *)cause);
+ alloc_tracking_resume();
+ handle_internal_failure(error, __func__);
+ return true;
+}
+
+//runner configuration for `test_stmt_budget__impl`; short, since budgets are
+//checked on every test run
+#define TEST_BUDGET_RUNNER (bench_runner_config_t) {\
+ .before_each = NULL,\
+ .after_each = NULL,\
+ .min_time_ns = UINT64_C(1000000),\
+ .warmup_time_ns = UINT64_C(1000000),\
+ .repetitions = 5,\
+ .perf_counters = false,\
+ .alloc_tracking = false,\
+ .latency_batch = 0,\
+ .stabilize = false,\
+ .raise_priority = false\
+}
+
+//utility function for `test_stmt_budget__impl`; returns the failure cause, if any
+static char const * test_measure_budget(
+ test_site_t const * site,
+ enum test_budget_t budget,
+ double limit,
+ bench_callback_t * callback,
+ void * ctx
+) {
+ bench_t bench = NULL;
+ char const * error = bench_new(&bench, site->identifier_name, callback);
+ if (error) {
+  return string_format("Failed to measure '%s': %s", site->identifier_name, error);
+ }
+ bench_set_ctx(&bench, ctx);
+
+ //measure
+ bench_runner_config_t config = TEST_BUDGET_RUNNER;
+ config.alloc_tracking = budget != TEST_BUDGET_TIME;
+ bench_stats_t stats;
+ error = bench_run(&bench, config);
+ if (!error) {
+  error = bench_get_stats(&bench, &stats);
+ }
+ //TODO: handle `string_format` failures
+ char const * cause = NULL;
+ if (error) {
+  cause = string_format("Failed to measure '%s': %s", site->identifier_name, error);
+  bench_free(&bench);
+  return cause;
+ }
+ bench_free(&bench);
+
+ //compare against budget
+ double const iterations = (double)stats.iterations * (double)stats.time.count;
+ switch (budget) {
+  case TEST_BUDGET_TIME: {
+   if (stats.time.median > limit) {
+    cause = string_format(
+     "Expected median time of '%s' (%.2f ns/iter) to be below %.2f ns/iter!",
+     site->identifier_name,
+     stats.time.median,
+     limit
+    );
+   }
+   break;
+  }
+  case TEST_BUDGET_ALLOCS:
+  case TEST_BUDGET_BYTES: {
+   if (!alloc_tracking_available()) {
+    cause = string_format(
+     "Cannot count allocations of '%s': no allocation interposer linked!",
+     site->identifier_name
+    );
+    break;
+   }
+   bool const allocs = budget == TEST_BUDGET_ALLOCS;
+   double const measured = (double)(allocs ? stats.allocs.allocs : stats.allocs.bytes)
+    / iterations;
+   if (measured > limit) {
+    cause = string_format(
+     "Expected '%s' to %s at most %.4g %s/iter, but it %s %.4g!",
+     site->identifier_name,
+     allocs ? "allocate" : "request",
+     limit,
+     allocs ? "allocs" : "bytes",
+     allocs ? "allocated" : "requested",
+     measured
+    );
+   }
+   break;
+  }
+  default: {
+   cause = string_format("Unknown budget for '%s'!", site->identifier_name);
+   break;
+  }
+ }
+ return cause;
+}
+
+//`test_stmt_budget__impl` implementation
+bool test_stmt_budget__impl(
+ test_t * test,
+ test_site_t * site,
+ bool assertion,
+ enum test_budget_t budget,
+ double limit,
+ bench_callback_t * callback,
+ void * ctx
+) {
+ //measurements are not attributed to the test's own allocation counters
+ alloc_tracking_state_t tracking;
+ alloc_tracking_save(&tracking);
+ char const * cause = test_measure_budget(site, budget, limit, callback, ctx);
+ alloc_tracking_restore(&tracking);
+ test_site_count(site, cause != NULL);
+ if (!cause) {
+  return false;
+ }
+
+ alloc_tracking_suspend();
+ test_fail_func_t * fail = assertion ? test_push_failure : test_push_opt_failure;
+ char const * error = fail(
+  test,
+  site->file,
+  site->line,
   cause
  );
  free((void *)cause);
+ alloc_tracking_resume();
  handle_internal_failure(error, __func__);
  return true;
 }
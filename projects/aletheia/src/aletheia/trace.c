@@ -0,0 +1,211 @@
+#include <aletheia/trace.h>
+#include <aletheia/json.h>
+#include <aletheia/alloc.h>
+#include <aletheia/util/time.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+//single recorded event
+typedef struct {
+ uint64_t ts_ns;
+ char const * name;
+ char const * category;
+ char phase;
+} trace_event_t;
+
+//ring buffer owned by a single recording thread
+typedef struct {
+ //events recorded so far; only the owning thread advances it
+ uint64_t head;
+ trace_event_t * events;
+} trace_buffer_t;
+
+//`trace_t` implementation
+typedef struct {
+ //unique per trace, so stale thread-local buffers are never reused
+ uint64_t id;
+ //events per buffer, a power of two
+ size_t capacity;
+ uint64_t start_ns;
+ //buffers claimed so far, possibly beyond `TRACE_MAX_THREADS`
+ size_t thread_count;
+ trace_buffer_t buffers[TRACE_MAX_THREADS];
+} trace_impl_t;
+
+//utility function
+static trace_impl_t * trace_get_impl(trace_t * trace) {
+ return (trace_impl_t *)*trace;
+}
+
+//source of trace ids
+static uint64_t trace_next_id = 1;
+
+//buffer claimed by the calling thread for the trace with id `id`
+static __thread struct {
+ uint64_t id;
+ trace_buffer_t * buffer;
+} trace_local;
+
+//`trace_new` implementation
+char const * trace_new(trace_t * dst, size_t capacity) {
+ *dst = NULL;
+
+ trace_impl_t * result = calloc(1, sizeof(trace_impl_t));
+ if (!result) {
+  return "Failed to allocate space for trace!";
+ }
+
+ //round capacity up to a power of two, so ring indices are a mask away
+ result->capacity = 1;
+ while (result->capacity < capacity) {
+  result->capacity <<= 1;
+ }
+ result->id = __atomic_fetch_add(&trace_next_id, 1, __ATOMIC_RELAXED);
+ result->start_ns = time_now_ns();
+ result->thread_count = 0;
+
+ *dst = (trace_t)result;
+ return NULL;
+}
+
+//`trace_free` implementation
+void trace_free(trace_t * trace) {
+ if (!trace || !*trace) {
+  return;
+ }
+
+ //zero destination
+ trace_impl_t * impl = trace_get_impl(trace);
+ *trace = NULL;
+
+ //free buffers and trace
+ for (size_t i = 0; i < TRACE_MAX_THREADS; i++) {
+  free((void *)impl->buffers[i].events);
+ }
+ free((void *)impl);
+}
+
+//utility function for `trace_record`; claims a buffer for the calling thread
+static void trace_claim(trace_impl_t * impl) {
+ trace_local.id = impl->id;
+ trace_local.buffer = NULL;
+
+ size_t const index = __atomic_fetch_add(&impl->thread_count, 1, __ATOMIC_ACQ_REL);
+ if (index >= TRACE_MAX_THREADS) {
+  return;
+ }
+
+ //the trace's own storage is not attributed to the code under test
+ alloc_tracking_suspend();
+ trace_buffer_t * buffer = impl->buffers + index;
+ buffer->events = calloc(impl->capacity, sizeof(trace_event_t));
+ alloc_tracking_resume();
+ if (buffer->events) {
+  trace_local.buffer = buffer;
+ }
+}
+
+//utility function for `trace_begin` and `trace_end`
+static void trace_record(
+ trace_t * trace,
+ char const * name,
+ char const * category,
+ char phase
+) {
+ trace_impl_t * impl = trace_get_impl(trace);
+ if (!impl) {
+  return;
+ }
+ if (trace_local.id != impl->id) {
+  trace_claim(impl);
+ }
+ trace_buffer_t * buffer = trace_local.buffer;
+ if (!buffer) {
+  return;
+ }
+
+ //overwrite the oldest event once full
+ uint64_t const head = buffer->head;
+ trace_event_t * event = buffer->events + (head & (impl->capacity - 1));
+ event->ts_ns = time_now_ns();
+ event->name = name;
+ event->category = category;
+ event->phase = phase;
+ __atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+//`trace_begin` implementation
+void trace_begin(trace_t * trace, char const * name, char const * category) {
+ trace_record(trace, name, category, 'B');
+}
+
+//`trace_end` implementation
+void trace_end(trace_t * trace, char const * name, char const * category) {
+ trace_record(trace, name, category, 'E');
+}
+
+//utility function for `trace_write`
+static void trace_write_event(
+ FILE * dst,
+ trace_impl_t const * impl,
+ trace_event_t const * event,
+ size_t tid,
+ bool * first
+) {
+ fputs(*first ? "\n " : ",\n ", dst);
+ *first = false;
+ fputs("{\"name\": ", dst);
+ bench_json_write_string(dst, event->name);
+ fputs(", \"cat\": ", dst);
+ bench_json_write_string(dst, event->category);
+ uint64_t const ts_ns = event->ts_ns > impl->start_ns ? event->ts_ns - impl->start_ns : 0;
+ fprintf(
+  dst,
+  ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %zu}",
+  event->phase,
+  (double)ts_ns / 1000.0,
+  tid
+ );
+}
+
+//`trace_write` implementation
+char const * trace_write(trace_t * trace, FILE * dst) {
+ trace_impl_t * impl = trace_get_impl(trace);
+ size_t thread_count = __atomic_load_n(&impl->thread_count, __ATOMIC_ACQUIRE);
+ if (thread_count > TRACE_MAX_THREADS) {
+  thread_count = TRACE_MAX_THREADS;
+ }
+
+ bool first = true;
+ fputs("{\"traceEvents\": [", dst);
+ for (size_t i = 0; i < thread_count; i++) {
+  trace_buffer_t const * buffer = impl->buffers + i;
+  if (!buffer->events) {
+   continue;
+  }
+
+  //only the newest `capacity` events survive; ends of slices whose begin
+  //was overwritten are dropped
+  uint64_t const head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+  uint64_t const oldest = head > impl->capacity ? head - impl->capacity : 0;
+  size_t depth = 0;
+  for (uint64_t j = oldest; j < head; j++) {
+   trace_event_t const * event = buffer->events + (j & (impl->capacity - 1));
+   if (event->phase == 'B') {
+    depth++;
+   } else if (depth) {
+    depth--;
+   } else {
+    continue;
+   }
+   trace_write_event(dst, impl, event, i + 1, &first);
+  }
+ }
+ fputs("\n], \"displayTimeUnit\": \"ns\"}\n", dst);
+
+ if (ferror(dst)) {
+  return "Failed to write trace!";
+ }
+ return NULL;
+}
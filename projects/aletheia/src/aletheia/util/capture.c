@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+
+#include <aletheia/util/capture.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+//`capture_t` implementation
+typedef struct {
+ //in-memory file receiving the output
+ int fd;
+ //original `stdout` and `stderr` while capturing
+ int saved_stdout;
+ int saved_stderr;
+ bool capturing;
+} capture_impl_t;
+
+//utility function
+static capture_impl_t * capture_get_impl(capture_t * capture) {
+ return (capture_impl_t *)*capture;
+}
+
+//utility function for `capture_new`; `tmpfile` stands in where `memfd_create`
+//is not supported
+static int capture_open_file(void) {
+ int fd = memfd_create("aletheia-capture", MFD_CLOEXEC);
+ if (fd >= 0 || errno != ENOSYS) {
+  return fd;
+ }
+ FILE * file = tmpfile();
+ if (!file) {
+  return -1;
+ }
+ fd = fcntl(fileno(file), F_DUPFD_CLOEXEC, 0);
+ fclose(file);
+ return fd;
+}
+
+//`capture_new` implementation
+char const * capture_new(capture_t * dst) {
+ *dst = NULL;
+ capture_impl_t * result = calloc(1, sizeof(capture_impl_t));
+ if (!result) {
+  return "Failed to allocate space for output capture!";
+ }
+ result->fd = capture_open_file();
+ if (result->fd < 0) {
+  free((void *)result);
+  return "Failed to create in-memory file for output capture!";
+ }
+ result->saved_stdout = -1;
+ result->saved_stderr = -1;
+ *dst = (capture_t)result;
+ return NULL;
+}
+
+//`capture_free` implementation
+void capture_free(capture_t * capture) {
+ if (!capture || !*capture) {
+  return;
+ }
+ capture_impl_t * impl = capture_get_impl(capture);
+ if (impl->capturing) {
+  capture_stop(capture, NULL);
+ }
+ *capture = NULL;
+ close(impl->fd);
+ free((void *)impl);
+}
+
+//`capture_start` implementation
+char const * capture_start(capture_t * capture) {
+ capture_impl_t * impl = capture_get_impl(capture);
+ if (impl->capturing) {
+  return "Output is already being captured!";
+ }
+
+ //drop previous output, then swap the descriptors
+ if (ftruncate(impl->fd, 0) != 0 || lseek(impl->fd, 0, SEEK_SET) != 0) {
+  return "Failed to reset output capture!";
+ }
+ fflush(stdout);
+ fflush(stderr);
+ impl->saved_stdout = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+ impl->saved_stderr = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 0);
+ if (impl->saved_stdout < 0 || impl->saved_stderr < 0) {
+  close(impl->saved_stdout);
+  close(impl->saved_stderr);
+  return "Failed to save stdout and stderr for output capture!";
+ }
+ if (
+  dup2(impl->fd, STDOUT_FILENO) < 0
+  || dup2(impl->fd, STDERR_FILENO) < 0
+ ) {
+  dup2(impl->saved_stdout, STDOUT_FILENO);
+  dup2(impl->saved_stderr, STDERR_FILENO);
+  close(impl->saved_stdout);
+  close(impl->saved_stderr);
+  return "Failed to redirect stdout and stderr for output capture!";
+ }
+ impl->capturing = true;
+ return NULL;
+}
+
+//`capture_stop` implementation
+char const * capture_stop(capture_t * capture, char ** dst) {
+ capture_impl_t * impl = capture_get_impl(capture);
+ if (dst) {
+  *dst = NULL;
+ }
+ if (!impl->capturing) {
+  return "Output is not being captured!";
+ }
+
+ //restore descriptors
+ fflush(stdout);
+ fflush(stderr);
+ dup2(impl->saved_stdout, STDOUT_FILENO);
+ dup2(impl->saved_stderr, STDERR_FILENO);
+ close(impl->saved_stdout);
+ close(impl->saved_stderr);
+ impl->saved_stdout = -1;
+ impl->saved_stderr = -1;
+ impl->capturing = false;
+ if (!dst) {
+  return NULL;
+ }
+
+ //read back captured output
+ off_t const length = lseek(impl->fd, 0, SEEK_END);
+ if (length < 0) {
+  return "Failed to read captured output!";
+ }
+ if (!length) {
+  return NULL;
+ }
+ char * output = malloc((size_t)length + 1);
+ if (!output) {
+  return "Failed to allocate space for captured output!";
+ }
+ size_t read_length = 0;
+ while (read_length < (size_t)length) {
+  ssize_t const result = pread(
+   impl->fd,
+   output + read_length,
+   (size_t)length - read_length,
+   (off_t)read_length
+  );
+  if (result <= 0) {
+   if (result < 0 && errno == EINTR) {
+    continue;
+   }
+   free((void *)output);
+   return "Failed to read captured output!";
+  }
+  read_length += (size_t)result;
+ }
+ output[length] = '\0';
+ *dst = output;
+ return NULL;
+}
@@ -0,0 +1,310 @@
+#define _GNU_SOURCE
+
+#include <aletheia/util/cpu.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+ #include <sched.h>
+ #include <errno.h>
+ #include <sys/resource.h>
+#endif
+
+//`cpu_env_t` implementation
+typedef struct {
+ int cpu;
+#ifdef __linux__
+ //state to restore on free
+ cpu_set_t affinity;
+ bool affinity_changed;
+ int priority;
+ bool priority_changed;
+#endif
+} cpu_env_impl_t;
+
+//utility function
+static cpu_env_impl_t * cpu_env_get_impl(cpu_env_t * env) {
+ return (cpu_env_impl_t *)*env;
+}
+
+//`cpu_env_new` implementation
+char const * cpu_env_new(cpu_env_t * dst) {
+ *dst = NULL;
+
+ cpu_env_impl_t * env_impl = calloc(1, sizeof(cpu_env_impl_t));
+ if (!env_impl) {
+  return "Failed to allocate space for cpu environment!";
+ }
+ env_impl->cpu = -1;
+
+#ifdef __linux__
+ if (sched_getaffinity(0, sizeof(cpu_set_t), &env_impl->affinity) != 0) {
+  free((void *)env_impl);
+  return "Failed to read cpu affinity!";
+ }
+ env_impl->affinity_changed = false;
+
+ //`getpriority` may legitimately return -1
+ errno = 0;
+ env_impl->priority = getpriority(PRIO_PROCESS, 0);
+ if (errno) {
+  free((void *)env_impl);
+  return "Failed to read scheduling priority!";
+ }
+ env_impl->priority_changed = false;
+#endif
+
+ *dst = (cpu_env_t)env_impl;
+ return NULL;
+}
+
+//`cpu_env_free` implementation
+void cpu_env_free(cpu_env_t * env) {
+ if (!env || !*env) {
+  return;
+ }
+ cpu_env_impl_t * env_impl = cpu_env_get_impl(env);
+ *env = NULL;
+
+#ifdef __linux__
+ //restoring is best-effort; there is nothing left to report failures to
+ if (env_impl->affinity_changed) {
+  sched_setaffinity(0, sizeof(cpu_set_t), &env_impl->affinity);
+ }
+ if (env_impl->priority_changed) {
+  setpriority(PRIO_PROCESS, 0, env_impl->priority);
+ }
+#endif
+
+ free((void *)env_impl);
+}
+
+//`cpu_env_pin` implementation
+char const * cpu_env_pin(cpu_env_t * env) {
+ cpu_env_impl_t * env_impl = cpu_env_get_impl(env);
+#ifdef __linux__
+ int const cpu = sched_getcpu();
+ if (cpu < 0) {
+  return "Failed to determine current cpu!";
+ }
+ cpu_set_t set;
+ CPU_ZERO(&set);
+ CPU_SET(cpu, &set);
+ if (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+  return "Failed to set cpu affinity!";
+ }
+ env_impl->affinity_changed = true;
+ env_impl->cpu = cpu;
+ return NULL;
+#else
+ (void)env_impl;
+ return "Cpu pinning is not supported on this platform!";
+#endif
+}
+
+//`cpu_env_raise_priority` implementation
+char const * cpu_env_raise_priority(cpu_env_t * env) {
+ cpu_env_impl_t * env_impl = cpu_env_get_impl(env);
+#ifdef __linux__
+ //try the highest nice level first, then back off to what is permitted
+ for (int priority = -20; priority < env_impl->priority; priority++) {
+  if (setpriority(PRIO_PROCESS, 0, priority) == 0) {
+   env_impl->priority_changed = true;
+   return NULL;
+  }
+  if (errno != EACCES && errno != EPERM) {
+   break;
+  }
+ }
+ return "Insufficient permissions to raise scheduling priority!";
+#else
+ (void)env_impl;
+ return "Raising scheduling priority is not supported on this platform!";
+#endif
+}
+
+//`cpu_env_get_cpu` implementation
+int cpu_env_get_cpu(cpu_env_t * env) {
+ return cpu_env_get_impl(env)->cpu;
+}
+
+//`cpu_current` implementation
+int cpu_current(void) {
+#ifdef __linux__
+ return sched_getcpu();
+#else
+ return -1;
+#endif
+}
+
+//utility function for `cpu_frequency_sample`; reads the first line of `path`
+static bool cpu_read_sysfs(char const * path, char * dst, size_t size) {
+ FILE * file = fopen(path, "r");
+ if (!file) {
+  return false;
+ }
+ bool const result = fgets(dst, (int)size, file) != NULL;
+ fclose(file);
+ if (result) {
+  dst[strcspn(dst, "\n")] = '\0';
+ }
+ return result;
+}
+
+//utility function for `cpu_frequency_sample`; reads an integer from `path`
+static bool cpu_read_sysfs_u64(char const * path, uint64_t * dst) {
+ char buffer[32];
+ if (!cpu_read_sysfs(path, buffer, sizeof(buffer))) {
+  return false;
+ }
+ char * end = NULL;
+ unsigned long long const value = strtoull(buffer, &end, 10);
+ if (end == buffer) {
+  return false;
+ }
+ *dst = (uint64_t)value;
+ return true;
+}
+
+//`cpu_frequency_sample` implementation
+void cpu_frequency_sample(int cpu, cpu_frequency_t * dst) {
+ memset(dst, 0, sizeof(cpu_frequency_t));
+ if (cpu < 0) {
+  return;
+ }
+
+ char path[128];
+ snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+ if (!cpu_read_sysfs(path, dst->governor, sizeof(dst->governor))) {
+  dst->governor[0] = '\0';
+ }
+
+ snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+ dst->frequency_available = cpu_read_sysfs_u64(path, &dst->frequency_khz);
+
+ //core and package throttling both slow the benchmark down
+ uint64_t core = 0, package = 0;
+ snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/thermal_throttle/core_throttle_count", cpu);
+ bool const core_available = cpu_read_sysfs_u64(path, &core);
+ snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/thermal_throttle/package_throttle_count", cpu);
+ bool const package_available = cpu_read_sysfs_u64(path, &package);
+ dst->throttle_available = core_available || package_available;
+ dst->throttle_count = core + package;
+}
+
+//`cpu_count` implementation
+size_t cpu_count(void) {
+ long const count = sysconf(_SC_NPROCESSORS_ONLN);
+ return count > 0 ? (size_t)count : 0;
+}
+
+//`cpu_mhz` implementation
+double cpu_mhz(void) {
+ //prefer the maximum frequency reported by cpufreq
+ uint64_t khz = 0;
+ if (cpu_read_sysfs_u64("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", &khz) && khz) {
+  return (double)khz / 1000.0;
+ }
+
+ //otherwise fall back to the first frequency listed in `/proc/cpuinfo`
+ FILE * file = fopen("/proc/cpuinfo", "r");
+ if (!file) {
+  return 0.0;
+ }
+ char line[256];
+ double mhz = 0.0;
+ while (fgets(line, sizeof(line), file)) {
+  if (strncmp(line, "cpu MHz", 7) != 0) {
+   continue;
+  }
+  char const * value = strchr(line, ':');
+  if (value) {
+   mhz = strtod(value + 1, NULL);
+  }
+  break;
+ }
+ fclose(file);
+ return mhz;
+}
+
+//`cpu_load_average` implementation
+bool cpu_load_average(double dst[3]) {
+ char buffer[128];
+ if (!cpu_read_sysfs("/proc/loadavg", buffer, sizeof(buffer))) {
+  return false;
+ }
+ char * cursor = buffer;
+ for (size_t i = 0; i < 3; i++) {
+  char * end = NULL;
+  dst[i] = strtod(cursor, &end);
+  if (end == cursor) {
+   return false;
+  }
+  cursor = end;
+ }
+ return true;
+}
+
+//utility function for `cpu_caches`; counts CPUs in a list like `0-3,8`
+static size_t cpu_list_count(char const * list) {
+ size_t count = 0;
+ while (*list) {
+  char * end = NULL;
+  long const first = strtol(list, &end, 10);
+  if (end == list) {
+   break;
+  }
+  long last = first;
+  if (*end == '-') {
+   list = end + 1;
+   last = strtol(list, &end, 10);
+  }
+  count += last >= first ? (size_t)(last - first + 1) : 0;
+  list = *end == ',' ? end + 1 : end;
+ }
+ return count;
+}
+
+//`cpu_caches` implementation
+size_t cpu_caches(cpu_cache_t * dst, size_t size) {
+ size_t count = 0;
+ for (size_t index = 0; count < size; index++) {
+  char path[128], buffer[64];
+  cpu_cache_t * cache = dst + count;
+  memset(cache, 0, sizeof(cpu_cache_t));
+
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%zu/type", index);
+  if (!cpu_read_sysfs(path, cache->type, sizeof(cache->type))) {
+   break;
+  }
+
+  uint64_t level = 0;
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%zu/level", index);
+  cpu_read_sysfs_u64(path, &level);
+  cache->level = (int)level;
+
+  //sizes are reported with a unit suffix, e.g. `48K`
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%zu/size", index);
+  if (cpu_read_sysfs(path, buffer, sizeof(buffer))) {
+   char * end = NULL;
+   cache->size = (uint64_t)strtoull(buffer, &end, 10);
+   switch (*end) {
+    case 'K': cache->size <<= 10; break;
+    case 'M': cache->size <<= 20; break;
+    case 'G': cache->size <<= 30; break;
+    default: break;
+   }
+  }
+
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%zu/shared_cpu_list", index);
+  cache->sharing = cpu_read_sysfs(path, buffer, sizeof(buffer))
+   ? cpu_list_count(buffer)
+   : 0;
+
+  count++;
+ }
+ return count;
+}
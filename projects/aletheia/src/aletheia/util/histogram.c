@@ -0,0 +1,118 @@
+#include <aletheia/util/histogram.h>
+
+#include <string.h>
+
+double const histogram_report_percentiles[HISTOGRAM_REPORT_PERCENTILE_COUNT] = {
+ 50.0, 90.0, 99.0, 99.9, 99.99
+};
+
+//utility function; index of the most significant set bit of `value != 0`
+static unsigned histogram_msb(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+ return 63u - (unsigned)__builtin_clzll(value);
+#else
+ unsigned msb = 0;
+ while (value >>= 1) {
+  msb++;
+ }
+ return msb;
+#endif
+}
+
+//utility function; maps a value to its bucket
+static size_t histogram_bucket(uint64_t value) {
+ if (value < HISTOGRAM_SUB_BUCKET_COUNT) {
+  return (size_t)value;
+ }
+
+ //shift the value so its top `bits` bits select a sub-bucket in the upper half
+ unsigned const shift = histogram_msb(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+ uint64_t const sub_bucket = (value >> shift) - HISTOGRAM_SUB_BUCKET_COUNT / 2;
+ return HISTOGRAM_SUB_BUCKET_COUNT
+  + (size_t)(shift - 1) * (HISTOGRAM_SUB_BUCKET_COUNT / 2)
+  + (size_t)sub_bucket;
+}
+
+//utility function; largest value that maps to `bucket`
+static uint64_t histogram_bucket_max(size_t bucket) {
+ if (bucket < HISTOGRAM_SUB_BUCKET_COUNT) {
+  return (uint64_t)bucket;
+ }
+ size_t const offset = bucket - HISTOGRAM_SUB_BUCKET_COUNT;
+ unsigned const shift = (unsigned)(offset / (HISTOGRAM_SUB_BUCKET_COUNT / 2)) + 1;
+ uint64_t const sub_bucket = offset % (HISTOGRAM_SUB_BUCKET_COUNT / 2)
+  + HISTOGRAM_SUB_BUCKET_COUNT / 2;
+ return ((sub_bucket + 1) << shift) - 1;
+}
+
+//`histogram_reset` implementation
+void histogram_reset(histogram_t * histogram) {
+ memset(histogram, 0, sizeof(histogram_t));
+ histogram->min = UINT64_MAX;
+}
+
+//`histogram_record` implementation
+void histogram_record(histogram_t * histogram, uint64_t value, uint64_t count) {
+ if (!count) {
+  return;
+ }
+ histogram->buckets[histogram_bucket(value)] += count;
+ histogram->count += count;
+ histogram->sum += (double)value * (double)count;
+ if (value < histogram->min) {
+  histogram->min = value;
+ }
+ if (value > histogram->max) {
+  histogram->max = value;
+ }
+}
+
+//`histogram_merge` implementation
+void histogram_merge(histogram_t * dst, histogram_t const * src) {
+ if (!src->count) {
+  return;
+ }
+ for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+  dst->buckets[i] += src->buckets[i];
+ }
+ dst->count += src->count;
+ dst->sum += src->sum;
+ if (src->min < dst->min) {
+  dst->min = src->min;
+ }
+ if (src->max > dst->max) {
+  dst->max = src->max;
+ }
+}
+
+//`histogram_percentile` implementation
+uint64_t histogram_percentile(histogram_t const * histogram, double percentile) {
+ if (!histogram->count) {
+  return 0;
+ }
+ if (percentile >= 100.0) {
+  return histogram->max;
+ }
+
+ //rank of the requested value, rounded up and at least 1
+ double const exact = percentile / 100.0 * (double)histogram->count;
+ uint64_t rank = (uint64_t)exact;
+ if ((double)rank < exact || !rank) {
+  rank++;
+ }
+
+ uint64_t seen = 0;
+ for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+  seen += histogram->buckets[i];
+  if (seen >= rank) {
+   uint64_t const value = histogram_bucket_max(i);
+   return value < histogram->max ? value : histogram->max;
+  }
+ }
+ return histogram->max;
+}
+
+//`histogram_mean` implementation
+double histogram_mean(histogram_t const * histogram) {
+ return histogram->count ? histogram->sum / (double)histogram->count : 0.0;
+}
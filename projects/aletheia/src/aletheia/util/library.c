@@ -0,0 +1,120 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <aletheia/util/library.h>
+#include <aletheia/util/string.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <dlfcn.h>
+
+//`library_t` implementation
+typedef struct {
+ char const * path;
+ void * handle;
+} library_impl_t;
+
+//utility function
+static library_impl_t * library_get_impl(library_t * library) {
+ return (library_impl_t *)*library;
+}
+
+//last error, with the reason reported by the dynamic loader
+static char library_error[512];
+
+//utility function; formats `message` and `reason` into `library_error`
+static char const * library_fail(
+ char const * message,
+ char const * subject,
+ char const * reason
+) {
+ snprintf(
+  library_error,
+  sizeof(library_error),
+  "%s '%s': %s",
+  message,
+  subject,
+  reason ? reason : "unknown error"
+ );
+ return library_error;
+}
+
+//`library_open` implementation
+char const * library_open(library_t * dst, char const * path) {
+ *dst = NULL;
+
+ library_impl_t * result = calloc(1, sizeof(library_impl_t));
+ if (!result) {
+  return "Failed to allocate space for library!";
+ }
+
+ //TODO: handle `string_format` failure
+ result->path = string_format("%s", path);
+ result->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+ if (!result->handle) {
+  free((void *)result->path);
+  free((void *)result);
+  return library_fail("Failed to load library", path, dlerror());
+ }
+
+ *dst = (library_t)result;
+ return NULL;
+}
+
+//`library_free` implementation
+void library_free(library_t * library) {
+ if (!library || !*library) {
+  return;
+ }
+
+ //zero destination
+ library_impl_t * impl = library_get_impl(library);
+ *library = NULL;
+
+ //unload library and free path
+ dlclose(impl->handle);
+ free((void *)impl->path);
+ free((void *)impl);
+}
+
+//`library_get_path` implementation
+char const * library_get_path(library_t * library) {
+ return library_get_impl(library)->path;
+}
+
+//`library_symbol` implementation
+char const * library_symbol(library_t * library, char const * name, void ** dst) {
+ library_impl_t * impl = library_get_impl(library);
+
+ //symbols may legitimately be `NULL`, so failures are told apart by `dlerror`
+ dlerror();
+ *dst = dlsym(impl->handle, name);
+ char const * reason = dlerror();
+ if (reason) {
+  return library_fail("Failed to resolve symbol", name, reason);
+ }
+ return NULL;
+}
+
+//`library_function` implementation
+char const * library_function(
+ library_t * library,
+ char const * name,
+ library_function_t ** dst
+) {
+ *dst = NULL;
+ void * symbol = NULL;
+ char const * error = library_symbol(library, name, &symbol);
+ if (error) {
+  return error;
+ }
+ if (!symbol) {
+  return library_fail("Failed to resolve function", name, "symbol is null");
+ }
+
+ //ISO C has no conversion from object to function pointers; POSIX
+ //guarantees they share a representation
+ memcpy((void *)dst, (void const *)&symbol, sizeof(symbol));
+ return NULL;
+}
@@ -0,0 +1,217 @@
+#define _GNU_SOURCE
+
+#include <aletheia/util/perf.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+//`perf_counter_name` implementation
+char const * perf_counter_name(enum perf_counter_t counter) {
+ switch (counter) {
+  case PERF_CYCLES: return "cycles";
+  case PERF_INSTRUCTIONS: return "instructions";
+  case PERF_CACHE_MISSES: return "cache-misses";
+  case PERF_BRANCH_MISSES: return "branch-misses";
+  case PERF_CONTEXT_SWITCHES: return "context-switches";
+  default: return "unknown";
+ }
+}
+
+//`perf_counters_add` implementation
+void perf_counters_add(perf_counters_t * dst, perf_counters_t const * src) {
+ for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+  dst->available[i] = dst->available[i] || src->available[i];
+  dst->values[i] += src->values[i];
+ }
+}
+
+//`perf_counters_any` implementation
+bool perf_counters_any(perf_counters_t const * counters) {
+ for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+  if (counters->available[i]) {
+   return true;
+  }
+ }
+ return false;
+}
+
+//`perf_group_t` implementation
+typedef struct {
+ //group leader; all other counters are attached to it
+ int leader;
+ int fds[PERF_COUNTER_COUNT];
+ //position of each counter in the group read buffer, if opened
+ size_t
+  open_count,
+  slots[PERF_COUNTER_COUNT];
+} perf_group_impl_t;
+
+//utility function
+static perf_group_impl_t * perf_group_get_impl(perf_group_t * group) {
+ return (perf_group_impl_t *)*group;
+}
+
+#ifdef __linux__
+ //utility function for `perf_group_new`
+ static int perf_group_open_counter(enum perf_counter_t counter, int group_fd) {
+  static struct {
+   uint32_t type;
+   uint64_t config;
+  } const events[PERF_COUNTER_COUNT] = {
+   [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+   [PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+   [PERF_CACHE_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+   [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+   [PERF_CONTEXT_SWITCHES] = {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}
+  };
+
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = events[counter].type;
+  attr.config = events[counter].config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP
+   | PERF_FORMAT_TOTAL_TIME_ENABLED
+   | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  //prefer counting kernel time too, but unprivileged hosts only allow user
+  attr.exclude_kernel = 0;
+  int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+  if (fd == -1) {
+   attr.exclude_kernel = 1;
+   fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+  }
+  return fd;
+ }
+#endif
+
+//`perf_group_new` implementation
+char const * perf_group_new(perf_group_t * dst) {
+ *dst = NULL;
+
+#ifdef __linux__
+ perf_group_impl_t * impl = calloc(1, sizeof(perf_group_impl_t));
+ if (!impl) {
+  return "Failed to allocate space for perf counter group!";
+ }
+ impl->leader = -1;
+ impl->open_count = 0;
+
+ //the first counter that opens becomes the group leader
+ for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+  impl->fds[i] = perf_group_open_counter((enum perf_counter_t)i, impl->leader);
+  if (impl->fds[i] == -1) {
+   continue;
+  }
+  if (impl->leader == -1) {
+   impl->leader = impl->fds[i];
+  }
+  impl->slots[i] = impl->open_count++;
+ }
+
+ if (impl->leader == -1) {
+  free((void *)impl);
+  return "perf_event_open() is not available on this host!";
+ }
+
+ *dst = (perf_group_t)impl;
+ return NULL;
+#else
+ return "perf counters are only supported on linux!";
+#endif
+}
+
+//`perf_group_free` implementation
+void perf_group_free(perf_group_t * group) {
+ if (!group || !*group) {
+  return;
+ }
+
+ //zero destination
+ perf_group_impl_t * impl = perf_group_get_impl(group);
+ *group = NULL;
+
+#ifdef __linux__
+ //close followers before the leader
+ for (size_t i = PERF_COUNTER_COUNT; i-- > 0;) {
+  if (impl->fds[i] != -1) {
+   close(impl->fds[i]);
+  }
+ }
+#endif
+ free((void *)impl);
+}
+
+//`perf_group_start` implementation
+void perf_group_start(perf_group_t * group) {
+#ifdef __linux__
+ perf_group_impl_t * impl = perf_group_get_impl(group);
+ ioctl(impl->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+ ioctl(impl->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+ (void)group;
+#endif
+}
+
+//`perf_group_pause` implementation
+void perf_group_pause(perf_group_t * group) {
+#ifdef __linux__
+ perf_group_impl_t * impl = perf_group_get_impl(group);
+ ioctl(impl->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#else
+ (void)group;
+#endif
+}
+
+//`perf_group_resume` implementation
+void perf_group_resume(perf_group_t * group) {
+#ifdef __linux__
+ perf_group_impl_t * impl = perf_group_get_impl(group);
+ ioctl(impl->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+ (void)group;
+#endif
+}
+
+//`perf_group_stop` implementation
+void perf_group_stop(perf_group_t * group, perf_counters_t * dst) {
+ memset(dst, 0, sizeof(perf_counters_t));
+
+#ifdef __linux__
+ perf_group_impl_t * impl = perf_group_get_impl(group);
+ ioctl(impl->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+ //read format: nr, time enabled, time running, values[nr]
+ uint64_t buffer[3 + PERF_COUNTER_COUNT];
+ ssize_t const expected = (ssize_t)(sizeof(uint64_t) * (3 + impl->open_count));
+ if (read(impl->leader, buffer, sizeof(buffer)) != expected) {
+  return;
+ }
+
+ //scale counts if the kernel had to multiplex the group
+ uint64_t const enabled = buffer[1];
+ uint64_t const running = buffer[2];
+ for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+  if (impl->fds[i] == -1) {
+   continue;
+  }
+  uint64_t value = buffer[3 + impl->slots[i]];
+  if (running && running < enabled) {
+   value = (uint64_t)((double)value * (double)enabled / (double)running);
+  }
+  dst->available[i] = true;
+  dst->values[i] = value;
+ }
+#else
+ (void)group;
+#endif
+}
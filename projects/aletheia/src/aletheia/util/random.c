@@ -0,0 +1,30 @@
+#include <aletheia/util/random.h>
+
+//`random_seed` implementation
+void random_seed(random_t * random, uint64_t seed) {
+ random->state = seed;
+}
+
+//`random_mix` implementation
+uint64_t random_mix(uint64_t value) {
+ value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+ value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+ return value ^ (value >> 31);
+}
+
+//`random_next` implementation
+uint64_t random_next(random_t * random) {
+ random->state += UINT64_C(0x9e3779b97f4a7c15);
+ return random_mix(random->state);
+}
+
+//`random_below` implementation
+uint64_t random_below(random_t * random, uint64_t bound) {
+ //reject the top, partial range, so every residue is equally likely
+ uint64_t const limit = UINT64_MAX - UINT64_MAX % bound;
+ uint64_t value;
+ do {
+  value = random_next(random);
+ } while (value >= limit);
+ return value % bound;
+}
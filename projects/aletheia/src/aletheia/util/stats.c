@@ -0,0 +1,346 @@
+#include <aletheia/util/stats.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+//utility function for `stats_sort`
+static int stats_compare(void const * a, void const * b) {
+ double const x = *(double const *)a;
+ double const y = *(double const *)b;
+ return (x > y) - (x < y);
+}
+
+//`stats_sort` implementation
+void stats_sort(double * samples, size_t count) {
+ qsort(samples, count, sizeof(double), stats_compare);
+}
+
+//`stats_sorted_median` implementation
+double stats_sorted_median(double const * sorted, size_t count) {
+ if (!count) {
+  return 0.0;
+ }
+ if (count % 2) {
+  return sorted[count / 2];
+ }
+ return (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0;
+}
+
+//`stats_summarize` implementation
+bool stats_summarize(
+ double const * samples,
+ size_t count,
+ stats_summary_t * dst
+) {
+ //zero destination
+ memset(dst, 0, sizeof(stats_summary_t));
+ if (!count) {
+  return true;
+ }
+
+ //sorted scratch copy for order statistics
+ double * sorted = malloc(sizeof(double) * count);
+ if (!sorted) {
+  return false;
+ }
+ memcpy(sorted, samples, sizeof(double) * count);
+ stats_sort(sorted, count);
+
+ //moments
+ double sum = 0.0;
+ for (size_t i = 0; i < count; i++) {
+  sum += sorted[i];
+ }
+ double const mean = sum / (double)count;
+ double squares = 0.0;
+ for (size_t i = 0; i < count; i++) {
+  squares += (sorted[i] - mean) * (sorted[i] - mean);
+ }
+
+ dst->count = count;
+ dst->mean = mean;
+ dst->stddev = count > 1 ? sqrt(squares / (double)(count - 1)) : 0.0;
+ dst->min = sorted[0];
+ dst->max = sorted[count - 1];
+ dst->median = stats_sorted_median(sorted, count);
+
+ //reuse scratch space for absolute deviations
+ for (size_t i = 0; i < count; i++) {
+  sorted[i] = fabs(sorted[i] - dst->median);
+ }
+ stats_sort(sorted, count);
+ dst->mad = stats_sorted_median(sorted, count);
+
+ free((void *)sorted);
+ return true;
+}
+
+//utility type for `stats_mann_whitney_u`
+typedef struct {
+ double value;
+ //whether the value belongs to the first sample set
+ bool first;
+} stats_ranked_t;
+
+static int stats_ranked_compare(void const * a, void const * b) {
+ return stats_compare(
+  &((stats_ranked_t const *)a)->value,
+  &((stats_ranked_t const *)b)->value
+ );
+}
+
+//`stats_mann_whitney_u` implementation
+bool stats_mann_whitney_u(
+ double const * a,
+ size_t a_count,
+ double const * b,
+ size_t b_count,
+ stats_mann_whitney_t * dst
+) {
+ //zero destination; no evidence of a difference by default
+ dst->u = 0.0;
+ dst->z = 0.0;
+ dst->p = 1.0;
+ if (!a_count || !b_count) {
+  return true;
+ }
+
+ //pool and sort both sample sets
+ size_t const count = a_count + b_count;
+ stats_ranked_t * pooled = malloc(sizeof(stats_ranked_t) * count);
+ if (!pooled) {
+  return false;
+ }
+ for (size_t i = 0; i < a_count; i++) {
+  pooled[i] = (stats_ranked_t) { .value = a[i], .first = true };
+ }
+ for (size_t i = 0; i < b_count; i++) {
+  pooled[a_count + i] = (stats_ranked_t) { .value = b[i], .first = false };
+ }
+ qsort(pooled, count, sizeof(stats_ranked_t), stats_ranked_compare);
+
+ //sum ranks of the first set, averaging ranks over ties
+ double rank_sum = 0.0;
+ double tie_correction = 0.0;
+ for (size_t i = 0; i < count;) {
+  size_t j = i + 1;
+  while (j < count && pooled[j].value == pooled[i].value) {
+   j++;
+  }
+  double const ties = (double)(j - i);
+  double const rank = ((double)i + (double)j + 1.0) / 2.0;
+  for (size_t k = i; k < j; k++) {
+   if (pooled[k].first) {
+    rank_sum += rank;
+   }
+  }
+  tie_correction += ties * ties * ties - ties;
+  i = j;
+ }
+ free((void *)pooled);
+
+ double const n1 = (double)a_count;
+ double const n2 = (double)b_count;
+ double const n = n1 + n2;
+ dst->u = rank_sum - n1 * (n1 + 1.0) / 2.0;
+
+ //normal approximation
+ double const mean = n1 * n2 / 2.0;
+ double const variance = n1 * n2 / 12.0
+  * ((n + 1.0) - tie_correction / (n * (n - 1.0)));
+ if (variance <= 0.0) {
+  return true;
+ }
+ double delta = mean - dst->u;
+ if (delta > 0.5) {
+  delta -= 0.5;
+ } else if (delta < -0.5) {
+  delta += 0.5;
+ } else {
+  delta = 0.0;
+ }
+ dst->z = delta / sqrt(variance);
+ dst->p = erfc(fabs(dst->z) / sqrt(2.0));
+
+ return true;
+}
+
+//`stats_median_interval` implementation
+bool stats_median_interval(
+ double const * sorted,
+ size_t count,
+ double confidence,
+ stats_interval_t * dst
+) {
+ memset(dst, 0, sizeof(stats_interval_t));
+ if (!count) {
+  return false;
+ }
+
+ //the interval `[sorted[k], sorted[count - 1 - k]]` misses the median with
+ //probability `2 * P(X <= k)`, for `X ~ Binomial(count, 1/2)`
+ double const n = (double)count;
+ double tail = exp(-n * log(2.0));
+ double achieved = 1.0 - 2.0 * tail;
+ bool const reached = achieved >= confidence;
+ size_t k = 0;
+ for (size_t j = 1; 2 * j + 1 < count; j++) {
+  tail += exp(
+   lgamma(n + 1.0)
+   - lgamma((double)j + 1.0)
+   - lgamma(n - (double)j + 1.0)
+   - n * log(2.0)
+  );
+  double const coverage = 1.0 - 2.0 * tail;
+  if (coverage < confidence) {
+   break;
+  }
+  k = j;
+  achieved = coverage;
+ }
+
+ dst->lower = sorted[k];
+ dst->upper = sorted[count - 1 - k];
+ dst->confidence = achieved;
+ return reached;
+}
+
+//utility function for `stats_shift_interval`; two-sided standard normal
+//quantile for `confidence`, found by bisection
+static double stats_normal_quantile(double confidence) {
+ double lower = 0.0, upper = 40.0;
+ for (size_t i = 0; i < 100; i++) {
+  double const middle = (lower + upper) / 2.0;
+  if (1.0 - erfc(middle / sqrt(2.0)) < confidence) {
+   lower = middle;
+  } else {
+   upper = middle;
+  }
+ }
+ return upper;
+}
+
+//`stats_shift_interval` implementation
+bool stats_shift_interval(
+ double const * a,
+ size_t a_count,
+ double const * b,
+ size_t b_count,
+ double confidence,
+ stats_interval_t * dst
+) {
+ memset(dst, 0, sizeof(stats_interval_t));
+ if (!a_count || !b_count) {
+  return true;
+ }
+
+ //sort all pairwise differences
+ size_t const count = a_count * b_count;
+ double * differences = malloc(sizeof(double) * count);
+ if (!differences) {
+  return false;
+ }
+ for (size_t i = 0; i < a_count; i++) {
+  for (size_t j = 0; j < b_count; j++) {
+   differences[i * b_count + j] = b[j] - a[i];
+  }
+ }
+ stats_sort(differences, count);
+
+ //the interval `[differences[k - 1], differences[count - k]]` misses the
+ //shift with probability `2 * P(U < k)`
+ double const mean = (double)count / 2.0;
+ double const deviation = sqrt((double)count * (double)(a_count + b_count + 1) / 12.0);
+ double k = floor(mean + 0.5 - stats_normal_quantile(confidence) * deviation);
+ if (k < 1.0) {
+  k = 1.0;
+ }
+ dst->lower = differences[(size_t)k - 1];
+ dst->upper = differences[count - (size_t)k];
+ dst->confidence = fmax(0.0, 1.0 - erfc((mean - k + 0.5) / (deviation * sqrt(2.0))));
+ free((void *)differences);
+ return true;
+}
+
+//`stats_complexity_name` implementation
+char const * stats_complexity_name(enum stats_complexity_t complexity) {
+ switch (complexity) {
+  case STATS_COMPLEXITY_1: return "O(1)";
+  case STATS_COMPLEXITY_LOG_N: return "O(log n)";
+  case STATS_COMPLEXITY_N: return "O(n)";
+  case STATS_COMPLEXITY_N_LOG_N: return "O(n log n)";
+  case STATS_COMPLEXITY_N_SQUARED: return "O(n^2)";
+  default: return "O(?)";
+ }
+}
+
+//utility function for `stats_fit_complexity`; evaluates the model at `n`
+static double stats_complexity_eval(enum stats_complexity_t complexity, double n) {
+ switch (complexity) {
+  case STATS_COMPLEXITY_LOG_N: return log2(n);
+  case STATS_COMPLEXITY_N: return n;
+  case STATS_COMPLEXITY_N_LOG_N: return n * log2(n);
+  case STATS_COMPLEXITY_N_SQUARED: return n * n;
+  default: return 1.0;
+ }
+}
+
+//`stats_fit_complexity` implementation
+bool stats_fit_complexity(
+ double const * n,
+ double const * y,
+ size_t count,
+ stats_complexity_fit_t * dst
+) {
+ memset(dst, 0, sizeof(stats_complexity_fit_t));
+ if (count < 2) {
+  return false;
+ }
+
+ bool fitted = false;
+ for (size_t c = 0; c < STATS_COMPLEXITY_COUNT; c++) {
+  enum stats_complexity_t const complexity = (enum stats_complexity_t)c;
+
+  /**
+   *minimize relative rather than absolute error, so sizes spanning several
+   *orders of magnitude weigh equally: c = sum(f / y) / sum((f / y)^2)
+   */
+  double r = 0.0, rr = 0.0;
+  size_t points = 0;
+  for (size_t i = 0; i < count; i++) {
+   if (y[i] <= 0.0) {
+    continue;
+   }
+   double const ratio = stats_complexity_eval(complexity, n[i]) / y[i];
+   r += ratio;
+   rr += ratio * ratio;
+   points++;
+  }
+  if (points < 2 || rr == 0.0) {
+   continue;
+  }
+  double const coefficient = r / rr;
+
+  double squared_error = 0.0;
+  for (size_t i = 0; i < count; i++) {
+   if (y[i] <= 0.0) {
+    continue;
+   }
+   double const error =
+    1.0 - coefficient * stats_complexity_eval(complexity, n[i]) / y[i];
+   squared_error += error * error;
+  }
+  double const rms = sqrt(squared_error / (double)points);
+
+  //ties go to the slower-growing model
+  if (!fitted || rms < dst->rms) {
+   dst->complexity = complexity;
+   dst->coefficient = coefficient;
+   dst->rms = rms;
+   fitted = true;
+  }
+ }
+ return fitted;
+}
@@ -0,0 +1,43 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <aletheia/util/time.h>
+
+#include <time.h>
+
+//batches of back-to-back clock reads used to estimate their cost
+#define TIME_OVERHEAD_BATCHES 16
+#define TIME_OVERHEAD_READS 32
+
+//utility function
+static uint64_t time_from_timespec(struct timespec const * ts) {
+ return (uint64_t)ts->tv_sec * UINT64_C(1000000000) + (uint64_t)ts->tv_nsec;
+}
+
+//`time_now_ns` implementation
+uint64_t time_now_ns(void) {
+ struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return time_from_timespec(&ts);
+}
+
+//`time_now_overhead_ns` implementation
+uint64_t time_now_overhead_ns(void) {
+ //the cheapest batch is the one least disturbed by preemption and interrupts
+ uint64_t best = UINT64_MAX;
+ for (int batch = 0; batch < TIME_OVERHEAD_BATCHES; batch++) {
+  uint64_t const start_ns = time_now_ns();
+  for (int i = 0; i < TIME_OVERHEAD_READS; i++) {
+   (void)time_now_ns();
+  }
+  uint64_t const per_read_ns = (time_now_ns() - start_ns) / (TIME_OVERHEAD_READS + 1);
+  best = per_read_ns < best ? per_read_ns : best;
+ }
+ return best;
+}
+
+//`time_thread_cpu_ns` implementation
+uint64_t time_thread_cpu_ns(void) {
+ struct timespec ts;
+ clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+ return time_from_timespec(&ts);
+}
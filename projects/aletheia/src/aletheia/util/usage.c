@@ -0,0 +1,70 @@
+#define _GNU_SOURCE
+
+#include <aletheia/util/usage.h>
+#include <aletheia/util/time.h>
+
+#include <sys/resource.h>
+
+//`RUSAGE_THREAD` is Linux specific; elsewhere, fall back to the whole process
+#ifndef RUSAGE_THREAD
+#define RUSAGE_THREAD RUSAGE_SELF
+#endif
+
+//utility function
+static uint64_t usage_from_timeval(struct timeval const * tv) {
+ return (uint64_t)tv->tv_sec * UINT64_C(1000000000) + (uint64_t)tv->tv_usec * 1000;
+}
+
+//utility function; difference clamped at zero
+static uint64_t usage_sub(uint64_t end, uint64_t start) {
+ return end > start ? end - start : 0;
+}
+
+//`usage_sample` implementation
+void usage_sample(usage_t * dst) {
+ struct rusage usage;
+ if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+  *dst = (usage_t) {.wall_ns = time_now_ns()};
+  return;
+ }
+ *dst = (usage_t) {
+  .wall_ns = time_now_ns(),
+  .user_ns = usage_from_timeval(&usage.ru_utime),
+  .sys_ns = usage_from_timeval(&usage.ru_stime),
+  .max_rss_kb = (uint64_t)usage.ru_maxrss,
+  .minor_faults = (uint64_t)usage.ru_minflt,
+  .major_faults = (uint64_t)usage.ru_majflt
+ };
+}
+
+//`usage_delta` implementation
+void usage_delta(usage_t const * start, usage_t const * end, usage_t * dst) {
+ *dst = (usage_t) {
+  .wall_ns = usage_sub(end->wall_ns, start->wall_ns),
+  .user_ns = usage_sub(end->user_ns, start->user_ns),
+  .sys_ns = usage_sub(end->sys_ns, start->sys_ns),
+  .max_rss_kb = usage_sub(end->max_rss_kb, start->max_rss_kb),
+  .minor_faults = usage_sub(end->minor_faults, start->minor_faults),
+  .major_faults = usage_sub(end->major_faults, start->major_faults)
+ };
+}
+
+//`usage_add` implementation
+void usage_add(usage_t * dst, usage_t const * src) {
+ dst->wall_ns += src->wall_ns;
+ dst->user_ns += src->user_ns;
+ dst->sys_ns += src->sys_ns;
+ dst->max_rss_kb += src->max_rss_kb;
+ dst->minor_faults += src->minor_faults;
+ dst->major_faults += src->major_faults;
+}
+
+//`usage_any` implementation
+bool usage_any(usage_t const * usage) {
+ return usage->wall_ns
+  || usage->user_ns
+  || usage->sys_ns
+  || usage->max_rss_kb
+  || usage->minor_faults
+  || usage->major_faults;
+}
@@ -0,0 +1,166 @@
+/*this file contains tests for the aletheia allocation accounting; do not use
+ *the definitions in `<aletheia/test.h>` to create tests here
+ *
+ *NOTE: no interposer is linked into this executable, so allocations are
+ *reported through the hooks directly
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include <aletheia/alloc.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+static void test__alloc__counting(void) {
+ alloc_stats_t stats;
+
+ //allocations outside of a tracked region are ignored
+ alloc_tracking_on_alloc(100, 112);
+ alloc_tracking_start();
+ alloc_tracking_on_alloc(10, 16);
+ alloc_tracking_on_alloc(20, 24);
+ alloc_tracking_on_free(16);
+ alloc_tracking_on_alloc(8, 8);
+ alloc_tracking_stop(&stats);
+ alloc_tracking_on_alloc(100, 112);
+
+ assert_true(alloc_tracking_available());
+ assert_true(stats.allocs == 3);
+ assert_true(stats.frees == 1);
+ assert_true(stats.bytes == 38);
+ assert_true(stats.peak_bytes == 40);
+}
+
+//utility function; reports an allocation from another thread
+static void * allocating_thread(void * arg) {
+ alloc_tracking_on_alloc(10, 16);
+ return arg;
+}
+
+static void test__alloc__suspend(void) {
+ alloc_stats_t stats;
+
+ alloc_tracking_start();
+ alloc_tracking_on_alloc(10, 16);
+ alloc_tracking_suspend();
+ alloc_tracking_suspend();
+ alloc_tracking_on_alloc(1000, 1008);
+ alloc_tracking_resume();
+ alloc_tracking_on_alloc(1000, 1008);
+ alloc_tracking_resume();
+ alloc_tracking_on_alloc(10, 16);
+ alloc_tracking_stop(&stats);
+
+ assert_true(stats.allocs == 2);
+ assert_true(stats.bytes == 20);
+
+ //suspending one thread does not hide allocations of others
+ alloc_tracking_start();
+ alloc_tracking_suspend();
+ pthread_t thread;
+ assert_true(pthread_create(&thread, NULL, allocating_thread, NULL) == 0);
+ pthread_join(thread, NULL);
+ alloc_tracking_on_alloc(1000, 1008);
+ alloc_tracking_resume();
+ alloc_tracking_stop(&stats);
+
+ assert_true(stats.allocs == 1);
+ assert_true(stats.bytes == 10);
+}
+
+static void test__alloc__stats_add(void) {
+ alloc_stats_t total = {0, 0, 0, 0};
+ alloc_stats_t const a = {.allocs = 1, .frees = 1, .bytes = 8, .peak_bytes = 8};
+ alloc_stats_t const b = {.allocs = 2, .frees = 0, .bytes = 64, .peak_bytes = 64};
+ alloc_stats_add(&total, &a);
+ alloc_stats_add(&total, &b);
+ assert_true(total.allocs == 3);
+ assert_true(total.bytes == 72);
+ assert_true(total.peak_bytes == 64);
+}
+
+//utility macro; fake, suitably aligned block addresses
+#define BLOCK(n) ((void const *)(uintptr_t)(0x10000 + (n) * 16))
+
+static void test__alloc__leaks(void) {
+ alloc_block_t blocks[4];
+ bool overflowed = true;
+
+ //blocks from outside the region are neither recorded nor reported
+ alloc_leaks_on_alloc(BLOCK(0), 8, NULL);
+ alloc_leaks_start();
+ alloc_leaks_on_free(BLOCK(0));
+ alloc_leaks_on_alloc(BLOCK(1), 10, BLOCK(100));
+ alloc_leaks_on_alloc(BLOCK(2), 20, BLOCK(200));
+ alloc_leaks_on_free(BLOCK(1));
+ //blocks allocated while suspended are the framework's
+ alloc_tracking_suspend();
+ alloc_leaks_on_alloc(BLOCK(3), 30, NULL);
+ alloc_tracking_resume();
+ assert_true(alloc_leaks_stop(blocks, 4, &overflowed) == 1);
+ assert_true(!overflowed);
+ assert_true(blocks[0].ptr == BLOCK(2));
+ assert_true(blocks[0].size == 20);
+ assert_true(blocks[0].site == BLOCK(200));
+
+ //stopping empties the table
+ alloc_leaks_start();
+ assert_true(alloc_leaks_stop(blocks, 4, &overflowed) == 0);
+}
+
+static void test__alloc__leaks_many(void) {
+ alloc_block_t blocks[2];
+ bool overflowed = true;
+
+ //colliding blocks must survive removals of their neighbours
+ size_t const count = 10000;
+ alloc_leaks_start();
+ for (size_t i = 0; i < count; i++) {
+  alloc_leaks_on_alloc(BLOCK(i), i, NULL);
+ }
+ for (size_t i = 0; i < count; i++) {
+  if (i % 5000) {
+   alloc_leaks_on_free(BLOCK(i));
+  }
+ }
+ assert_true(alloc_leaks_stop(blocks, 2, &overflowed) == 2);
+ assert_true(!overflowed);
+ assert_true(blocks[0].size % 5000 == 0 && blocks[1].size % 5000 == 0);
+ assert_true(blocks[0].size != blocks[1].size);
+
+ //exceeding the table is reported instead of silently dropping leaks
+ alloc_leaks_start();
+ for (size_t i = 0; i < ALLOC_LEAKS_CAPACITY; i++) {
+  alloc_leaks_on_alloc(BLOCK(i), 1, NULL);
+ }
+ assert_true(alloc_leaks_stop(blocks, 2, &overflowed) == ALLOC_LEAKS_CAPACITY - 1);
+ assert_true(overflowed);
+}
+
+int main(void) {
+ test__alloc__counting();
+ test__alloc__suspend();
+ test__alloc__stats_add();
+ test__alloc__leaks();
+ test__alloc__leaks_many();
+
+ return 0;
+}
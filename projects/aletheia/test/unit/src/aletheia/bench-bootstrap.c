@@ -0,0 +1,808 @@
+/*this file contains tests for the aletheia benchmark runner; do not use the
+ *definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <aletheia/bench.h>
+#include <aletheia/util/time.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+
+ printf(
+  "error assertion failed on line %d: `%s`\nerror:\n%s\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//benchmark callbacks
+static uint64_t loop_iterations;
+
+static void counting_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  loop_iterations++;
+ }
+}
+
+static int64_t seen_args[16][2];
+static size_t seen_count;
+
+static void args_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ //record the arguments of every instance once
+ if (seen_count < 16
+  && (!seen_count || seen_args[seen_count - 1][0] != bench_state_get_arg(&state, 0)
+   || seen_args[seen_count - 1][1] != bench_state_get_arg(&state, 1))
+ ) {
+  seen_args[seen_count][0] = bench_state_get_arg(&state, 0);
+  seen_args[seen_count][1] = bench_state_get_arg(&state, 1);
+  seen_count++;
+ }
+ assert_true(bench_state_get_arg(&state, 2) == 0);
+ while (bench_state_keep_running(&state)) {
+  loop_iterations++;
+ }
+}
+
+static uint64_t threaded_iterations;
+static uint64_t threaded_index_mask;
+
+static void threaded_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ size_t const index = bench_state_get_thread_index(&state);
+ assert_true(index < bench_state_get_thread_count(&state));
+ __atomic_or_fetch(&threaded_index_mask, UINT64_C(1) << index, __ATOMIC_RELAXED);
+ uint64_t local = 0;
+ while (bench_state_keep_running(&state)) {
+  local++;
+ }
+ __atomic_add_fetch(&threaded_iterations, local, __ATOMIC_RELAXED);
+}
+
+static void counter_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  loop_iterations++;
+ }
+ //overwriting keeps the last value; threads sum their values
+ bench_state_set_counter(&state, "ones", 2.0);
+ bench_state_set_counter(&state, "ones", 1.0);
+ bench_state_set_counter(&state, "iterations", (double)bench_state_get_iterations(&state));
+}
+
+//nanoseconds of untimed work done by every iteration of `paused_bench`
+#define PAUSED_WORK_NS UINT64_C(5000)
+
+static void paused_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  bench_state_pause_timing(&state);
+  uint64_t const start_ns = time_now_ns();
+  while (time_now_ns() - start_ns < PAUSED_WORK_NS) {}
+  bench_state_resume_timing(&state);
+  loop_iterations++;
+ }
+}
+
+//context handed from the setup hooks to `hooked_bench`
+typedef struct {
+ size_t
+  before_count,
+  after_count,
+  callback_count;
+} hook_data_t;
+
+static hook_data_t hook_data;
+
+static void hooked_bench(bench_state_t state, void * ctx) {
+ assert_true(ctx == &hook_data);
+ hook_data.callback_count++;
+ while (bench_state_keep_running(&state)) {
+  loop_iterations++;
+ }
+}
+
+static void before_each_hook(bench_runner_setup_t setup) {
+ bench_t bench = bench_runner_setup_get_bench(&setup);
+ char const * name = NULL;
+ assert_no_error(bench_get_name(&bench, &name));
+ assert_true(strcmp(name, "hooked") == 0);
+ free((void *)name);
+ hook_data.before_count++;
+ bench_runner_setup_set_ctx(&setup, &hook_data);
+}
+
+static void after_each_hook(bench_runner_setup_t setup) {
+ assert_true(bench_runner_setup_get_ctx(&setup) == &hook_data);
+ hook_data.after_count++;
+}
+
+static void failing_hook(bench_runner_setup_t setup) {
+ bench_runner_setup_fail(&setup, "no fixture");
+}
+
+static void empty_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {}
+}
+
+static void escaped_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  int64_t sum = 0;
+  for (int64_t i = 0; i < 256; i++) {
+   sum += i;
+   BENCH_ESCAPE(&sum);
+  }
+ }
+}
+
+static void short_sum_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  int64_t sum = 0;
+  for (int64_t i = 0; i < 64; i++) {
+   sum += i;
+   BENCH_ESCAPE(&sum);
+  }
+ }
+}
+
+static void long_sum_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  int64_t sum = 0;
+  for (int64_t i = 0; i < 512; i++) {
+   sum += i;
+   BENCH_ESCAPE(&sum);
+  }
+ }
+}
+
+static void incomplete_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ bench_state_keep_running(&state);
+}
+
+static bench_runner_config_t const quick_config = {
+ .min_time_ns = UINT64_C(1000000),
+ .warmup_time_ns = UINT64_C(100000),
+ .repetitions = 5
+};
+
+//optimization barrier tests
+static void test__bench__barriers(void) {
+ //escaped stores happen, and are visible after a clobber
+ int64_t values[4] = {0, 0, 0, 0};
+ for (int64_t i = 0; i < 4; i++) {
+  values[i] = i * i;
+  BENCH_ESCAPE(values + i);
+ }
+ BENCH_CLOBBER();
+ for (int64_t i = 0; i < 4; i++) {
+  assert_true(values[i] == i * i);
+ }
+
+ //fallbacks for compilers without inline assembly
+ bench_escape_sink = values;
+ bench_clobber_fallback();
+ assert_true(bench_escape_sink == values);
+ values[0] = 42;
+ bench_clobber_fallback();
+ assert_true(((int64_t const *)bench_escape_sink)[0] == 42);
+}
+
+//`bench_t` tests
+static void test__bench_t__run(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "counting", counting_bench));
+
+ //validate name
+ char const * name = NULL;
+ assert_no_error(bench_get_name(&bench, &name));
+ assert_true(strcmp(name, "counting") == 0);
+ free((void *)name);
+
+ //run benchmark
+ loop_iterations = 0;
+ assert_no_error(bench_run(&bench, quick_config));
+
+ //validate calibration and statistics
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.iterations > 1);
+ assert_true(stats.time.count == quick_config.repetitions);
+ assert_true(stats.time.min <= stats.time.median);
+ assert_true(stats.time.median <= stats.time.max);
+ assert_true(loop_iterations >= stats.iterations * quick_config.repetitions);
+
+ //validate samples
+ size_t sample_count = 0;
+ double * samples = NULL;
+ assert_no_error(bench_get_samples(&bench, &sample_count, &samples));
+ assert_true(sample_count == quick_config.repetitions);
+ free((void *)samples);
+
+ bench_free(&bench);
+}
+
+static void test__bench_t__latency(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "counting", counting_bench));
+
+ //without a batch size, no latencies are recorded
+ histogram_t * latency = NULL;
+ assert_no_error(bench_run(&bench, quick_config));
+ assert_no_error(bench_get_latency(&bench, &latency));
+ assert_true(latency == NULL);
+
+ //batches of 3 leave a partial trailing batch for most iteration counts
+ bench_runner_config_t config = quick_config;
+ config.latency_batch = 3;
+ assert_no_error(bench_run(&bench, config));
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_no_error(bench_get_latency(&bench, &latency));
+ assert_true(latency != NULL);
+ //every measured iteration is accounted for, across all repetitions
+ assert_true(latency->count == stats.iterations * config.repetitions);
+ assert_true(histogram_percentile(latency, 50.0) <= latency->max);
+ free((void *)latency);
+
+ //latencies survive copies
+ bench_t copy;
+ assert_no_error(bench_copy(&bench, &copy));
+ assert_no_error(bench_get_latency(&copy, &latency));
+ assert_true(latency != NULL);
+ assert_true(latency->count == stats.iterations * config.repetitions);
+ free((void *)latency);
+ bench_free(&copy);
+
+ bench_free(&bench);
+}
+
+static void test__bench_t__stabilize(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "counting", counting_bench));
+
+ bench_runner_config_t config = quick_config;
+ config.stabilize = true;
+ assert_no_error(bench_run(&bench, config));
+
+ //noisy hosts may flag the result, but only with known reasons
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.time.count == config.repetitions);
+ assert_true((stats.unstable & ~(unsigned)(
+  BENCH_UNSTABLE_WARMUP
+  | BENCH_UNSTABLE_VARIANCE
+  | BENCH_UNSTABLE_FREQUENCY
+  | BENCH_UNSTABLE_THROTTLED
+ )) == 0);
+
+ //unstabilized runs are never flagged
+ assert_no_error(bench_run(&bench, quick_config));
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.unstable == 0);
+
+ bench_free(&bench);
+}
+
+static void test__bench_t__counters(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "counter", counter_bench));
+ assert_no_error(bench_run(&bench, quick_config));
+
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.cpu_time.count == quick_config.repetitions);
+ assert_true(stats.cpu_time.min > 0.0);
+
+ size_t count = 0;
+ char ** names = NULL;
+ assert_no_error(bench_get_counter_names(&bench, &count, &names));
+ assert_true(count == 2);
+ assert_true(strcmp(names[0], "ones") == 0);
+ assert_true(strcmp(names[1], "iterations") == 0);
+ for (size_t i = 0; i < count; i++) {
+  free((void *)names[i]);
+ }
+ free((void *)names);
+
+ size_t sample_count = 0;
+ double * samples = NULL;
+ assert_no_error(bench_get_counter_samples(&bench, 1, &sample_count, &samples));
+ assert_true(sample_count == quick_config.repetitions);
+ for (size_t i = 0; i < sample_count; i++) {
+  assert_true(samples[i] == (double)stats.iterations);
+ }
+ free((void *)samples);
+ assert_true(bench_get_counter_samples(&bench, 2, &sample_count, &samples) != NULL);
+
+ //counters of all threads are summed
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+ size_t const thread_counts[] = {3};
+ assert_no_error(bench_suite_add_threads(&suite, &bench, 1, thread_counts));
+ assert_true(bench_suite_run_and_emit(&suite, quick_config) == 0);
+ bench_t * benches = NULL;
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_no_error(bench_get_counter_samples(&benches[0], 0, &sample_count, &samples));
+ assert_true(samples[0] == 3.0);
+ free((void *)samples);
+ bench_free(&benches[0]);
+ free((void *)benches);
+ bench_suite_free(&suite);
+
+ bench_free(&bench);
+}
+
+static void test__bench_t__paused(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "paused", paused_bench));
+ bench_runner_config_t config = quick_config;
+ config.latency_batch = 1;
+ assert_no_error(bench_run(&bench, config));
+
+ //the untimed work is excluded from wall time, cpu time and latencies
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.time.median < (double)PAUSED_WORK_NS / 2.0);
+ assert_true(stats.cpu_time.median < (double)PAUSED_WORK_NS / 2.0);
+ histogram_t * latency = NULL;
+ assert_no_error(bench_get_latency(&bench, &latency));
+ assert_true(latency != NULL);
+ assert_true(histogram_percentile(latency, 50.0) < PAUSED_WORK_NS / 2);
+ free((void *)latency);
+
+ bench_free(&bench);
+}
+
+static void test__bench_t__hooks(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "hooked", hooked_bench));
+ bench_runner_config_t config = quick_config;
+ config.before_each = before_each_hook;
+ config.after_each = after_each_hook;
+
+ //hooks run once per benchmark, around warmup and all repetitions
+ memset(&hook_data, 0, sizeof(hook_data));
+ assert_no_error(bench_run(&bench, config));
+ assert_true(hook_data.before_count == 1);
+ assert_true(hook_data.after_count == 1);
+ assert_true(hook_data.callback_count > quick_config.repetitions);
+
+ //a failing initializer skips the benchmark
+ memset(&hook_data, 0, sizeof(hook_data));
+ config.before_each = failing_hook;
+ char const * error = bench_run(&bench, config);
+ assert_true(error != NULL);
+ assert_true(strstr(error, "'before_each()'") != NULL);
+ assert_true(strstr(error, "no fixture") != NULL);
+ assert_true(hook_data.callback_count == 0);
+ assert_true(hook_data.after_count == 0);
+
+ //a failing destructor fails the benchmark, without results
+ config.before_each = before_each_hook;
+ config.after_each = failing_hook;
+ error = bench_run(&bench, config);
+ assert_true(error != NULL);
+ assert_true(strstr(error, "'after_each()'") != NULL);
+ char const * stored = NULL;
+ assert_no_error(bench_get_error(&bench, &stored));
+ assert_true(stored == error);
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.iterations == 0);
+
+ bench_free(&bench);
+}
+
+static void test__bench_t__too_fast(void) {
+ bench_t bench;
+ bench_stats_t stats;
+
+ //an empty body runs no slower than the timed loop itself
+ assert_no_error(bench_new(&bench, "empty", empty_bench));
+ assert_no_error(bench_run(&bench, quick_config));
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.loop_floor > 0.0);
+ assert_true(stats.too_fast);
+ bench_free(&bench);
+
+ //escaped work is kept, and measured
+ assert_no_error(bench_new(&bench, "escaped", escaped_bench));
+ assert_no_error(bench_run(&bench, quick_config));
+ assert_no_error(bench_get_stats(&bench, &stats));
+ assert_true(stats.time.median > stats.loop_floor * 10.0);
+ assert_true(!stats.too_fast);
+ bench_free(&bench);
+}
+
+static void test__bench_t__incomplete_loop(void) {
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "incomplete", incomplete_bench));
+ assert_true(bench_run(&bench, quick_config) != NULL);
+
+ //the error is kept, without partial results
+ char const * error = NULL;
+ assert_no_error(bench_get_error(&bench, &error));
+ assert_true(error != NULL);
+ size_t sample_count = 1;
+ double * samples = NULL;
+ assert_no_error(bench_get_samples(&bench, &sample_count, &samples));
+ assert_true(sample_count == 0 && samples == NULL);
+ bench_free(&bench);
+}
+
+//`bench_suite_t` tests
+static void test__bench_suite_t__run(void) {
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+
+ //add benchmarks
+ bench_t bench;
+ for (size_t i = 0; i < 6; i++) {
+  assert_no_error(bench_new(&bench, "counting", counting_bench));
+  assert_no_error(bench_suite_add(&suite, &bench));
+  bench_free(&bench);
+ }
+ assert_no_error(bench_new(&bench, "incomplete", incomplete_bench));
+ assert_no_error(bench_suite_add(&suite, &bench));
+ bench_free(&bench);
+
+ //only the incomplete benchmark fails
+ assert_true(bench_suite_run_and_emit(&suite, quick_config) == 1);
+
+ //validate benchmarks
+ size_t count = 0;
+ bench_t * benches = NULL;
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_true(count == 7);
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&benches[0], &stats));
+ assert_true(stats.time.count == quick_config.repetitions);
+ for (size_t i = 0; i < count; i++) {
+  bench_free(&benches[i]);
+ }
+ free((void *)benches);
+
+ bench_suite_free(&suite);
+}
+
+static void test__bench_suite_t__args(void) {
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "args", args_bench));
+
+ //invalid ranges are rejected
+ bench_arg_range_t const invalid[] = {BENCH_RANGE(8, 4, 2)};
+ assert_true(bench_suite_add_args(&suite, &bench, 1, invalid) != NULL);
+ bench_arg_range_t const invalid_multiplier[] = {BENCH_RANGE(1, 4, 1)};
+ assert_true(bench_suite_add_args(&suite, &bench, 1, invalid_multiplier) != NULL);
+
+ //geometric ranges include their limit; the last dimension varies fastest
+ bench_arg_range_t const ranges[] = {
+  BENCH_RANGE(8, 100, 4),
+  BENCH_LIST(-1, 7)
+ };
+ assert_no_error(bench_suite_add_args(&suite, &bench, 2, ranges));
+ bench_free(&bench);
+
+ int64_t const expected[][2] = {
+  {8, -1}, {8, 7},
+  {32, -1}, {32, 7},
+  {100, -1}, {100, 7}
+ };
+ char const * const expected_names[] = {
+  "args/8/-1", "args/8/7",
+  "args/32/-1", "args/32/7",
+  "args/100/-1", "args/100/7"
+ };
+
+ size_t count = 0;
+ bench_t * benches = NULL;
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_true(count == 6);
+ for (size_t i = 0; i < count; i++) {
+  char const * name = NULL;
+  size_t arg_count = 0;
+  int64_t args[BENCH_MAX_ARGS];
+  assert_no_error(bench_get_name(&benches[i], &name));
+  assert_true(strcmp(name, expected_names[i]) == 0);
+  free((void *)name);
+  assert_no_error(bench_get_args(&benches[i], &arg_count, args));
+  assert_true(arg_count == 2);
+  assert_true(args[0] == expected[i][0] && args[1] == expected[i][1]);
+  bench_free(&benches[i]);
+ }
+ free((void *)benches);
+
+ //every instance sees its own arguments
+ seen_count = 0;
+ assert_true(bench_suite_run_and_emit(&suite, quick_config) == 0);
+ assert_true(seen_count == 6);
+ for (size_t i = 0; i < seen_count; i++) {
+  assert_true(seen_args[i][0] == expected[i][0]);
+  assert_true(seen_args[i][1] == expected[i][1]);
+ }
+
+ bench_suite_free(&suite);
+}
+
+static void test__bench_suite_t__threads(void) {
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "threaded", threaded_bench));
+ size_t const invalid[] = {1, 0};
+ assert_true(bench_suite_add_threads(&suite, &bench, 2, invalid) != NULL);
+ bench_free(&bench);
+ bench_suite_free(&suite);
+
+ assert_no_error(bench_suite_new(&suite));
+ assert_no_error(bench_new(&bench, "threaded", threaded_bench));
+ size_t const thread_counts[] = {1, 3};
+ assert_no_error(bench_suite_add_threads(&suite, &bench, 2, thread_counts));
+ bench_free(&bench);
+ assert_no_error(bench_new(&bench, "incomplete", incomplete_bench));
+ assert_no_error(bench_suite_add_threads(&suite, &bench, 1, thread_counts + 1));
+ bench_free(&bench);
+
+ //only the incomplete benchmark fails, without deadlocking the barrier
+ threaded_index_mask = 0;
+ threaded_iterations = 0;
+ assert_true(bench_suite_run_and_emit(&suite, quick_config) == 1);
+ assert_true(threaded_index_mask == 7);
+
+ size_t count = 0;
+ bench_t * benches = NULL;
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_true(count == 3);
+
+ char const * name = NULL;
+ assert_no_error(bench_get_name(&benches[1], &name));
+ assert_true(strcmp(name, "threaded/threads:3") == 0);
+ free((void *)name);
+
+ //every thread runs the calibrated number of iterations
+ bench_stats_t single, threaded;
+ assert_no_error(bench_get_stats(&benches[0], &single));
+ assert_no_error(bench_get_stats(&benches[1], &threaded));
+ assert_true(single.threads == 1);
+ assert_true(threaded.threads == 3);
+ assert_true(threaded.throughput.count == quick_config.repetitions);
+ assert_true(threaded.throughput.min > 0.0);
+ assert_true(
+  threaded_iterations
+  >= (single.iterations + threaded.iterations * 3) * quick_config.repetitions
+ );
+
+ //throughput samples are per repetition
+ size_t sample_count = 0;
+ double * samples = NULL;
+ assert_no_error(bench_get_throughput(&benches[1], &sample_count, &samples));
+ assert_true(sample_count == quick_config.repetitions);
+ free((void *)samples);
+
+ for (size_t i = 0; i < count; i++) {
+  bench_free(&benches[i]);
+ }
+ free((void *)benches);
+ bench_suite_free(&suite);
+}
+
+static void test__bench_suite_t__comparison(void) {
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+ bench_callback_t * const callbacks[] = {short_sum_bench, long_sum_bench, incomplete_bench};
+ assert_true(bench_suite_add_comparison_callbacks(&suite, "single", "short", 1, callbacks) != NULL);
+ assert_no_error(bench_suite_add_comparison_callbacks(
+  &suite,
+  "sum",
+  "short_sum_bench, long_sum_bench",
+  2,
+  callbacks
+ ));
+ //a failing variant fails its whole group
+ assert_no_error(bench_suite_add_comparison_callbacks(
+  &suite,
+  "broken",
+  "short_sum_bench,incomplete_bench",
+  2,
+  (bench_callback_t * const[]) {short_sum_bench, incomplete_bench}
+ ));
+ //an empty variant is flagged against the floor, like a lone benchmark
+ assert_no_error(bench_suite_add_comparison_callbacks(
+  &suite,
+  "floor",
+  "empty_bench,escaped_bench",
+  2,
+  (bench_callback_t * const[]) {empty_bench, escaped_bench}
+ ));
+ bench_runner_config_t config = quick_config;
+ config.repetitions = 10;
+ assert_true(bench_suite_run_and_emit(&suite, config) == 2);
+
+ size_t count = 0;
+ bench_t * benches = NULL;
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_true(count == 6);
+ char const * names[] = {
+  "sum/short_sum_bench",
+  "sum/long_sum_bench",
+  "broken/short_sum_bench",
+  "broken/incomplete_bench",
+  "floor/empty_bench",
+  "floor/escaped_bench"
+ };
+ for (size_t i = 0; i < count; i++) {
+  char const * name = NULL;
+  assert_no_error(bench_get_name(&benches[i], &name));
+  assert_true(strcmp(name, names[i]) == 0);
+  free((void *)name);
+ }
+
+ //the reference has no comparison; the longer sum is reliably slower
+ bench_comparison_t comparison;
+ assert_no_error(bench_get_comparison(&benches[0], &comparison));
+ assert_true(comparison.rounds == 0);
+ assert_no_error(bench_get_comparison(&benches[1], &comparison));
+ assert_true(comparison.rounds == config.repetitions);
+ assert_true(comparison.median > 100.0);
+ assert_true(comparison.interval.lower > 0.0);
+ assert_true(comparison.interval.lower <= comparison.median);
+ assert_true(comparison.interval.upper >= comparison.median);
+ assert_true(comparison.interval.confidence >= BENCH_COMPARISON_CONFIDENCE);
+ bench_stats_t stats;
+ assert_no_error(bench_get_stats(&benches[1], &stats));
+ assert_true(stats.time.count == config.repetitions);
+
+ //variants share the loop floor measured alongside them
+ bench_stats_t reference_stats;
+ assert_no_error(bench_get_stats(&benches[0], &reference_stats));
+ assert_true(stats.loop_floor > 0.0);
+ assert_true(stats.loop_floor == reference_stats.loop_floor);
+ assert_true(!stats.too_fast);
+ assert_no_error(bench_get_stats(&benches[4], &stats));
+ assert_true(stats.loop_floor > 0.0);
+ assert_true(stats.too_fast);
+ assert_no_error(bench_get_stats(&benches[5], &stats));
+ assert_true(!stats.too_fast);
+
+ char const * error = NULL;
+ assert_no_error(bench_get_error(&benches[2], &error));
+ assert_true(error != NULL);
+ assert_no_error(bench_get_stats(&benches[2], &stats));
+ assert_true(stats.time.count == 0);
+
+ for (size_t i = 0; i < count; i++) {
+  bench_free(&benches[i]);
+ }
+ free((void *)benches);
+ bench_suite_free(&suite);
+}
+
+//resolves the function under test from the library passed as `ctx`
+static void library_bench(bench_state_t state, void * ctx) {
+ library_t library = (library_t)ctx;
+ library_function_t * function = NULL;
+ if (library_function(&library, "cos", &function)) {
+  //returning without running fails the benchmark
+  return;
+ }
+ double (*cosine)(double) = (double (*)(double))function;
+ double volatile input = 0.5;
+ while (bench_state_keep_running(&state)) {
+  double result = cosine(input);
+  BENCH_ESCAPE(&result);
+ }
+}
+
+static void test__bench_suite_t__libraries(void) {
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "cos", library_bench));
+ assert_no_error(bench_suite_add_per_library(&suite, &bench));
+ bench_free(&bench);
+
+ //per-library benchmarks are skipped until libraries are added
+ size_t count = 0;
+ bench_t * benches = NULL;
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_true(count == 0);
+ free((void *)benches);
+
+ //two handles to the same build; hosts without it have nothing to compare
+ library_t libraries[2] = {NULL, NULL};
+ if (library_open(libraries, "libm.so.6") || library_open(libraries + 1, "libm.so.6")) {
+  library_free(libraries);
+  bench_suite_free(&suite);
+  return;
+ }
+ assert_true(bench_suite_add_library_comparisons(&suite, 0, libraries) != NULL);
+ assert_no_error(bench_suite_add_library_comparisons(&suite, 2, libraries));
+ bench_runner_config_t config = quick_config;
+ config.repetitions = 3;
+ assert_true(bench_suite_run_and_emit(&suite, config) == 0);
+
+ assert_no_error(bench_suite_get_benches(&suite, &count, &benches));
+ assert_true(count == 2);
+ for (size_t i = 0; i < count; i++) {
+  char const * name = NULL;
+  assert_no_error(bench_get_name(&benches[i], &name));
+  assert_true(strcmp(name, "cos/libm.so.6") == 0);
+  free((void *)name);
+ }
+ bench_comparison_t comparison;
+ assert_no_error(bench_get_comparison(&benches[1], &comparison));
+ assert_true(comparison.rounds == config.repetitions);
+
+ for (size_t i = 0; i < count; i++) {
+  bench_free(&benches[i]);
+ }
+ free((void *)benches);
+ bench_suite_free(&suite);
+ library_free(libraries);
+ library_free(libraries + 1);
+}
+
+int main(void) {
+ //optimization barrier tests
+ test__bench__barriers();
+
+ //`bench_t` tests
+ test__bench_t__run();
+ test__bench_t__latency();
+ test__bench_t__stabilize();
+ test__bench_t__counters();
+ test__bench_t__paused();
+ test__bench_t__hooks();
+ test__bench_t__too_fast();
+ test__bench_t__incomplete_loop();
+
+ //`bench_suite_t` tests
+ test__bench_suite_t__run();
+ test__bench_suite_t__args();
+ test__bench_suite_t__threads();
+ test__bench_suite_t__comparison();
+ test__bench_suite_t__libraries();
+
+ return 0;
+}
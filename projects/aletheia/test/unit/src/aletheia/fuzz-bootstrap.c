@@ -0,0 +1,251 @@
+/*this file contains tests for aletheia fuzz targets; do not use the
+ *definitions in `<aletheia/test.h>` to create tests here
+ */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <aletheia/test.h>
+#include <aletheia/fuzz.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+ printf(
+  "error assertion failed on line %d: `%s` returned error: `%s`\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//coverage hooks implemented by aletheia, called by hand below in place of
+//`-fsanitize-coverage=trace-pc-guard` instrumentation
+void __sanitizer_cov_trace_pc_guard_init(uint32_t * start, uint32_t * stop);
+void __sanitizer_cov_trace_pc_guard(uint32_t * guard);
+static uint32_t guards[4];
+
+//fails only for inputs starting with "FUZ", one instrumented branch per byte
+FUZZ_TARGET(fuzz__prefix) {
+ __sanitizer_cov_trace_pc_guard(guards + 0);
+ if (size < 1 || data[0] != 'F') {
+  return;
+ }
+ __sanitizer_cov_trace_pc_guard(guards + 1);
+ if (size < 2 || data[1] != 'U') {
+  return;
+ }
+ __sanitizer_cov_trace_pc_guard(guards + 2);
+ if (size < 3) {
+  return;
+ }
+ __sanitizer_cov_trace_pc_guard(guards + 3);
+ test_assert_true(data[2] != 'Z');
+}
+
+//utility functions for corpus directories
+static void write_file(char const * dir, char const * name, char const * contents) {
+ char path[512];
+ snprintf(path, sizeof(path), "%s/%s", dir, name);
+ FILE * file = fopen(path, "wb");
+ assert_true(file != NULL);
+ fwrite(contents, 1, strlen(contents), file);
+ fclose(file);
+}
+
+static int remove_entry(char const * path, struct stat const * status, int flag, struct FTW * ftw) {
+ (void)status;
+ (void)flag;
+ (void)ftw;
+ return remove(path);
+}
+
+static void remove_tree(char const * path) {
+ nftw(path, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+//utility function; runs a suite replaying `fuzz__prefix` and returns the
+//causes of its failures, joined by newlines
+static char * run_replay(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ FUZZ(fuzz__prefix);
+ test_suite_run_and_emit(&test_suite, TEST_RUNNER_DEFAULT);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_true(test_count == 1);
+ test_failure_t * failures;
+ size_t failure_count;
+ assert_no_error(test_get_failures(&tests[0], &failure_count, &failures));
+ size_t length = 1;
+ for (size_t i = 0; i < failure_count; i++) {
+  length += strlen(failures[i].cause) + 1;
+ }
+ char * causes = calloc(length, 1);
+ for (size_t i = 0; i < failure_count; i++) {
+  strcat(causes, failures[i].cause);
+  strcat(causes, "\n");
+ }
+ enum test_status_t status;
+ assert_no_error(test_get_status(&tests[0], &status));
+ assert_true((status == TEST_OK) == !failure_count);
+ test_failures_free(&failure_count, &failures);
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+ test_suite_free(&test_suite);
+ return causes;
+}
+
+static void test__fuzz__replay(void) {
+ //without a corpus, only the empty input runs
+ fuzz_set_corpus(NULL);
+ char * causes = run_replay();
+ assert_true(!*causes);
+ free((void *)causes);
+
+ //every corpus file runs; failures name the input
+ char root[] = "/tmp/aletheia-fuzz-XXXXXX";
+ assert_true(mkdtemp(root) != NULL);
+ char dir[512];
+ snprintf(dir, sizeof(dir), "%s/fuzz__prefix", root);
+ assert_true(mkdir(dir, 0777) == 0);
+ write_file(dir, "a", "FOO");
+ write_file(dir, "b", "FUZZ");
+ write_file(dir, "c", "");
+ fuzz_set_corpus(root);
+ causes = run_replay();
+ assert_true(strstr(causes, "Input 'b' (4 bytes): ") != NULL);
+ assert_true(strstr(causes, "Input 'a'") == NULL);
+ free((void *)causes);
+
+ //targets without a corpus directory replay the empty input
+ fuzz_set_corpus("/nonexistent/aletheia-fuzz");
+ causes = run_replay();
+ assert_true(!*causes);
+ free((void *)causes);
+
+ fuzz_set_corpus(NULL);
+ remove_tree(root);
+}
+
+static void test__fuzz__run(void) {
+ fuzz_stats_t stats;
+ fuzz_config_t config = FUZZ_DEFAULT;
+ assert_true(fuzz_run("no such target", config, &stats) != NULL);
+
+ //coverage feedback finds the failing prefix and grows the corpus on the way
+ char root[] = "/tmp/aletheia-fuzz-XXXXXX";
+ assert_true(mkdtemp(root) != NULL);
+ fuzz_set_corpus(root);
+ config.seed = 1;
+ config.max_runs = 50000000;
+ config.max_time_ns = UINT64_C(120000000000);
+ config.max_length = 16;
+ assert_no_error(fuzz_run("fuzz__prefix", config, &stats));
+ assert_true(stats.failed);
+ assert_true(stats.features >= 4);
+ assert_true(stats.corpus_size >= 3);
+
+ //new inputs were saved, and the failing one written next to them
+ char dir[512];
+ snprintf(dir, sizeof(dir), "%s/fuzz__prefix", root);
+ struct dirent ** entries;
+ int count = scandir(dir, &entries, NULL, alphasort);
+ assert_true(count >= 2 + 3);
+ for (int i = 0; i < count; i++) {
+  free((void *)entries[i]);
+ }
+ free((void *)entries);
+ count = scandir(root, &entries, NULL, alphasort);
+ bool crash_found = false;
+ for (int i = 0; i < count; i++) {
+  if (strncmp(entries[i]->d_name, "fuzz__prefix-crash-", 19) == 0) {
+   char path[512];
+   snprintf(path, sizeof(path), "%s/%s", root, entries[i]->d_name);
+   FILE * file = fopen(path, "rb");
+   char contents[4] = {0};
+   assert_true(file && fread(contents, 1, 3, file) == 3);
+   fclose(file);
+   assert_true(strcmp(contents, "FUZ") == 0);
+   crash_found = true;
+  }
+  free((void *)entries[i]);
+ }
+ free((void *)entries);
+ assert_true(crash_found);
+
+ //the saved corpus replays without failing; crashes are kept out of it
+ char * causes = run_replay();
+ assert_true(!*causes);
+ free((void *)causes);
+
+ fuzz_set_corpus(NULL);
+ remove_tree(root);
+
+ //existing inputs are replayed, but neither saved again nor counted twice
+ char seeded[] = "/tmp/aletheia-fuzz-XXXXXX";
+ assert_true(mkdtemp(seeded) != NULL);
+ snprintf(dir, sizeof(dir), "%s/fuzz__prefix", seeded);
+ assert_true(mkdir(dir, 0777) == 0);
+ write_file(dir, "seed", "F");
+ fuzz_set_corpus(seeded);
+ config.max_runs = 1;
+ assert_no_error(fuzz_run("fuzz__prefix", config, &stats));
+ assert_true(!stats.failed);
+ assert_true(stats.runs == 1);
+ assert_true(stats.features == 2);
+ assert_true(stats.corpus_size == 1);
+ count = scandir(dir, &entries, NULL, alphasort);
+ assert_true(count == 2 + 1);
+ for (int i = 0; i < count; i++) {
+  free((void *)entries[i]);
+ }
+ free((void *)entries);
+ fuzz_set_corpus(NULL);
+ remove_tree(seeded);
+}
+
+int main(void) {
+ __sanitizer_cov_trace_pc_guard_init(guards, guards + 4);
+ test__fuzz__replay();
+ test__fuzz__run();
+
+ return 0;
+}
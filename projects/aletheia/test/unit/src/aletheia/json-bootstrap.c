@@ -0,0 +1,138 @@
+/*this file contains tests for the aletheia Google Benchmark compatible JSON
+ *writer; do not use the definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <aletheia/bench.h>
+#include <aletheia/json.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+
+ printf(
+  "error assertion failed on line %d: `%s`\nerror:\n%s\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//utility function; reads all of `file` into an allocated string
+static char * read_all(FILE * file) {
+ long const length = ftell(file);
+ rewind(file);
+ char * buffer = calloc((size_t)length + 1, 1);
+ assert_true(buffer != NULL);
+ assert_true(fread(buffer, 1, (size_t)length, file) == (size_t)length);
+ return buffer;
+}
+
+//utility function; number of occurrences of `needle` in `haystack`
+static size_t count_occurrences(char const * haystack, char const * needle) {
+ size_t count = 0;
+ for (char const * at = strstr(haystack, needle); at; at = strstr(at + 1, needle)) {
+  count++;
+ }
+ return count;
+}
+
+//benchmark callbacks
+static void counted_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ uint64_t volatile sum = 0;
+ while (bench_state_keep_running(&state)) {
+  sum += 1;
+ }
+ bench_state_set_counter(&state, "items", (double)bench_state_get_iterations(&state));
+}
+
+static void incomplete_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ bench_state_keep_running(&state);
+}
+
+static bench_runner_config_t const quick_config = {
+ .min_time_ns = UINT64_C(1000000),
+ .warmup_time_ns = UINT64_C(100000),
+ .repetitions = 3
+};
+
+static void test__bench_json_write(void) {
+ bench_suite_t suite;
+ assert_no_error(bench_suite_new(&suite));
+
+ bench_t bench;
+ assert_no_error(bench_new(&bench, "counted \"quoted\"", counted_bench));
+ bench_arg_range_t const ranges[] = {BENCH_LIST(1, 2)};
+ assert_no_error(bench_suite_add_args(&suite, &bench, 1, ranges));
+ bench_free(&bench);
+ assert_no_error(bench_new(&bench, "incomplete", incomplete_bench));
+ assert_no_error(bench_suite_add(&suite, &bench));
+ bench_free(&bench);
+ assert_true(bench_suite_run_and_emit(&suite, quick_config) == 1);
+
+ FILE * file = tmpfile();
+ assert_true(file != NULL);
+ assert_no_error(bench_json_write(&suite, file, "./bench"));
+ char * json = read_all(file);
+ fclose(file);
+
+ //context block
+ assert_true(strncmp(json, "{\n \"context\": {", 15) == 0);
+ assert_true(strstr(json, "\"executable\": \"./bench\"") != NULL);
+ assert_true(strstr(json, "\"num_cpus\": ") != NULL);
+ assert_true(strstr(json, "\"caches\": [") != NULL);
+
+ //3 repetitions of 2 instances, plus 4 aggregates each, plus 1 errored run
+ assert_true(count_occurrences(json, "\"run_type\": \"iteration\"") == 7);
+ assert_true(count_occurrences(json, "\"run_type\": \"aggregate\"") == 8);
+ assert_true(count_occurrences(json, "\"error_occurred\": true") == 1);
+ assert_true(count_occurrences(json, "\"items\": ") == 14);
+
+ //names are escaped, instances share their family
+ assert_true(strstr(json, "\"name\": \"counted \\\"quoted\\\"/2_median\"") != NULL);
+ assert_true(count_occurrences(json, "\"family_index\": 0") == 14);
+ assert_true(count_occurrences(json, "\"family_index\": 1") == 1);
+ assert_true(count_occurrences(json, "\"per_family_instance_index\": 1") == 7);
+
+ //every object is closed
+ assert_true(count_occurrences(json, "{") == count_occurrences(json, "}"));
+ assert_true(count_occurrences(json, "[") == count_occurrences(json, "]"));
+
+ free((void *)json);
+ bench_suite_free(&suite);
+}
+
+int main(void) {
+ test__bench_json_write();
+ return 0;
+}
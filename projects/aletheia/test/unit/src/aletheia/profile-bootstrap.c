@@ -0,0 +1,193 @@
+/*this file contains tests for the aletheia sampling profiler; do not use the
+ *definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include <aletheia/test.h>
+#include <aletheia/profile.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+ printf(
+  "error assertion failed on line %d: `%s` returned error: `%s`\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//CPU time to burn while sampling
+#define SPIN_CLOCKS (CLOCKS_PER_SEC / 5)
+
+//utility function; writes the folded stacks of `profile` into an allocated
+//string
+static char * write_profile(profile_t * profile) {
+ FILE * file = tmpfile();
+ assert_true(file != NULL);
+ assert_no_error(profile_write_folded(profile, file));
+ long const length = ftell(file);
+ rewind(file);
+ char * result = calloc((size_t)length + 1, 1);
+ assert_true(fread(result, 1, (size_t)length, file) == (size_t)length);
+ fclose(file);
+ return result;
+}
+
+//utility function; sum of the counts of all lines whose stack starts with
+//`tag`
+static size_t samples_of(char const * folded, char const * tag) {
+ size_t const length = strlen(tag);
+ size_t count = 0;
+ for (char const * line = folded; *line;) {
+  char const * end = strchr(line, '\n');
+  if (strncmp(line, tag, length) == 0 && line[length] == ';') {
+   char const * space = end - 1;
+   while (*space != ' ') {
+    space--;
+   }
+   count += strtoul(space + 1, NULL, 10);
+  }
+  line = end + 1;
+ }
+ return count;
+}
+
+static void spin(void) {
+ clock_t const start = clock();
+ while (clock() - start < SPIN_CLOCKS) {}
+}
+
+static void test__profile__samples(void) {
+ profile_t profile;
+ assert_true(profile_new(&profile, 0, 1000) != NULL);
+ assert_true(profile == NULL);
+ assert_no_error(profile_new(&profile, PROFILE_DEFAULT_CAPACITY, 1000));
+
+ //only one profile may run at once
+ profile_t other;
+ assert_no_error(profile_new(&other, 16, 1000));
+ assert_no_error(profile_start(&profile));
+ assert_true(profile_start(&other) != NULL);
+ profile_free(&other);
+
+ profile_set_tag(&profile, "spinning");
+ spin();
+ profile_set_tag(&profile, NULL);
+ spin();
+ profile_stop(&profile);
+
+ //both phases were sampled, nothing was dropped
+ size_t dropped = 1;
+ size_t const count = profile_get_sample_count(&profile, &dropped);
+ assert_true(dropped == 0);
+ char * folded = write_profile(&profile);
+ size_t const spinning = samples_of(folded, "spinning");
+ size_t const untagged = samples_of(folded, "[untagged]");
+ assert_true(spinning >= 10);
+ assert_true(untagged >= 10);
+ assert_true(spinning + untagged == count);
+ free((void *)folded);
+
+ //stopped profiles take no samples
+ spin();
+ assert_true(profile_get_sample_count(&profile, &dropped) == count);
+ profile_free(&profile);
+ assert_true(profile == NULL);
+
+ //tagging no profile does nothing
+ profile_set_tag(&profile, "ignored");
+}
+
+static void test__profile__overflow(void) {
+ profile_t profile;
+ assert_no_error(profile_new(&profile, 4, 1000));
+ assert_no_error(profile_start(&profile));
+ profile_set_tag(&profile, "spinning");
+ spin();
+ profile_stop(&profile);
+
+ //samples beyond the capacity are counted, but not kept
+ size_t dropped = 0;
+ size_t const count = profile_get_sample_count(&profile, &dropped);
+ assert_true(count > 4);
+ assert_true(dropped == count - 4);
+ char * folded = write_profile(&profile);
+ assert_true(samples_of(folded, "spinning") == 4);
+ free((void *)folded);
+ profile_free(&profile);
+}
+
+static void spin_callback(test_t test, void * ctx) {
+ (void)ctx;
+ spin();
+ test_ok(&test);
+}
+
+static void spin_hook(test_runner_setup_t setup) {
+ (void)setup;
+ spin();
+}
+
+static void test__profile__test_run(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "spinning test", spin_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.before_all = spin_hook;
+ assert_no_error(profile_new(&config.profile, PROFILE_DEFAULT_CAPACITY, 1000));
+ assert_no_error(profile_start(&config.profile));
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 0);
+ profile_stop(&config.profile);
+
+ //samples are attributed to the test and the hook they were taken in
+ char * folded = write_profile(&config.profile);
+ assert_true(samples_of(folded, "spinning test") >= 10);
+ assert_true(samples_of(folded, "before_all") >= 10);
+ assert_true(samples_of(folded, "after_all") == 0);
+ free((void *)folded);
+
+ profile_free(&config.profile);
+ test_suite_free(&test_suite);
+}
+
+int main(void) {
+ test__profile__samples();
+ test__profile__overflow();
+ test__profile__test_run();
+
+ return 0;
+}
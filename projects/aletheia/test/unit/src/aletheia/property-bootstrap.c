@@ -0,0 +1,206 @@
+/*this file contains tests for aletheia property tests; do not use the
+ *definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <aletheia/test.h>
+#include <aletheia/property.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+ printf(
+  "error assertion failed on line %d: `%s` returned error: `%s`\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//config shared by the test callbacks below
+static property_config_t config;
+
+//utility function; runs `callback` as the only test of a suite and returns
+//the causes of its failures, joined by newlines
+static char * run_property_test(test_callback_t * callback) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "property test", callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ test_suite_run_and_emit(&test_suite, TEST_RUNNER_DEFAULT);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ test_failure_t * failures;
+ size_t failure_count;
+ assert_no_error(test_get_failures(&tests[0], &failure_count, &failures));
+ size_t length = 1;
+ for (size_t i = 0; i < failure_count; i++) {
+  length += strlen(failures[i].cause) + 1;
+ }
+ char * causes = calloc(length, 1);
+ for (size_t i = 0; i < failure_count; i++) {
+  strcat(causes, failures[i].cause);
+  strcat(causes, "\n");
+ }
+ test_failures_free(&failure_count, &failures);
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+ test_suite_free(&test_suite);
+ return causes;
+}
+
+//generated values respect their bounds
+static size_t cases_run;
+
+static void bounds_property(test_t test, property_t property, void * ctx) {
+ (void)ctx;
+ __atomic_add_fetch(&cases_run, 1, __ATOMIC_RELAXED);
+ test_expect_true(property_uint(&property, 10) <= 10);
+ int64_t const value = property_int(&property, -5, 3);
+ test_expect_true(value >= -5 && value <= 3);
+ test_expect_true(property_int(&property, 7, 9) >= 7);
+ test_expect_true(property_int(&property, INT64_MIN, INT64_MAX) <= INT64_MAX);
+ size_t length;
+ property_bytes(&property, 4, &length);
+ test_expect_true(length <= 4);
+ test_expect_true(strlen(property_string(&property, 100)) <= 100);
+ int64_t const * values = property_int_array(&property, 200, -2, 2, &length);
+ test_expect_true(length <= 200);
+ for (size_t i = 0; i < length; i++) {
+  test_expect_true(values[i] >= -2 && values[i] <= 2);
+ }
+ property_bool(&property);
+}
+
+static void bounds_callback(test_t test, void * ctx) {
+ test_expect_property_with(config, bounds_property, ctx);
+ test_ok(&test);
+}
+
+static void test__property__bounds(void) {
+ //every case runs once, on any number of workers
+ size_t const workers[] = {1, 4};
+ for (size_t i = 0; i < 2; i++) {
+  config = PROPERTY_DEFAULT;
+  config.cases = 500;
+  config.workers = workers[i];
+  cases_run = 0;
+  char * causes = run_property_test(bounds_callback);
+  assert_true(strcmp(causes, "") == 0);
+  assert_true(cases_run == 500);
+  free((void *)causes);
+ }
+}
+
+//failing properties are shrunk to their smallest counterexample
+static void sum_property(test_t test, property_t property, void * ctx) {
+ (void)ctx;
+ size_t length;
+ int64_t const * values = property_int_array(&property, 50, 0, 1000, &length);
+ int64_t sum = 0;
+ for (size_t i = 0; i < length; i++) {
+  sum += values[i];
+ }
+ test_expect_true(sum < 100);
+}
+
+static void sum_callback(test_t test, void * ctx) {
+ test_assert_property_with(config, sum_property, ctx);
+ test_ok(&test);
+}
+
+static void magnitude_property(test_t test, property_t property, void * ctx) {
+ (void)ctx;
+ int64_t const value = property_int(&property, -1000, 1000);
+ test_expect_true(value > -10 && value < 10);
+}
+
+static void magnitude_callback(test_t test, void * ctx) {
+ test_expect_property_with(config, magnitude_property, ctx);
+ test_ok(&test);
+}
+
+static void string_property(test_t test, property_t property, void * ctx) {
+ (void)ctx;
+ test_expect_true(strchr(property_string(&property, 20), 'z') == NULL);
+}
+
+static void string_callback(test_t test, void * ctx) {
+ test_expect_property_with(config, string_property, ctx);
+ test_ok(&test);
+}
+
+static void test__property__shrinking(void) {
+ config = PROPERTY_DEFAULT;
+ config.seed = 42;
+ config.workers = 2;
+ char * causes = run_property_test(sum_callback);
+ assert_true(strstr(causes, "Property 'sum_property' failed for seed ") != NULL);
+ assert_true(strstr(causes, "with counterexample ([100]): Expected value of 'sum < 100'") != NULL);
+
+ //the same seed finds and shrinks the same counterexample
+ char * again = run_property_test(sum_callback);
+ assert_true(strcmp(causes, again) == 0);
+ free((void *)again);
+
+ //the reported seed reproduces the counterexample as first case
+ char const * seed = strstr(causes, "seed ") + 5;
+ config.seed = strtoull(seed, NULL, 10);
+ config.cases = 1;
+ again = run_property_test(sum_callback);
+ assert_true(strstr(again, "(case 1 of 1, ") != NULL);
+ assert_true(strstr(again, "with counterexample ([100])") != NULL);
+ free((void *)again);
+ free((void *)causes);
+
+ //integers shrink towards zero, strings towards short strings of 'a'
+ config = PROPERTY_DEFAULT;
+ config.seed = 7;
+ causes = run_property_test(magnitude_callback);
+ assert_true(strstr(causes, "with counterexample (-10)") != NULL);
+ free((void *)causes);
+ causes = run_property_test(string_callback);
+ assert_true(strstr(causes, "with counterexample (\"z\")") != NULL);
+ free((void *)causes);
+}
+
+int main(void) {
+ test__property__bounds();
+ test__property__shrinking();
+
+ return 0;
+}
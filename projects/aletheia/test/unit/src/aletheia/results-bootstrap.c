@@ -0,0 +1,190 @@
+/*this file contains tests for the aletheia result file reader and writer; do
+ *not use the definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <aletheia/test.h>
+#include <aletheia/results.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+
+ printf(
+  "error assertion failed on line %d: `%s`\nerror:\n%s\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//test callbacks
+static void ok_callback(test_t test, void * ctx) {
+ (void)ctx;
+ test_ok(&test);
+}
+
+static void fail_callback(test_t test, void * ctx) {
+ (void)ctx;
+ printf("some\toutput\n");
+ assert_no_error(test_push_failure(&test, "some\tfile", 12, "line 1\nline 2"));
+}
+
+static void opt_fail_callback(test_t test, void * ctx) {
+ (void)ctx;
+ assert_no_error(test_push_opt_failure(&test, NULL, 0, "not fatal"));
+}
+
+//result file tests
+static void test__results__escape(void) {
+ char * escaped = test_results_escape("a\tb\nc\\d");
+ assert_true(strcmp(escaped, "a\\tb\\nc\\\\d") == 0);
+ free((void *)escaped);
+}
+
+static void test__results__round_trip(void) {
+ //construct and run test suite
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "zzz", ok_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ assert_no_error(test_new(&test, "aaa", fail_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.capture_output = true;
+ test_suite_run_and_emit(&test_suite, config);
+
+ //write results
+ FILE * file = tmpfile();
+ assert_true(file != NULL);
+ assert_no_error(test_results_write(&test_suite, file));
+ rewind(file);
+
+ //read results back; records must be sorted by name
+ test_results_reader_t reader;
+ test_results_record_t record;
+ bool done = false;
+ assert_no_error(test_results_reader_new(&reader, file));
+
+ assert_no_error(test_results_reader_next(&reader, &record, &done));
+ assert_true(!done);
+ assert_true(record.field_count == 4);
+ assert_true(strcmp(record.fields[0], "test") == 0);
+ assert_true(strcmp(record.fields[1], "aaa") == 0);
+ assert_true(test_results_status_parse(record.fields[2]) == TEST_FAIL);
+ assert_true(strstr(record.text, "\tfailure\t1\t12\tsome\\tfile\tline 1\\nline 2\n") != NULL);
+ assert_true(strstr(record.text, "\toutput\tsome\\toutput\\n\n") != NULL);
+ test_results_record_free(&record);
+
+ assert_no_error(test_results_reader_next(&reader, &record, &done));
+ assert_true(!done);
+ assert_true(strcmp(record.fields[1], "zzz") == 0);
+ assert_true(test_results_status_parse(record.fields[2]) == TEST_OK);
+ //only phases that ran are written
+ assert_true(strstr(record.text, "\tusage\ttest\twall-ns=") != NULL);
+ assert_true(strstr(record.text, "\tusage\tbefore-each\t") == NULL);
+ //output of passing tests is discarded
+ assert_true(strstr(record.text, "\toutput\t") == NULL);
+ test_results_record_free(&record);
+
+ assert_no_error(test_results_reader_next(&reader, &record, &done));
+ assert_true(done);
+
+ //clean up
+ test_results_reader_free(&reader);
+ fclose(file);
+ test_suite_free(&test_suite);
+}
+
+static void test__results__failed(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "budget", ok_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ assert_no_error(test_new(&test, "fail", fail_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ assert_no_error(test_new(&test, "opt", opt_fail_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ //every test overruns its budget; only the two failing ones fail the run
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.test_budget_ns = 1;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 2);
+
+ FILE * file = tmpfile();
+ assert_true(file != NULL);
+ assert_no_error(test_results_write(&test_suite, file));
+ rewind(file);
+ test_results_reader_t reader;
+ test_results_record_t record;
+ bool done = false;
+ assert_no_error(test_results_reader_new(&reader, file));
+
+ //records are sorted by name: "budget", "fail", "opt"
+ bool const failed[] = {false, true, true};
+ for (size_t i = 0; i < 3; i++) {
+  assert_no_error(test_results_reader_next(&reader, &record, &done));
+  assert_true(!done);
+  assert_true(strstr(record.text, TEST_BUDGET_CAUSE) != NULL);
+  assert_true(test_results_record_failed(&record) == failed[i]);
+  test_results_record_free(&record);
+ }
+
+ test_results_reader_free(&reader);
+ fclose(file);
+ test_suite_free(&test_suite);
+}
+
+static void test__results__reject_invalid_header(void) {
+ FILE * file = tmpfile();
+ assert_true(file != NULL);
+ fputs("not a result file\n", file);
+ rewind(file);
+
+ test_results_reader_t reader;
+ assert_true(test_results_reader_new(&reader, file) != NULL);
+ fclose(file);
+}
+
+int main(void) {
+ test__results__escape();
+ test__results__round_trip();
+ test__results__failed();
+ test__results__reject_invalid_header();
+
+ return 0;
+}
@@ -6,8 +6,11 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include <pthread.h>
+
 #include <aletheia/test.h>
 #include <aletheia/util/string.h>
+#include <aletheia/util/time.h>
 
 //utility assert functions
 static void assert_no_error_impl(
@@ -1621,6 +1624,423 @@ static void test__test_suite_t__pop_test_ctx_after_all(void) {
 
 //TODO: utility function tests
 
+//benchmark callbacks for budget tests
+static void fast_budget_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ size_t volatile sum = 0;
+ while (bench_state_keep_running(&state)) {
+  sum += 1;
+ }
+}
+
+static void slow_budget_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  uint64_t const start = time_now_ns();
+  while (time_now_ns() - start < 20000) {}
+ }
+}
+
+//reports allocations the way an interposer would
+static void alloc_budget_bench(bench_state_t state, void * ctx) {
+ (void)ctx;
+ while (bench_state_keep_running(&state)) {
+  alloc_tracking_on_alloc(48, 48);
+  alloc_tracking_on_free(48);
+ }
+}
+
+static void global_test_budget_callback(test_t test, void * ctx) {
+ (void)ctx;
+ //counted towards the test, unlike the measured allocations below
+ alloc_tracking_on_alloc(8, 8);
+
+ test_expect_time_below(1e9, fast_budget_bench, NULL);
+ test_expect_time_below(1000, slow_budget_bench, NULL);
+ test_expect_allocs_at_most(1, alloc_budget_bench, NULL);
+ test_expect_allocs_at_most(0, alloc_budget_bench, NULL);
+ test_assert_bytes_at_most(32, alloc_budget_bench, NULL);
+ test_ok(&test);
+}
+
+static void test__test_suite_t__run_test_with_budgets(void) {
+ //construct test suite
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "budget test", global_test_budget_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ //run test suite
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.alloc_tracking = true;
+ assert_true(test_suite_run_and_emit(&test_suite, config) > 0);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_true(test_count == 1);
+ enum test_status_t status = 0;
+ test_get_status(&tests[0], &status);
+ assert_true(status == TEST_FAIL);
+
+ //budget measurements do not count towards the test
+ alloc_stats_t allocs;
+ assert_no_error(test_get_alloc_stats(&tests[0], &allocs));
+ assert_true(allocs.allocs == 1);
+ assert_true(allocs.bytes == 8);
+
+ //expectations are optional failures, the assertion stops the test
+ test_failure_t * failures;
+ size_t failure_count;
+ assert_no_error(test_get_failures(&tests[0], &failure_count, &failures));
+ assert_true(failure_count == 3);
+ assert_true(!failures[0].fatal);
+ assert_true(strstr(failures[0].cause, "slow_budget_bench") != NULL);
+ assert_true(strstr(failures[0].cause, "ns/iter") != NULL);
+ assert_true(!failures[1].fatal);
+ assert_true(strstr(failures[1].cause, "allocate at most 0 allocs/iter, but it allocated 1!") != NULL);
+ assert_true(failures[2].fatal);
+ assert_true(strstr(failures[2].cause, "request at most 32 bytes/iter, but it requested 48!") != NULL);
+ test_failures_free(&failure_count, &failures);
+ test_free(&tests[0]);
+ free((void *)tests);
+
+ test_suite_free(&test_suite);
+}
+
+//wall time spent by `spin_callback` and `spin_before_each_callback`
+#define SPIN_NS UINT64_C(2000000)
+#define TOUCHED_BYTES (4 * 1024 * 1024)
+
+static void spin(void) {
+ uint64_t const start = time_now_ns();
+ while (time_now_ns() - start < SPIN_NS) {}
+}
+
+static void spin_callback(test_t test, void * ctx) {
+ (void)ctx;
+ spin();
+ //touching fresh memory faults its pages in
+ char * volatile memory = malloc(TOUCHED_BYTES);
+ memset(memory, 1, TOUCHED_BYTES);
+ free((void *)memory);
+ test_ok(&test);
+}
+
+static void spin_before_each_callback(test_runner_setup_t setup) {
+ (void)setup;
+ spin();
+}
+
+static void test__test_suite_t__run_test_usage(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "usage test", spin_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.before_each = spin_before_each_callback;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 0);
+
+ //hooks that were not configured report nothing
+ test_suite_usage_t suite_usage;
+ assert_no_error(test_suite_get_usage(&test_suite, &suite_usage));
+ assert_true(!usage_any(&suite_usage.before_all));
+ assert_true(!usage_any(&suite_usage.after_all));
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_true(test_count == 1);
+ test_usage_t usage;
+ assert_no_error(test_get_usage(&tests[0], &usage));
+ assert_true(usage.before_each.wall_ns >= SPIN_NS);
+ assert_true(usage.test.wall_ns >= SPIN_NS);
+ assert_true(usage.test.minor_faults > 0);
+ assert_true(!usage_any(&usage.after_each));
+ test_free(&tests[0]);
+ free((void *)tests);
+
+ test_suite_free(&test_suite);
+}
+
+static void quick_callback(test_t test, void * ctx) {
+ (void)ctx;
+ test_ok(&test);
+}
+
+static void test__test_suite_t__run_tests_with_budgets(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "quick test", quick_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ assert_no_error(test_new(&test, "slow test", spin_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ //the slow test exceeds both budgets, but the run still succeeds
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.test_budget_ns = SPIN_NS / 2;
+ config.suite_budget_ns = SPIN_NS / 2;
+ config.slowest_count = 2;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 0);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_true(test_count == 2);
+ enum test_status_t status = 0;
+ test_get_status(&tests[0], &status);
+ assert_true(status == TEST_OK);
+ test_get_status(&tests[1], &status);
+ assert_true(status == TEST_OK_OTHER_FAIL);
+
+ test_failure_t * failures;
+ size_t failure_count;
+ assert_no_error(test_get_failures(&tests[1], &failure_count, &failures));
+ assert_true(failure_count == 2);
+ assert_true(!failures[0].fatal && !failures[1].fatal);
+ assert_true(strstr(failures[0].cause, "exceeding its time budget of 1.000 ms!") != NULL);
+ assert_true(strstr(failures[1].cause, "Suite has run for") != NULL);
+ test_failures_free(&failure_count, &failures);
+
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+ test_suite_free(&test_suite);
+}
+
+//fake blocks reported the way an interposer would
+static int leaked_block, kept_block, leak_site;
+
+static void leaking_before_each_callback(test_runner_setup_t setup) {
+ (void)setup;
+ alloc_leaks_on_alloc(&kept_block, 16, NULL);
+}
+
+static void leaking_callback(test_t test, void * ctx) {
+ (void)ctx;
+ alloc_leaks_on_free(&kept_block);
+ alloc_leaks_on_alloc(&leaked_block, 24, &leak_site);
+ test_ok(&test);
+}
+
+static void balanced_callback(test_t test, void * ctx) {
+ (void)ctx;
+ alloc_leaks_on_free(&kept_block);
+ test_ok(&test);
+}
+
+static void test__test_suite_t__run_tests_with_leak_check(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "leaking test", leaking_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ assert_no_error(test_new(&test, "balanced test", balanced_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.before_each = leaking_before_each_callback;
+ config.leak_check = true;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 1);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_true(test_count == 2);
+ enum test_status_t status = 0;
+ test_get_status(&tests[0], &status);
+ assert_true(status == TEST_FAIL);
+ test_get_status(&tests[1], &status);
+ assert_true(status == TEST_OK);
+
+ //the leak is reported with its size and allocation site
+ test_failure_t * failures;
+ size_t failure_count;
+ assert_no_error(test_get_failures(&tests[0], &failure_count, &failures));
+ assert_true(failure_count == 1);
+ assert_true(failures[0].fatal);
+ char * expected = string_format(
+  "Leaked 1 block(s): 24 bytes allocated at %p",
+  (void *)&leak_site
+ );
+ assert_true(strcmp(failures[0].cause, expected) == 0);
+ free((void *)expected);
+ test_failures_free(&failure_count, &failures);
+
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+ test_suite_free(&test_suite);
+}
+
+//single assertion site, evaluated 10 times with 3 failures per call
+static void site_assertions(test_t test) {
+ for (size_t i = 0; i < 10; i++) {
+  test_expect_true(i < 7);
+ }
+}
+
+static void site_callback(test_t test, void * ctx) {
+ (void)ctx;
+ site_assertions(test);
+}
+
+static void * site_thread(void * arg) {
+ (void)arg;
+ test_t test;
+ assert_no_error(test_new(&test, "site thread", site_callback));
+ site_assertions(test);
+ test_free(&test);
+ return NULL;
+}
+
+//utility function; counters of the site in `site_assertions`
+static test_site_stats_t site_stats_of(char const * identifier_name) {
+ test_site_stats_t stats[64];
+ size_t const count = test_sites_get_stats(stats, 64);
+ assert_true(count <= 64);
+ for (size_t i = 0; i < count; i++) {
+  if (strcmp(stats[i].site->identifier_name, identifier_name) == 0) {
+   return stats[i];
+  }
+ }
+ assert_true(false);
+ return stats[0];
+}
+
+static void test__test_suite_t__run_tests_with_site_counters(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "site test", site_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ //counters are zeroed when the run starts
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.site_report_count = 2;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 1);
+ test_site_stats_t stats = site_stats_of("i < 7");
+ assert_true(strstr(stats.site->file, "test-bootstrap.c") != NULL);
+ assert_true(stats.evaluations == 10);
+ assert_true(stats.failures == 3);
+
+ //every thread counts on its own, reports sum them up
+ pthread_t thread;
+ assert_true(pthread_create(&thread, NULL, site_thread, NULL) == 0);
+ assert_true(pthread_join(thread, NULL) == 0);
+ stats = site_stats_of("i < 7");
+ assert_true(stats.evaluations == 20);
+ assert_true(stats.failures == 6);
+
+ //counters of exited threads are handed on with their counts
+ for (size_t i = 0; i < 16; i++) {
+  assert_true(pthread_create(&thread, NULL, site_thread, NULL) == 0);
+  assert_true(pthread_join(thread, NULL) == 0);
+ }
+ stats = site_stats_of("i < 7");
+ assert_true(stats.evaluations == 20 + 16 * 10);
+ assert_true(stats.failures == 6 + 16 * 3);
+
+ test_sites_reset();
+ stats = site_stats_of("i < 7");
+ assert_true(stats.evaluations == 0);
+ assert_true(stats.failures == 0);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+ test_suite_free(&test_suite);
+}
+
+static void chatty_callback(test_t test, void * ctx) {
+ (void)ctx;
+ printf("passing chatter\n");
+ test_ok(&test);
+}
+
+static void chatty_failing_callback(test_t test, void * ctx) {
+ (void)ctx;
+ printf("failing chatter\n");
+ fprintf(stderr, "failing error");
+ test_push_failure(&test, __FILE__, __LINE__, "fails");
+}
+
+static void chatty_before_each_callback(test_runner_setup_t setup) {
+ (void)setup;
+ printf("before each\n");
+}
+
+static void test__test_suite_t__run_tests_with_output_capture(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "chatty test", chatty_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+ assert_no_error(test_new(&test, "chatty failing test", chatty_failing_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ //only the output of the failing test is kept, hooks included
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.before_each = chatty_before_each_callback;
+ config.capture_output = true;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 1);
+
+ test_t * tests;
+ size_t test_count;
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_true(test_count == 2);
+ char const * output = NULL;
+ assert_no_error(test_get_output(&tests[0], &output));
+ assert_true(output == NULL);
+ assert_no_error(test_get_output(&tests[1], &output));
+ //`stdout` may be fully buffered, so only its own order is known
+ assert_true(strstr(output, "before each\nfailing chatter\n") != NULL);
+ assert_true(strstr(output, "failing error") != NULL);
+
+ //copies keep the output
+ test_t copy;
+ assert_no_error(test_copy(&tests[1], &copy));
+ char const * copied_output = NULL;
+ assert_no_error(test_get_output(&copy, &copied_output));
+ assert_true(strcmp(copied_output, output) == 0);
+ test_free(&copy);
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+
+ //on request, the output of passing tests is kept too
+ config.keep_output = true;
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 1);
+ assert_no_error(test_suite_get_tests(&test_suite, &test_count, &tests));
+ assert_no_error(test_get_output(&tests[0], &output));
+ assert_true(strcmp(output, "before each\npassing chatter\n") == 0);
+ for (size_t i = 0; i < test_count; i++) {
+  test_free(&tests[i]);
+ }
+ free((void *)tests);
+ test_suite_free(&test_suite);
+}
+
 int main(void) {
  //initialize test globals
  zero_test_globals();
@@ -1660,6 +2080,12 @@ int main(void) {
  test__test_suite_t__run_test_with_failure();
  test__test_suite_t__run_test_with_opt_failure();
  test__test_suite_t__run_tests_with_mixed_failures();
+ test__test_suite_t__run_test_with_budgets();
+ test__test_suite_t__run_test_usage();
+ test__test_suite_t__run_tests_with_budgets();
+ test__test_suite_t__run_tests_with_leak_check();
+ test__test_suite_t__run_tests_with_site_counters();
+ test__test_suite_t__run_tests_with_output_capture();
 
  //TODO: test expr tests
 
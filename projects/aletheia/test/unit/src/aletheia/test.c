@@ -3,7 +3,10 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <aletheia/test.h>
+#include <aletheia/property.h>
+#include <aletheia/fuzz.h>
 
 static void test__example(test_t test, void * ctx) {
  (void)test;
@@ -15,8 +18,124 @@ static void test__example(test_t test, void * ctx) {
  test_ok(&test);
 }
 
+static void bench__example(bench_state_t state, void * ctx) {
+ (void)ctx;
+ size_t volatile sum = 0;
+ while (bench_state_keep_running(&state)) {
+  sum += 1;
+ }
+}
+
+static void bench__example_sum(bench_state_t state, void * ctx) {
+ (void)ctx;
+ size_t const n = (size_t)bench_state_get_arg(&state, 0);
+ size_t volatile sum = 0;
+ while (bench_state_keep_running(&state)) {
+  for (size_t i = 0; i < n; i++) {
+   sum += i;
+  }
+ }
+ bench_state_set_counter(&state, "elements", (double)n);
+}
+
+static void bench__example_threads(bench_state_t state, void * ctx) {
+ (void)ctx;
+ static size_t shared = 0;
+ while (bench_state_keep_running(&state)) {
+  __atomic_add_fetch(&shared, 1, __ATOMIC_RELAXED);
+ }
+}
+
+static void bench__example_paused(bench_state_t state, void * ctx) {
+ (void)ctx;
+ size_t buffer[64];
+ while (bench_state_keep_running(&state)) {
+  //refilling the buffer is not part of the measurement
+  bench_state_pause_timing(&state);
+  for (size_t i = 0; i < 64; i++) {
+   buffer[i] = 64 - i;
+  }
+  bench_state_resume_timing(&state);
+  for (size_t i = 0; i < 32; i++) {
+   size_t const swap = buffer[i];
+   buffer[i] = buffer[63 - i];
+   buffer[63 - i] = swap;
+  }
+ }
+ size_t volatile sink = buffer[0];
+ (void)sink;
+}
+
+static void bench__example_copy_loop(bench_state_t state, void * ctx) {
+ (void)ctx;
+ char source[256] = {0}, destination[256];
+ while (bench_state_keep_running(&state)) {
+  for (size_t i = 0; i < sizeof(source); i++) {
+   destination[i] = source[i];
+  }
+  BENCH_ESCAPE(destination);
+ }
+}
+
+static void bench__example_copy_memcpy(bench_state_t state, void * ctx) {
+ (void)ctx;
+ char source[256] = {0}, destination[256];
+ while (bench_state_keep_running(&state)) {
+  memcpy(destination, source, sizeof(source));
+  BENCH_ESCAPE(destination);
+ }
+}
+
+static void test__example_budget(test_t test, void * ctx) {
+ (void)ctx;
+ //generous, so that only pathological slowdowns fail
+ test_expect_time_below(1000000, bench__example_copy_memcpy, NULL);
+ test_ok(&test);
+}
+
+static void property__example_reverse(test_t test, property_t property, void * ctx) {
+ (void)ctx;
+ char const * value = property_string(&property, 64);
+ size_t const length = strlen(value);
+ char reversed[65];
+ for (size_t i = 0; i < length; i++) {
+  reversed[i] = value[length - 1 - i];
+ }
+ reversed[length] = '\0';
+ //reversing twice gives back the original
+ for (size_t i = 0; i < length; i++) {
+  test_assert_true(reversed[length - 1 - i] == value[i]);
+ }
+}
+
+static void test__example_property(test_t test, void * ctx) {
+ test_expect_property(property__example_reverse, ctx);
+ test_ok(&test);
+}
+
+//replayed from `--fuzz-corpus`, or fuzzed with `--fuzz fuzz__example_decimal`
+FUZZ_TARGET(fuzz__example_decimal) {
+ //a decimal number of up to 9 digits prints back unchanged, without leading zeros
+ uint64_t value = 0;
+ size_t digits = 0;
+ while (digits < size && digits < 9 && data[digits] >= '0' && data[digits] <= '9') {
+  value = value * 10 + (uint64_t)(data[digits++] - '0');
+ }
+ char printed[16];
+ int const length = snprintf(printed, sizeof(printed), "%llu", (unsigned long long)value);
+ test_expect_true(!digits || data[0] == '0' || (size_t)length == digits);
+}
+
 TEST_SUITE() {
  //for (size_t i = 0; i < 100; i++) {
   TEST(test__example);
  //}
+ TEST(test__example_budget);
+ TEST(test__example_property);
+ FUZZ(fuzz__example_decimal);
+ BENCH(bench__example);
+ BENCH_ARGS(bench__example_sum, BENCH_RANGE(8, 4096, 8), BENCH_LIST(1, 2));
+ BENCH_THREADS(bench__example_threads, 1, 2, 4);
+ BENCH(bench__example_paused);
+ BENCH_COMPARE(bench__example_copy, bench__example_copy_loop, bench__example_copy_memcpy);
 }
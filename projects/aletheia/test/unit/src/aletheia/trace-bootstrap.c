@@ -0,0 +1,180 @@
+/*this file contains tests for the aletheia trace writer; do not use the
+ *definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include <aletheia/test.h>
+#include <aletheia/trace.h>
+
+//utility assert functions
+static void assert_no_error_impl(
+ char const * error,
+ char const * expr,
+ int line
+) {
+ if (!error) {
+  return;
+ }
+ printf(
+  "error assertion failed on line %d: `%s` returned error: `%s`\n",
+  line,
+  expr,
+  error
+ );
+ exit(-1);
+}
+
+#define assert_no_error(expr) \
+assert_no_error_impl(expr, #expr, __LINE__)
+
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//utility function; writes `trace` into an allocated string
+static char * write_trace(trace_t * trace) {
+ FILE * file = tmpfile();
+ assert_true(file != NULL);
+ assert_no_error(trace_write(trace, file));
+ long const length = ftell(file);
+ rewind(file);
+ char * result = calloc((size_t)length + 1, 1);
+ assert_true(fread(result, 1, (size_t)length, file) == (size_t)length);
+ fclose(file);
+ return result;
+}
+
+//utility function; number of occurrences of `needle` in `haystack`
+static size_t count_of(char const * haystack, char const * needle) {
+ size_t count = 0;
+ for (char const * at = strstr(haystack, needle); at; at = strstr(at + 1, needle)) {
+  count++;
+ }
+ return count;
+}
+
+static void test__trace__events(void) {
+ trace_t trace;
+ assert_no_error(trace_new(&trace, 16));
+ trace_begin(&trace, "outer", "test");
+ trace_begin(&trace, "in\"ner", "hook");
+ trace_end(&trace, "in\"ner", "hook");
+ trace_end(&trace, "outer", "test");
+
+ char * json = write_trace(&trace);
+ assert_true(strncmp(json, "{\"traceEvents\": [", 17) == 0);
+ assert_true(strstr(json, "{\"name\": \"outer\", \"cat\": \"test\", \"ph\": \"B\"") != NULL);
+ assert_true(strstr(json, "{\"name\": \"in\\\"ner\", \"cat\": \"hook\", \"ph\": \"E\"") != NULL);
+ assert_true(count_of(json, "\"tid\": 1}") == 4);
+ assert_true(strstr(json, "\"displayTimeUnit\": \"ns\"}") != NULL);
+ free((void *)json);
+ trace_free(&trace);
+ assert_true(trace == NULL);
+
+ //recording into no trace does nothing
+ trace_begin(&trace, "ignored", "test");
+ trace_end(&trace, "ignored", "test");
+}
+
+static void test__trace__overflow(void) {
+ trace_t trace;
+ assert_no_error(trace_new(&trace, 4));
+ trace_begin(&trace, "lost", "test");
+ for (size_t i = 0; i < 2; i++) {
+  trace_begin(&trace, "kept", "test");
+  trace_end(&trace, "kept", "test");
+ }
+ trace_end(&trace, "lost", "test");
+
+ //only the newest 4 events survive; ends whose begin was overwritten, of
+ //`lost` and the first `kept`, are dropped too
+ char * json = write_trace(&trace);
+ assert_true(strstr(json, "lost") == NULL);
+ assert_true(count_of(json, "\"kept\"") == 2);
+ free((void *)json);
+ trace_free(&trace);
+}
+
+static void * trace_thread(void * arg) {
+ trace_t * trace = arg;
+ trace_begin(trace, "thread", "test");
+ trace_end(trace, "thread", "test");
+ return NULL;
+}
+
+static void test__trace__threads(void) {
+ trace_t trace;
+ assert_no_error(trace_new(&trace, 16));
+ pthread_t threads[2];
+ for (size_t i = 0; i < 2; i++) {
+  assert_true(pthread_create(threads + i, NULL, trace_thread, &trace) == 0);
+  assert_true(pthread_join(threads[i], NULL) == 0);
+ }
+
+ //every thread records into its own timeline
+ char * json = write_trace(&trace);
+ assert_true(count_of(json, "\"tid\": 1}") == 2);
+ assert_true(count_of(json, "\"tid\": 2}") == 2);
+ free((void *)json);
+ trace_free(&trace);
+}
+
+static void ok_callback(test_t test, void * ctx) {
+ (void)ctx;
+ test_ok(&test);
+}
+
+static void noop_hook(test_runner_setup_t setup) {
+ (void)setup;
+}
+
+static void test__trace__test_run(void) {
+ test_suite_t test_suite;
+ assert_no_error(test_suite_new(&test_suite));
+ test_t test;
+ assert_no_error(test_new(&test, "traced test", ok_callback));
+ assert_no_error(test_suite_add(&test_suite, &test));
+ test_free(&test);
+
+ test_runner_config_t config = TEST_RUNNER_DEFAULT;
+ config.before_all = noop_hook;
+ config.after_each = noop_hook;
+ assert_no_error(trace_new(&config.trace, TRACE_DEFAULT_CAPACITY));
+ assert_true(test_suite_run_and_emit(&test_suite, config) == 0);
+
+ //configured hooks and tests are recorded, missing hooks are not
+ char * json = write_trace(&config.trace);
+ assert_true(count_of(json, "\"before_all\", \"cat\": \"hook\"") == 2);
+ assert_true(count_of(json, "\"after_each\", \"cat\": \"hook\"") == 2);
+ assert_true(count_of(json, "\"traced test\", \"cat\": \"test\"") == 2);
+ assert_true(strstr(json, "before_each") == NULL);
+ free((void *)json);
+
+ trace_free(&config.trace);
+ test_suite_free(&test_suite);
+}
+
+int main(void) {
+ test__trace__events();
+ test__trace__overflow();
+ test__trace__threads();
+ test__trace__test_run();
+
+ return 0;
+}
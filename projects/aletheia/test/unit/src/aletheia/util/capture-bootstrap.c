@@ -0,0 +1,68 @@
+/*this file contains tests for the aletheia output capture utilities; do not
+ *use the definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include <aletheia/util/capture.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+static void test__capture__output(void) {
+ capture_t capture;
+ assert_true(capture_new(&capture) == NULL);
+ assert_true(capture_stop(&capture, NULL) != NULL);
+
+ //writes to both streams end up in one buffer, in the order they reached it;
+ //`stdout` may be fully buffered
+ assert_true(capture_start(&capture) == NULL);
+ assert_true(capture_start(&capture) != NULL);
+ printf("out %d\n", 1);
+ fflush(stdout);
+ fprintf(stderr, "err %d\n", 2);
+ assert_true(write(STDOUT_FILENO, "raw\n", 4) == 4);
+ char * output = NULL;
+ assert_true(capture_stop(&capture, &output) == NULL);
+ assert_true(strcmp(output, "out 1\nerr 2\nraw\n") == 0);
+ free((void *)output);
+
+ //the next capture starts empty
+ assert_true(capture_start(&capture) == NULL);
+ assert_true(capture_stop(&capture, &output) == NULL);
+ assert_true(output == NULL);
+
+ //discarded output never reaches the terminal
+ assert_true(capture_start(&capture) == NULL);
+ printf("discarded\n");
+ assert_true(capture_stop(&capture, NULL) == NULL);
+
+ //freeing a running capture restores the streams
+ assert_true(capture_start(&capture) == NULL);
+ capture_free(&capture);
+ assert_true(capture == NULL);
+ assert_true(printf("restored\n") > 0);
+}
+
+int main(void) {
+ test__capture__output();
+
+ return 0;
+}
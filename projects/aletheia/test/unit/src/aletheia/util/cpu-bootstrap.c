@@ -0,0 +1,82 @@
+/*this file contains tests for the aletheia cpu environment utilities; do not
+ *use the definitions in `<aletheia/test.h>` to create tests here
+ */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __linux__
+ #include <sched.h>
+#endif
+
+#include <aletheia/util/cpu.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+static void test__cpu__env(void) {
+ cpu_env_t env = NULL;
+ assert_true(cpu_env_new(&env) == NULL);
+ assert_true(cpu_env_get_cpu(&env) == -1);
+
+#ifdef __linux__
+ cpu_set_t before, pinned, after;
+ assert_true(sched_getaffinity(0, sizeof(before), &before) == 0);
+
+ //pinning narrows the affinity mask to a single cpu
+ assert_true(cpu_env_pin(&env) == NULL);
+ int const cpu = cpu_env_get_cpu(&env);
+ assert_true(cpu >= 0);
+ assert_true(sched_getaffinity(0, sizeof(pinned), &pinned) == 0);
+ assert_true(CPU_COUNT(&pinned) == 1 && CPU_ISSET(cpu, &pinned));
+ assert_true(cpu_current() == cpu);
+
+ //raising priority depends on permissions; either outcome is restored
+ cpu_env_raise_priority(&env);
+
+ //freeing restores the original mask
+ cpu_env_free(&env);
+ assert_true(env == NULL);
+ assert_true(sched_getaffinity(0, sizeof(after), &after) == 0);
+ assert_true(CPU_EQUAL(&before, &after));
+#else
+ cpu_env_free(&env);
+#endif
+}
+
+static void test__cpu__frequency(void) {
+ cpu_frequency_t frequency;
+
+ //unknown cpus report nothing
+ cpu_frequency_sample(-1, &frequency);
+ assert_true(!frequency.frequency_available);
+ assert_true(!frequency.throttle_available);
+ assert_true(frequency.governor[0] == '\0');
+
+ //hosts without cpufreq support report nothing instead of failing
+ cpu_frequency_sample(cpu_current() < 0 ? 0 : cpu_current(), &frequency);
+ assert_true(!frequency.frequency_available || frequency.frequency_khz > 0);
+ assert_true(strlen(frequency.governor) < sizeof(frequency.governor));
+}
+
+int main(void) {
+ test__cpu__env();
+ test__cpu__frequency();
+ return 0;
+}
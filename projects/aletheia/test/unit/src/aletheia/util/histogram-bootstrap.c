@@ -0,0 +1,123 @@
+/*this file contains tests for the aletheia latency histogram; do not use the
+ *definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <aletheia/util/histogram.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//asserts that `value` is within the histogram's relative precision of `expected`
+#define assert_within_precision(value, expected) \
+assert_true( \
+ (double)(value) >= (double)(expected) \
+ && (double)(value) <= (double)(expected) * (1.0 + 1.0 / 128.0) \
+)
+
+static histogram_t histogram, other;
+
+static void test__histogram__empty(void) {
+ histogram_reset(&histogram);
+ assert_true(histogram.count == 0);
+ assert_true(histogram_percentile(&histogram, 50.0) == 0);
+ assert_true(histogram_mean(&histogram) == 0.0);
+}
+
+static void test__histogram__exact_small_values(void) {
+ histogram_reset(&histogram);
+ for (uint64_t i = 1; i <= 100; i++) {
+  histogram_record(&histogram, i, 1);
+ }
+ assert_true(histogram.count == 100);
+ assert_true(histogram.min == 1);
+ assert_true(histogram.max == 100);
+ assert_true(histogram_percentile(&histogram, 50.0) == 50);
+ assert_true(histogram_percentile(&histogram, 99.0) == 99);
+ assert_true(histogram_percentile(&histogram, 100.0) == 100);
+ assert_true(histogram_mean(&histogram) == 50.5);
+}
+
+static void test__histogram__large_values(void) {
+ histogram_reset(&histogram);
+ uint64_t const values[] = {
+  1000,
+  123456,
+  UINT64_C(987654321),
+  UINT64_C(1) << 40,
+  UINT64_MAX
+ };
+ for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+  histogram_reset(&histogram);
+  histogram_record(&histogram, values[i], 1);
+  //a single value is reported exactly, since percentiles are clamped to max
+  assert_true(histogram_percentile(&histogram, 50.0) == values[i]);
+ }
+
+ //percentiles of a wide distribution stay within the bucket precision
+ histogram_reset(&histogram);
+ for (uint64_t i = 1; i <= 10000; i++) {
+  histogram_record(&histogram, i * 1000, 1);
+ }
+ assert_within_precision(histogram_percentile(&histogram, 50.0), 5000000);
+ assert_within_precision(histogram_percentile(&histogram, 99.0), 9900000);
+ assert_within_precision(histogram_percentile(&histogram, 99.99), 9999000);
+ assert_true(histogram_percentile(&histogram, 100.0) == 10000000);
+}
+
+static void test__histogram__weighted(void) {
+ histogram_reset(&histogram);
+ histogram_record(&histogram, 10, 9999);
+ histogram_record(&histogram, 5000, 1);
+ histogram_record(&histogram, 7, 0);
+ assert_true(histogram.count == 10000);
+ assert_true(histogram.min == 10);
+ assert_true(histogram_percentile(&histogram, 99.99) == 10);
+ assert_true(histogram_percentile(&histogram, 99.999) == 5000);
+}
+
+static void test__histogram__merge(void) {
+ histogram_reset(&histogram);
+ histogram_reset(&other);
+ for (uint64_t i = 1; i <= 50; i++) {
+  histogram_record(&histogram, i, 1);
+  histogram_record(&other, i + 50, 1);
+ }
+ histogram_merge(&histogram, &other);
+ assert_true(histogram.count == 100);
+ assert_true(histogram.min == 1);
+ assert_true(histogram.max == 100);
+ assert_true(histogram_percentile(&histogram, 50.0) == 50);
+ assert_true(histogram_percentile(&histogram, 75.0) == 75);
+
+ //merging an empty histogram changes nothing
+ histogram_reset(&other);
+ histogram_merge(&histogram, &other);
+ assert_true(histogram.count == 100);
+ assert_true(histogram.min == 1);
+}
+
+int main(void) {
+ test__histogram__empty();
+ test__histogram__exact_small_values();
+ test__histogram__large_values();
+ test__histogram__weighted();
+ test__histogram__merge();
+ return 0;
+}
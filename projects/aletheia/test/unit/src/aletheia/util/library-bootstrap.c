@@ -0,0 +1,83 @@
+/*this file contains tests for the aletheia shared library utilities; do not
+ *use the definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <aletheia/util/library.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+//any shared library present on glibc hosts
+#define LIBRARY_PATH "libm.so.6"
+
+static void test__library__function(void) {
+ library_t first = NULL, second = NULL;
+
+ //hosts without the library must fail cleanly instead of crashing
+ if (library_open(&first, LIBRARY_PATH)) {
+  assert_true(first == NULL);
+  return;
+ }
+ assert_true(library_open(&second, LIBRARY_PATH) == NULL);
+ assert_true(strcmp(library_get_path(&first), LIBRARY_PATH) == 0);
+
+ //resolve and call the same function from both handles
+ library_function_t * functions[2] = {NULL, NULL};
+ assert_true(library_function(&first, "cos", functions) == NULL);
+ assert_true(library_function(&second, "cos", functions + 1) == NULL);
+ for (size_t i = 0; i < 2; i++) {
+  double (*cosine)(double) = (double (*)(double))functions[i];
+  assert_true(cosine(0.0) == 1.0);
+ }
+
+ library_free(&first);
+ library_free(&second);
+ assert_true(first == NULL && second == NULL);
+}
+
+static void test__library__errors(void) {
+ library_t library = NULL;
+
+ //missing libraries report the path and the loader's reason
+ char const * error = library_open(&library, "libaletheia-does-not-exist.so");
+ assert_true(error != NULL);
+ assert_true(library == NULL);
+ assert_true(strstr(error, "libaletheia-does-not-exist.so") != NULL);
+
+ if (library_open(&library, LIBRARY_PATH)) {
+  return;
+ }
+
+ //missing symbols report the symbol name
+ library_function_t * function = NULL;
+ error = library_function(&library, "aletheia_does_not_exist", &function);
+ assert_true(error != NULL);
+ assert_true(function == NULL);
+ assert_true(strstr(error, "aletheia_does_not_exist") != NULL);
+
+ library_free(&library);
+}
+
+int main(void) {
+ test__library__function();
+ test__library__errors();
+
+ return 0;
+}
@@ -0,0 +1,66 @@
+/*this file contains tests for the aletheia perf counter utilities; do not use
+ *the definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <aletheia/util/perf.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+static void test__perf__group(void) {
+ perf_group_t group = NULL;
+
+ //hosts without perf support must fail cleanly instead of crashing
+ if (perf_group_new(&group)) {
+  assert_true(group == NULL);
+  return;
+ }
+
+ perf_counters_t counters;
+ perf_group_start(&group);
+ for (size_t volatile i = 0; i < 100000; i++) {}
+ perf_group_stop(&group, &counters);
+ assert_true(perf_counters_any(&counters));
+
+ perf_group_free(&group);
+ assert_true(group == NULL);
+}
+
+static void test__perf__counters_add(void) {
+ perf_counters_t total, counters;
+ memset(&total, 0, sizeof(total));
+ memset(&counters, 0, sizeof(counters));
+ assert_true(!perf_counters_any(&total));
+
+ counters.available[PERF_CYCLES] = true;
+ counters.values[PERF_CYCLES] = 10;
+ perf_counters_add(&total, &counters);
+ perf_counters_add(&total, &counters);
+ assert_true(perf_counters_any(&total));
+ assert_true(total.values[PERF_CYCLES] == 20);
+ assert_true(!total.available[PERF_INSTRUCTIONS]);
+}
+
+int main(void) {
+ test__perf__group();
+ test__perf__counters_add();
+
+ return 0;
+}
@@ -0,0 +1,187 @@
+/*this file contains tests for the aletheia statistics utilities; do not use
+ *the definitions in `<aletheia/test.h>` to create tests here
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <aletheia/util/stats.h>
+
+//utility assert functions
+static void assert_true_impl(bool value, char const * expr, int line) {
+ if (value) {
+  return;
+ }
+ printf(
+  "expression assertion failed on line %d: `%s`\n",
+  line,
+  expr
+ );
+ exit(-1);
+}
+
+#define assert_true(expr) \
+assert_true_impl((bool)(expr), #expr, __LINE__)
+
+#define assert_near(a, b) \
+assert_true(fabs((a) - (b)) < 1e-9)
+
+static void test__stats__summarize(void) {
+ double const samples[] = {5.0, 1.0, 4.0, 2.0, 3.0, 100.0};
+ stats_summary_t summary;
+ assert_true(stats_summarize(samples, 6, &summary));
+ assert_true(summary.count == 6);
+ assert_near(summary.mean, 115.0 / 6.0);
+ assert_near(summary.median, 3.5);
+ assert_near(summary.min, 1.0);
+ assert_near(summary.max, 100.0);
+ //deviations from 3.5: 2.5, 1.5, 0.5, 0.5, 1.5, 96.5
+ assert_near(summary.mad, 1.5);
+ //input is left untouched
+ assert_near(samples[0], 5.0);
+}
+
+static void test__stats__summarize_single(void) {
+ double const sample = 42.0;
+ stats_summary_t summary;
+ assert_true(stats_summarize(&sample, 1, &summary));
+ assert_near(summary.median, 42.0);
+ assert_near(summary.stddev, 0.0);
+ assert_near(summary.mad, 0.0);
+}
+
+static void test__stats__summarize_empty(void) {
+ stats_summary_t summary;
+ assert_true(stats_summarize(NULL, 0, &summary));
+ assert_true(summary.count == 0);
+}
+
+static void test__stats__mann_whitney_u_shifted(void) {
+ double const a[] = {10.0, 11.0, 12.0, 10.5, 11.5, 10.2, 11.8, 10.9};
+ double const b[] = {13.0, 14.0, 13.5, 14.2, 13.1, 14.8, 13.9, 14.1};
+ stats_mann_whitney_t result;
+ assert_true(stats_mann_whitney_u(a, 8, b, 8, &result));
+ //every value in `b` is larger, so U is zero
+ assert_near(result.u, 0.0);
+ assert_true(result.z > 0.0);
+ assert_true(result.p < 0.01);
+}
+
+static void test__stats__mann_whitney_u_identical(void) {
+ double const a[] = {1.0, 2.0, 3.0, 4.0};
+ stats_mann_whitney_t result;
+ assert_true(stats_mann_whitney_u(a, 4, a, 4, &result));
+ assert_near(result.u, 8.0);
+ assert_near(result.p, 1.0);
+}
+
+static void test__stats__mann_whitney_u_all_ties(void) {
+ double const a[] = {5.0, 5.0, 5.0};
+ stats_mann_whitney_t result;
+ assert_true(stats_mann_whitney_u(a, 3, a, 3, &result));
+ assert_near(result.p, 1.0);
+}
+
+static void test__stats__median_interval(void) {
+ double const sorted[] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0};
+ stats_interval_t interval;
+
+ //10 samples bound the median by the 2nd and 9th at 97.9% confidence
+ assert_true(stats_median_interval(sorted, 10, 0.95, &interval));
+ assert_near(interval.lower, 2.0);
+ assert_near(interval.upper, 9.0);
+ assert_true(fabs(interval.confidence - (1.0 - 22.0 / 1024.0)) < 1e-9);
+
+ //lower confidence narrows the interval
+ assert_true(stats_median_interval(sorted, 10, 0.8, &interval));
+ assert_near(interval.lower, 3.0);
+ assert_near(interval.upper, 8.0);
+
+ //5 samples cannot reach 95%; the full range is reported instead
+ assert_true(!stats_median_interval(sorted, 5, 0.95, &interval));
+ assert_near(interval.lower, 1.0);
+ assert_near(interval.upper, 5.0);
+ assert_true(fabs(interval.confidence - (1.0 - 2.0 / 32.0)) < 1e-9);
+ assert_true(!stats_median_interval(sorted, 0, 0.95, &interval));
+}
+
+static void test__stats__shift_interval(void) {
+ double const a[] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0};
+ double b[10];
+ for (size_t i = 0; i < 10; i++) {
+  b[i] = a[i] + 100.0;
+ }
+ stats_interval_t interval;
+
+ //the 100 differences range over `[91, 109]`; 95% drops the 23 lowest and
+ //highest ones
+ assert_true(stats_shift_interval(a, 10, b, 10, 0.95, &interval));
+ assert_near(interval.lower, 97.0);
+ assert_near(interval.upper, 103.0);
+ assert_true(interval.confidence >= 0.95 && interval.confidence < 0.96);
+
+ //higher confidence widens the interval
+ assert_true(stats_shift_interval(a, 10, b, 10, 0.99, &interval));
+ assert_near(interval.lower, 96.0);
+ assert_near(interval.upper, 104.0);
+ assert_true(interval.confidence >= 0.99);
+
+ //3 samples each cannot reach 99%; all differences are spanned instead
+ assert_true(stats_shift_interval(a, 3, b, 3, 0.99, &interval));
+ assert_near(interval.lower, 98.0);
+ assert_near(interval.upper, 102.0);
+ assert_true(interval.confidence < 0.99);
+}
+
+static void test__stats__fit_complexity(void) {
+ double n[8], y[8];
+ stats_complexity_fit_t fit;
+
+ //too few measurements
+ assert_true(!stats_fit_complexity(n, y, 1, &fit));
+
+ //exact models are recovered with their coefficient
+ for (size_t i = 0; i < 8; i++) {
+  n[i] = (double)(UINT64_C(8) << (3 * i));
+ }
+ for (size_t c = 0; c < STATS_COMPLEXITY_COUNT; c++) {
+  for (size_t i = 0; i < 8; i++) {
+   switch ((enum stats_complexity_t)c) {
+    case STATS_COMPLEXITY_1: y[i] = 3.0; break;
+    case STATS_COMPLEXITY_LOG_N: y[i] = 3.0 * log2(n[i]); break;
+    case STATS_COMPLEXITY_N: y[i] = 3.0 * n[i]; break;
+    case STATS_COMPLEXITY_N_LOG_N: y[i] = 3.0 * n[i] * log2(n[i]); break;
+    default: y[i] = 3.0 * n[i] * n[i]; break;
+   }
+  }
+  assert_true(stats_fit_complexity(n, y, 8, &fit));
+  assert_true(fit.complexity == (enum stats_complexity_t)c);
+  assert_true(fabs(fit.coefficient - 3.0) < 1e-6);
+  assert_true(fit.rms < 1e-9);
+ }
+
+ //noisy linear measurements still fit O(n)
+ for (size_t i = 0; i < 8; i++) {
+  y[i] = 2.0 * n[i] * (i % 2 ? 1.05 : 0.95);
+ }
+ assert_true(stats_fit_complexity(n, y, 8, &fit));
+ assert_true(fit.complexity == STATS_COMPLEXITY_N);
+ assert_true(strcmp(stats_complexity_name(fit.complexity), "O(n)") == 0);
+}
+
+int main(void) {
+ test__stats__summarize();
+ test__stats__summarize_single();
+ test__stats__summarize_empty();
+ test__stats__mann_whitney_u_shifted();
+ test__stats__mann_whitney_u_identical();
+ test__stats__mann_whitney_u_all_ties();
+ test__stats__median_interval();
+ test__stats__shift_interval();
+ test__stats__fit_complexity();
+
+ return 0;
+}
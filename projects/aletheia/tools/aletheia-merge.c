@@ -0,0 +1,200 @@
+/*merges any number of aletheia result files into a single result file
+ *
+ *usage: aletheia-merge [-o <output>] <result file>...
+ *
+ *every input is already sorted, so a streaming k-way merge over a min-heap of
+ *input cursors is sufficient; only the current record of each input is held
+ *in memory at any time
+ *
+ *exits with `1` if any merged test failed, counting tests the way the runner
+ *does: time budget overruns alone do not fail it
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <aletheia/test.h>
+#include <aletheia/results.h>
+
+//cursor into a single input file
+typedef struct {
+ char const * path;
+ FILE * file;
+ test_results_reader_t reader;
+ test_results_record_t record;
+ //input index, used to keep the merge stable for duplicate records
+ size_t index;
+} merge_input_t;
+
+//utility function; orders cursors by current record, then input index
+static bool merge_input_less(merge_input_t const * a, merge_input_t const * b) {
+ int const result = test_results_record_compare(&a->record, &b->record);
+ if (result) {
+  return result < 0;
+ }
+ return a->index < b->index;
+}
+
+//utility function; restores the heap property below `i`
+static void merge_heap_sift_down(merge_input_t ** heap, size_t count, size_t i) {
+ while (true) {
+  size_t smallest = i;
+  size_t const left = 2 * i + 1;
+  size_t const right = left + 1;
+  if (left < count && merge_input_less(heap[left], heap[smallest])) {
+   smallest = left;
+  }
+  if (right < count && merge_input_less(heap[right], heap[smallest])) {
+   smallest = right;
+  }
+  if (smallest == i) {
+   return;
+  }
+  merge_input_t * tmp = heap[i];
+  heap[i] = heap[smallest];
+  heap[smallest] = tmp;
+  i = smallest;
+ }
+}
+
+//utility function; advances `input` to its next record
+static bool merge_input_advance(merge_input_t * input) {
+ bool done = false;
+ char const * error = test_results_reader_next(
+  &input->reader,
+  &input->record,
+  &done
+ );
+ if (error) {
+  fprintf(stderr, "%s: %s\n", input->path, error);
+  exit(-1);
+ }
+ return !done;
+}
+
+//merge summary, printed once all inputs have been consumed
+typedef struct {
+ size_t
+  records,
+  tests,
+  failed_tests;
+} merge_summary_t;
+
+static void merge_summary_add(
+ merge_summary_t * summary,
+ test_results_record_t const * record
+) {
+ summary->records++;
+ if (strcmp(record->fields[0], "test") != 0 || record->field_count < 3) {
+  return;
+ }
+ summary->tests++;
+ //budget overruns alone do not fail the merged run, as they do not fail a
+ //single one
+ if (test_results_record_failed(record)) {
+  summary->failed_tests++;
+ }
+}
+
+int main(int argc, char ** argv) {
+ char const * output_path = NULL;
+ int first_input = 1;
+ if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+  output_path = argv[2];
+  first_input = 3;
+ }
+ if (first_input >= argc) {
+  fprintf(stderr, "usage: %s [-o <output>] <result file>...\n", argv[0]);
+  return -1;
+ }
+
+ //open all inputs
+ size_t const input_count = (size_t)(argc - first_input);
+ merge_input_t * inputs = calloc(input_count, sizeof(merge_input_t));
+ merge_input_t ** heap = calloc(input_count, sizeof(merge_input_t *));
+ if (!inputs || !heap) {
+  fprintf(stderr, "failed to allocate space for %zu inputs\n", input_count);
+  return -1;
+ }
+ size_t heap_count = 0;
+ for (size_t i = 0; i < input_count; i++) {
+  merge_input_t * input = inputs + i;
+  input->path = argv[first_input + (int)i];
+  input->index = i;
+  input->file = fopen(input->path, "r");
+  if (!input->file) {
+   fprintf(stderr, "failed to open '%s'\n", input->path);
+   return -1;
+  }
+  char const * error = test_results_reader_new(&input->reader, input->file);
+  if (error) {
+   fprintf(stderr, "%s: %s\n", input->path, error);
+   return -1;
+  }
+  if (merge_input_advance(input)) {
+   heap[heap_count++] = input;
+  }
+ }
+ for (size_t i = heap_count; i-- > 0;) {
+  merge_heap_sift_down(heap, heap_count, i);
+ }
+
+ //open output
+ FILE * output = stdout;
+ if (output_path) {
+  output = fopen(output_path, "w");
+  if (!output) {
+   fprintf(stderr, "failed to open '%s'\n", output_path);
+   return -1;
+  }
+ }
+ fprintf(output, "%s\n", TEST_RESULTS_HEADER);
+
+ //merge
+ merge_summary_t summary = {
+  .records = 0,
+  .tests = 0,
+  .failed_tests = 0
+ };
+ while (heap_count) {
+  merge_input_t * input = heap[0];
+  fwrite(input->record.text, 1, input->record.text_length, output);
+  merge_summary_add(&summary, &input->record);
+
+  //keep previous record around to validate input ordering
+  test_results_record_t previous = input->record;
+  if (merge_input_advance(input)) {
+   if (test_results_record_compare(&previous, &input->record) > 0) {
+    fprintf(stderr, "%s: records are not sorted\n", input->path);
+    return -1;
+   }
+  } else {
+   heap[0] = heap[--heap_count];
+  }
+  test_results_record_free(&previous);
+  merge_heap_sift_down(heap, heap_count, 0);
+ }
+
+ //clean up
+ if (output != stdout) {
+  fclose(output);
+ }
+ for (size_t i = 0; i < input_count; i++) {
+  test_results_reader_free(&inputs[i].reader);
+  fclose(inputs[i].file);
+ }
+ free((void *)heap);
+ free((void *)inputs);
+
+ fprintf(
+  stderr,
+  "merged %zu records from %zu files: %zu tests, %zu failed\n",
+  summary.records,
+  input_count,
+  summary.tests,
+  summary.failed_tests
+ );
+ return summary.failed_tests ? 1 : 0;
+}